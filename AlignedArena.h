@@ -0,0 +1,74 @@
+#ifndef ALIGNEDARENA_H_INCLUDED
+#define ALIGNEDARENA_H_INCLUDED
+
+#include "AlignedBuffer.h"
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  One cache-line-aligned heap block, handed out in pieces.
+
+  Add up getSpaceFor() for everything that goes in, allocate() once, then
+  take() the pieces in the same order. Every piece starts on its own cache
+  line (64 bytes), so neighbouring pieces never share one and SIMD loads
+  never straddle one. Pieces taken one after the other sit one after the
+  other in memory, which is the point: a per-channel layout becomes one
+  contiguous run instead of a heap allocation per channel.
+
+  note:
+  - take() never allocates; it returns nullptr once the block is used up
+  - pieces are only valid until the next allocate(), and nothing is
+    constructed or destroyed in them, so keep to plain types
+  - reset() hands the same block out again from the start
+
+ */
+
+class AlignedArena
+{
+public:
+    enum { alignment = AlignedBuffer<unsigned char>::alignment };
+
+    AlignedArena() {}
+
+    /* Bytes that take<Type> (numElements) uses up. */
+    template <typename Type>
+    static size_t getSpaceFor (size_t numElements)
+    {
+        return (numElements * sizeof (Type) + alignment - 1) & ~(size_t) (alignment - 1);
+    }
+
+    /* Frees every piece and allocates numBytes, zeroed. */
+    void allocate (size_t numBytes)
+    {
+        block.allocate (numBytes);
+        used = 0;
+    }
+
+    template <typename Type>
+    Type* take (size_t numElements)
+    {
+        const size_t space = getSpaceFor<Type> (numElements);
+
+        if (block.get() == nullptr || used + space > block.size())
+            return nullptr;
+
+        Type* piece = reinterpret_cast<Type*> (block.get() + used);
+        used += space;
+        return piece;
+    }
+
+    void reset()                            { used = 0; }
+
+    size_t getSize() const                  { return block.size(); }
+    size_t getNumBytesUsed() const          { return used; }
+
+private:
+    AlignedBuffer<unsigned char> block;
+    size_t used = 0;
+
+    AlignedArena (const AlignedArena&);
+    AlignedArena& operator= (const AlignedArena&);
+};
+
+#endif  // ALIGNEDARENA_H_INCLUDED
@@ -0,0 +1,76 @@
+#ifndef ALIGNEDBUFFER_H_INCLUDED
+#define ALIGNEDBUFFER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+//----------------------------------------------------------------------------//
+
+/*
+ Zeroed heap array starting on a cache line (64 bytes), so SIMD loads never
+ straddle a line. Only allocates in allocate(), never behind your back.
+*/
+
+template <typename Type>
+class AlignedBuffer
+{
+public:
+    enum { alignment = 64 };
+
+    AlignedBuffer() {}
+
+    explicit AlignedBuffer (size_t numElementsToAllocate)
+    {
+        allocate (numElementsToAllocate);
+    }
+
+    ~AlignedBuffer()
+    {
+        free();
+    }
+
+    void allocate (size_t numElementsToAllocate)
+    {
+        free();
+
+        if (numElementsToAllocate == 0)
+            return;
+
+        raw = std::malloc (numElementsToAllocate * sizeof (Type) + alignment);
+        data = reinterpret_cast<Type*> ((reinterpret_cast<uintptr_t> (raw) + alignment) & ~(uintptr_t) (alignment - 1));
+        numElements = numElementsToAllocate;
+
+        clear();
+    }
+
+    void free()
+    {
+        std::free (raw);
+        raw = nullptr;
+        data = nullptr;
+        numElements = 0;
+    }
+
+    void clear()
+    {
+        if (data != nullptr)
+            std::memset (data, 0, numElements * sizeof (Type));
+    }
+
+    Type* get() const                     { return data; }
+    operator Type*() const                { return data; }
+    Type& operator[] (size_t i) const     { return data[i]; }
+    size_t size() const                   { return numElements; }
+
+private:
+    void* raw = nullptr;
+    Type* data = nullptr;
+    size_t numElements = 0;
+
+    AlignedBuffer (const AlignedBuffer&);
+    AlignedBuffer& operator= (const AlignedBuffer&);
+};
+
+#endif  // ALIGNEDBUFFER_H_INCLUDED
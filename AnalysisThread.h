@@ -0,0 +1,337 @@
+#ifndef ANALYSISTHREAD_H_INCLUDED
+#define ANALYSISTHREAD_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "AlignedArena.h"
+#include "MultichannelSTFT.h"
+#include "GeometryLocalizer.h"
+#include "PipelineProfiler.h"
+#include "GridLocalizer.h"
+#include "LocalizationPublisher.h"
+#include "LocalizationRecording.h"
+#include "RingFifo.h"
+#include "SpectrumFrame.h"
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Runs the STFT off the audio thread.
+
+  The audio callback only calls pushSamples(), which copies the block into
+  a lock-free RingFifo holding every channel: no locks, no allocation, no
+  FFTs, so its cost no longer grows with channel count or FFT size. This thread
+  drains the fifos a hop at a time, runs the batched STFT over the last
+  fftSize samples and publishes the magnitudes through getSpectra(), a
+  lock-free triple buffer, then triggers the frame listener (the display's
+  RenderScheduler) if there is one.
+
+  note:
+  - a block is dropped on all channels together when the fifos are full, so
+    channels never slip against each other (see getNumDroppedBlocks)
+  - the worker polls; waking it from the audio thread would take a lock
+  - the fifo and the frame being loaded share one AlignedArena, laid out
+    channel after channel, each channel's capacity rounded up to whole
+    cache lines, and allocated only in prepare(), which is
+    prepareToPlay's job; it is sized for the fft size at the time, so a
+    smaller fft or another hop never touches anything the audio thread
+    uses, and a bigger one needs prepare() again (see fitsFFTSize)
+  - while recording, every frame (not just the ones the display picks up)
+    is localized here and appended to a .pnlr file, over the 3x3 grid or
+    the array geometry if one is set; with a publisher, every frame is
+    localized the same way and handed to it for streaming
+
+ */
+
+class AnalysisThread : public Thread
+{
+public:
+    enum
+    {
+        minFFTOrder = 8,    // 256
+        maxFFTOrder = 13    // 8192
+    };
+
+    AnalysisThread (int numChannelsToUse, int fftOrder, int hopSize)
+    :
+    Thread ("Panogram analysis"),
+    numChannels (numChannelsToUse)
+    {
+        setParameters (fftOrder, hopSize);
+    }
+
+    ~AnalysisThread()
+    {
+        stopThread (1000);
+        recorder.close();
+    }
+
+    /* Lays out the fifo and frame buffer for the current fft size and blocks of
+       up to maximumBlockSize, and tells the worker how long a hop of audio
+       lasts so it can poll sensibly. Allocates, so only from prepareToPlay,
+       while this thread is stopped. */
+    void prepare (double sampleRateToUse, int maximumBlockSize)
+    {
+        jassert (! isThreadRunning());
+
+        sampleRate = sampleRateToUse;
+        updatePollInterval();
+
+        // room for a few frames, and for the worker falling a few blocks behind
+        const int fifoSize = RingFifo::getCapacityFor (4 * (fftSize + jmax (1, maximumBlockSize)));
+
+        arena.allocate (AlignedArena::getSpaceFor<float> ((size_t) numChannels * fifoSize)
+                          + AlignedArena::getSpaceFor<float> (fftSize));
+
+        ringBuffer.setStorage (arena.take<float> ((size_t) numChannels * fifoSize), numChannels, fifoSize);
+        frameBuffer = arena.take<float> (fftSize);
+        frameBufferSize = fftSize;
+
+        // the geometry's eq depends on the rate
+        if (publisher != nullptr)
+            prepareLocalizer();
+    }
+
+    /* False once setParameters() has asked for a bigger fft than prepare() laid
+       things out for; prepare() has to run again before it is analysed. */
+    bool fitsFFTSize() const                        { return fftSize <= frameBufferSize; }
+
+    /* Changes fft size (2^minFFTOrder..2^maxFFTOrder) and hop. Allocates, so call
+       it from the message thread while this thread is stopped. */
+    void setParameters (int newFFTOrder, int newHopSize)
+    {
+        jassert (! isThreadRunning());
+        jassert (newFFTOrder >= minFFTOrder && newFFTOrder <= maxFFTOrder);
+
+        fftOrder = newFFTOrder;
+        fftSize = 1 << fftOrder;
+        numBins = fftSize / 2;
+        hopSize = jlimit (1, fftSize, newHopSize);
+
+        // complex bins too, for the panogram's TDOA mode
+        stft.prepare (fftOrder, numChannels, MultichannelSTFT::getCOLAWindowScale (fftSize, hopSize), true);
+
+        // a recording has one fft size and hop for its whole length
+        recorder.close();
+
+        spectra.allocate (numChannels, numBins, true);
+        updatePollInterval();
+
+        if (publisher != nullptr)
+        {
+            prepareLocalizer();
+            publisher->prepare (numBins);
+        }
+    }
+
+    int getFFTOrder() const                         { return fftOrder; }
+    int getFFTSize() const                          { return fftSize; }
+    int getHopSize() const                          { return hopSize; }
+
+    //==========================================================================
+
+    /* Audio thread only. Bounded time, lock-free, allocation-free. */
+    void pushSamples (const AudioSampleBuffer& buffer, int startSample, int numSamples)
+    {
+        if (ringBuffer.getFreeSpace() < numSamples)
+        {
+            ++numDroppedBlocks;
+            PANOGRAM_PROFILE_COUNT (PipelineProfiler::droppedBlocks, 1);
+            return;
+        }
+
+        // missing inputs are fed silence so every channel fills at the same rate
+        ringBuffer.addToFifo (buffer, startSample, numSamples);
+    }
+
+    //==========================================================================
+
+    /* Recordings localize over this array instead of the 3x3 grid. Takes
+       effect from the next startRecording(). */
+    void setGeometry (const ArrayGeometry& geometryToUse)
+    {
+        jassert (! isThreadRunning());
+        geometry = geometryToUse;
+        useGeometry = true;
+    }
+
+    /* Starts writing every analysed frame to a .pnlr file. Like setParameters(),
+       only while this thread is stopped; changing parameters ends the recording. */
+    bool startRecording (const File& file)
+    {
+        jassert (! isThreadRunning());
+
+        LocalizationRecordingInfo info;
+        info.numBins = numBins;
+        info.fftSize = fftSize;
+        info.hopSize = hopSize;
+        info.sampleRate = sampleRate;
+        info.startTimeMs = Time::currentTimeMillis();
+
+        prepareLocalizer();
+        numFramesRecorded = 0;
+
+        return recorder.open (file.getFullPathName().toStdString(), info);
+    }
+
+    void stopRecording()
+    {
+        jassert (! isThreadRunning());
+        recorder.close();
+    }
+
+    bool isRecording() const                        { return recorder.isOpen(); }
+
+    /* Streams every analysed frame through the publisher, localized like a
+       recording; nullptr stops. Only while this thread is stopped. Keeps the
+       publisher prepared for the current bin count from then on. */
+    bool setPublisher (LocalizationPublisher* publisherToUse)
+    {
+        jassert (! isThreadRunning());
+        publisher = publisherToUse;
+
+        if (publisher == nullptr)
+            return true;
+
+        prepareLocalizer();
+        return publisher->prepare (numBins);
+    }
+
+    //==========================================================================
+
+    int getNumDroppedBlocks() const                 { return numDroppedBlocks.get(); }
+    int getNumFramesAnalysed() const                { return numFramesAnalysed.get(); }
+
+    /* Published frames, read by one display-side consumer. */
+    SpectrumTripleBuffer& getSpectra()              { return spectra; }
+
+    /* Triggered from this thread after every published frame; nullptr for
+       none. Only while this thread is stopped. */
+    void setFrameListener (AsyncUpdater* listener)
+    {
+        jassert (! isThreadRunning());
+        frameListener = listener;
+    }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            if (! analyseNextFrame())
+                wait (pollIntervalMs.get());
+        }
+    }
+
+    bool analyseNextFrame()
+    {
+        if (! fitsFFTSize() || ringBuffer.getNumReady() < fftSize)
+            return false;
+
+        // copy the oldest fftSize samples into the interleaved stft frame, then advance one hop
+        {
+            PANOGRAM_PROFILE_SCOPE (PipelineProfiler::fifoRead);
+
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                ringBuffer.peekFromFifo (ch, frameBuffer, fftSize);
+                stft.loadChannel (ch, frameBuffer);
+            }
+
+            ringBuffer.discardFromFifo (hopSize);
+        }
+
+        // window and forward FFT, every channel in one pass
+        stft.process();
+
+        // fill the free buffer and hand it over in one atomic swap
+        SpectrumFrame& frame = spectra.getWriteBuffer();
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            memcpy (frame.getChannel (ch), stft.getMagnitudes (ch), numBins * sizeof(float));
+            memcpy (frame.getReal (ch), stft.getReal (ch), numBins * sizeof(float));
+            memcpy (frame.getImag (ch), stft.getImag (ch), numBins * sizeof(float));
+        }
+
+        frame.sequence = ++lastSequence;
+
+        // localized once, for the recording and the stream alike
+        if (recorder.isOpen() || publisher != nullptr)
+        {
+            LocalizationFrame localized;
+
+            if (useGeometry)
+            {
+                geometryLocalizer.process (frame);
+                localized = geometryLocalizer.getFrame();
+            }
+            else
+            {
+                recordingLocalizer.process (frame);
+                localized = recordingLocalizer.getFrame();
+            }
+
+            if (recorder.isOpen())
+                recorder.addFrame (numFramesRecorded++, localized);
+
+            if (publisher != nullptr)
+                publisher->addFrame (localized);
+        }
+
+        spectra.publish();
+
+        if (frameListener != nullptr)
+            frameListener->triggerAsyncUpdate();
+
+        ++numFramesAnalysed;
+        return true;
+    }
+
+    void prepareLocalizer()
+    {
+        recordingLocalizer.setNumBins (numBins);
+        if (useGeometry)
+            geometryLocalizer.prepare (geometry, numBins, sampleRate);
+    }
+
+    void updatePollInterval()
+    {
+        pollIntervalMs = jmax (1, (int) (hopSize * 1000.0 / sampleRate) / 4);
+    }
+
+    const int numChannels;
+    int fftOrder = 0;
+    int fftSize = 0;
+    int numBins = 0;
+    int hopSize = 0;
+    double sampleRate = 44100.0;
+
+    AlignedArena arena;                 // ringBuffer's samples, then frameBuffer
+    RingFifo ringBuffer;
+    float* frameBuffer = nullptr;       // one channel's frame on its way into stft
+    int frameBufferSize = 0;
+
+    MultichannelSTFT stft;
+
+    SpectrumTripleBuffer spectra;
+    uint64 lastSequence = 0;    // keeps counting across setParameters()
+
+    GridLocalizer recordingLocalizer;       // all 9 mics, same as the panogram; recordings and the stream
+    GeometryLocalizer geometryLocalizer;
+    ArrayGeometry geometry;
+    bool useGeometry = false;
+    LocalizationRecordingWriter recorder;
+    int64 numFramesRecorded = 0;
+    LocalizationPublisher* publisher = nullptr;
+    AsyncUpdater* frameListener = nullptr;
+
+    Atomic<int> pollIntervalMs { 5 };
+
+    Atomic<int> numDroppedBlocks;
+    Atomic<int> numFramesAnalysed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisThread)
+};
+
+#endif  // ANALYSISTHREAD_H_INCLUDED
@@ -0,0 +1,196 @@
+#include "ArrayGeometry.h"
+#include "GridLocalizer.h"
+
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+//----------------------------------------------------------------------------//
+
+bool ArrayGeometry::fail (int line, const std::string& error)
+{
+    lastError = "line " + std::to_string (line) + ": " + error;
+    return false;
+}
+
+bool ArrayGeometry::parse (const std::string& text)
+{
+    name.clear();
+    sharpness = 4;
+    unitMetres = 0.1f;
+    mics.clear();
+    lastError.clear();
+
+    std::istringstream lines (text);
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline (lines, line))
+    {
+        ++lineNumber;
+
+        const size_t comment = line.find ('#');
+        if (comment != std::string::npos)
+            line.erase (comment);
+
+        std::istringstream words (line);
+        std::string keyword;
+
+        if (! (words >> keyword))
+            continue;
+
+        if (keyword == "name")
+        {
+            std::getline (words >> std::ws, name);
+            while (! name.empty() && std::isspace ((unsigned char) name.back()))
+                name.erase (name.size() - 1);
+        }
+        else if (keyword == "sharpness")
+        {
+            if (! (words >> sharpness) || (sharpness != 1 && sharpness != 2 && sharpness != 4 && sharpness != 8))
+                return fail (lineNumber, "sharpness must be 1, 2, 4 or 8");
+        }
+        else if (keyword == "unit")
+        {
+            if (! (words >> unitMetres) || ! (unitMetres > 0.0f))
+                return fail (lineNumber, "unit must be a positive number of metres");
+        }
+        else if (keyword == "mic")
+        {
+            ArrayMic mic;
+
+            if (! (words >> mic.channel >> mic.x >> mic.y) || mic.channel < 1)
+                return fail (lineNumber, "expected mic <channel> <x> <y> [<gain dB>]");
+
+            if (mic.channel > maxChannels)
+                return fail (lineNumber, "channel " + std::to_string (mic.channel) + " is above "
+                                           + std::to_string ((int) maxChannels));
+
+            words >> mic.gainDb;
+            mic.channel--;
+
+            for (const ArrayMic& other : mics)
+                if (other.channel == mic.channel)
+                    return fail (lineNumber, "channel " + std::to_string (mic.channel + 1) + " used twice");
+
+            mics.push_back (mic);
+        }
+        else if (keyword == "eq")
+        {
+            int channel = 0;
+            if (! (words >> channel))
+                return fail (lineNumber, "expected eq <channel> <Hz> <dB> ...");
+
+            ArrayMic* mic = nullptr;
+            for (ArrayMic& m : mics)
+                if (m.channel == channel - 1)
+                    mic = &m;
+
+            if (mic == nullptr)
+                return fail (lineNumber, "eq for channel " + std::to_string (channel) + " before its mic line");
+
+            float hz, db;
+            while (words >> hz >> db)
+            {
+                if (hz <= 0.0f || (! mic->eqHz.empty() && hz <= mic->eqHz.back()))
+                    return fail (lineNumber, "eq frequencies must be positive and ascending");
+
+                mic->eqHz.push_back (hz);
+                mic->eqDb.push_back (db);
+            }
+
+            if (mic->eqHz.empty())
+                return fail (lineNumber, "eq needs at least one <Hz> <dB> pair");
+        }
+        else
+        {
+            return fail (lineNumber, "unknown keyword '" + keyword + "'");
+        }
+    }
+
+    if (mics.size() < 2)
+        return fail (lineNumber, "need at least 2 mics");
+
+    return true;
+}
+
+bool ArrayGeometry::load (const std::string& path)
+{
+    std::ifstream file (path.c_str());
+
+    if (! file)
+    {
+        lastError = "can't open " + path;
+        return false;
+    }
+
+    std::stringstream text;
+    text << file.rdbuf();
+
+    return parse (text.str());
+}
+
+//----------------------------------------------------------------------------//
+
+float ArrayGeometry::getGainDb (const ArrayMic& mic, float hz) const
+{
+    const size_t numPoints = mic.eqHz.size();
+
+    if (numPoints == 0)
+        return mic.gainDb;
+
+    if (hz <= mic.eqHz.front())
+        return mic.gainDb + mic.eqDb.front();
+
+    if (hz >= mic.eqHz.back())
+        return mic.gainDb + mic.eqDb.back();
+
+    size_t upper = 1;
+    while (mic.eqHz[upper] < hz)
+        upper++;
+
+    const float t = std::log (hz / mic.eqHz[upper - 1]) / std::log (mic.eqHz[upper] / mic.eqHz[upper - 1]);
+    return mic.gainDb + mic.eqDb[upper - 1] + t * (mic.eqDb[upper] - mic.eqDb[upper - 1]);
+}
+
+int ArrayGeometry::getNumChannelsNeeded() const
+{
+    int needed = 0;
+
+    for (const ArrayMic& mic : mics)
+        needed = mic.channel + 1 > needed ? mic.channel + 1 : needed;
+
+    return needed;
+}
+
+ArrayGeometry ArrayGeometry::makeGrid (int rows, int columns)
+{
+    ArrayGeometry geometry;
+    geometry.name = std::to_string (rows) + "x" + std::to_string (columns) + " grid";
+
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            ArrayMic mic;
+            mic.channel = row * columns + column;
+            mic.x = (float) column;
+            mic.y = (float) row;
+            geometry.mics.push_back (mic);
+        }
+    }
+
+    return geometry;
+}
+
+ArrayGeometry ArrayGeometry::makeDefault()
+{
+    ArrayGeometry geometry = makeGrid (3, 3);
+    geometry.name = "FERP 3x3";
+
+    for (ArrayMic& mic : geometry.mics)
+        mic.channel = GridLocalizer::layout[(int) mic.y][(int) mic.x];
+
+    return geometry;
+}
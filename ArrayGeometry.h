@@ -0,0 +1,87 @@
+#ifndef ARRAYGEOMETRY_H_INCLUDED
+#define ARRAYGEOMETRY_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Where the mics of an array sit, and how to correct them, read from a text
+  file so a 4x4, a 5x5 or an irregular layout needs no code changes.
+  GeometryLocalizer compiles one into weight tables.
+
+  file format, one statement per line, # starts a comment:
+    name <anything>
+    sharpness <1|2|4|8>                    default 4, see GeometryLocalizer
+    unit <metres>                          size of one x/y unit, default 0.1
+    mic <channel> <x> <y> [<gain dB>]      channel as numbered on the array, 1..64
+    eq <channel> <Hz> <dB> [<Hz> <dB> ...] response correction of one mic
+
+  x and y are in any unit, y pointing down the panogram; the localizer
+  stretches the mics' bounding box over the whole image. Only the TDOA
+  localizer needs real distances, and takes them from unit. Gain and eq are
+  added to the mic's level before localizing, eq interpolated linearly
+  over log frequency between its points and held flat beyond them.
+
+  e.g. the 9-mic array the app has always used (see GridLocalizer):
+    name FERP 3x3
+    mic 3 0 0
+    mic 6 1 0
+    mic 7 2 0
+    mic 2 0 1
+    mic 5 1 1
+    mic 8 2 1
+    mic 1 0 2
+    mic 4 1 2
+    mic 9 2 2
+
+ */
+
+struct ArrayMic
+{
+    int channel = 0;                // 0-based
+    float x = 0.0f;
+    float y = 0.0f;
+    float gainDb = 0.0f;
+
+    std::vector<float> eqHz;        // ascending
+    std::vector<float> eqDb;
+};
+
+struct ArrayGeometry
+{
+    enum { maxChannels = 64 };      // what the localizers take from a SpectrumFrame
+
+    /* Replaces everything with what the text describes. False, with
+       getLastError() saying which line, if it doesn't parse. */
+    bool parse (const std::string& text);
+    bool load (const std::string& path);
+
+    const std::string& getLastError() const         { return lastError; }
+
+    /* Correction of one mic at a frequency, in dB. */
+    float getGainDb (const ArrayMic& mic, float hz) const;
+
+    /* One more than the highest channel used. */
+    int getNumChannelsNeeded() const;
+
+    /* rows x columns, channels numbered along the rows from the top left. */
+    static ArrayGeometry makeGrid (int rows, int columns);
+
+    /* The 3x3 array as wired today (GridLocalizer::layout). */
+    static ArrayGeometry makeDefault();
+
+    std::string name;
+    int sharpness = 4;
+    float unitMetres = 0.1f;
+    std::vector<ArrayMic> mics;
+
+private:
+    bool fail (int line, const std::string& error);
+
+    std::string lastError;
+};
+
+#endif  // ARRAYGEOMETRY_H_INCLUDED
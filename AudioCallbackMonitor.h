@@ -0,0 +1,109 @@
+#ifndef AUDIOCALLBACKMONITOR_H_INCLUDED
+#define AUDIOCALLBACKMONITOR_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PipelineProfiler.h"
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Times every audio callback and counts overruns.
+
+  An overrun is a callback that took longer than the audio it was handed
+  lasts, i.e. one that would have caused an xrun on its own. Written only
+  by the audio thread, read from anywhere. Every callback's time also goes
+  into PipelineProfiler's audioCallback histogram, from the same two clock
+  reads.
+
+  usage:
+    AudioCallbackMonitor::ScopedTimer timer (monitor, bufferToFill.numSamples);
+
+ */
+
+class AudioCallbackMonitor
+{
+public:
+    AudioCallbackMonitor() {}
+
+    void prepare (double sampleRateToUse)
+    {
+        sampleRate = sampleRateToUse;
+        reset();
+    }
+
+    void reset()
+    {
+        numCallbacks = 0;
+        numOverruns = 0;
+        lastMicros = 0;
+        worstMicros = 0;
+    }
+
+    void callbackFinished (int64 startTicks, int numSamples)
+    {
+        const int64 elapsedTicks = Time::getHighResolutionTicks() - startTicks;
+        const int elapsedMicros = (int) (elapsedTicks * 1000000 / Time::getHighResolutionTicksPerSecond());
+        const int budgetMicros = (int) (numSamples * 1000000.0 / sampleRate);
+
+        PANOGRAM_PROFILE_RECORD (PipelineProfiler::audioCallback,
+                                 (uint64) (elapsedTicks * 1.0e9 / Time::getHighResolutionTicksPerSecond()));
+
+        ++numCallbacks;
+        lastMicros = elapsedMicros;
+
+        if (elapsedMicros > worstMicros.get())
+            worstMicros = elapsedMicros;
+
+        if (elapsedMicros > budgetMicros)
+            ++numOverruns;
+    }
+
+    int getNumCallbacks() const     { return numCallbacks.get(); }
+    int getNumOverruns() const      { return numOverruns.get(); }
+    int getLastMicros() const       { return lastMicros.get(); }
+    int getWorstMicros() const      { return worstMicros.get(); }
+
+    String getReport() const
+    {
+        return "audio callback: " + String (getNumCallbacks()) + " calls, "
+             + String (getNumOverruns()) + " overruns, last "
+             + String (getLastMicros()) + " us, worst "
+             + String (getWorstMicros()) + " us";
+    }
+
+    //==========================================================================
+
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer (AudioCallbackMonitor& monitorToUse, int numSamplesToTime)
+            : monitor (monitorToUse), numSamples (numSamplesToTime), startTicks (Time::getHighResolutionTicks())
+        {
+        }
+
+        ~ScopedTimer()
+        {
+            monitor.callbackFinished (startTicks, numSamples);
+        }
+
+    private:
+        AudioCallbackMonitor& monitor;
+        int numSamples;
+        int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedTimer)
+    };
+
+private:
+    double sampleRate = 44100.0;
+
+    Atomic<int> numCallbacks;
+    Atomic<int> numOverruns;
+    Atomic<int> lastMicros;
+    Atomic<int> worstMicros;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioCallbackMonitor)
+};
+
+#endif  // AUDIOCALLBACKMONITOR_H_INCLUDED
@@ -0,0 +1,58 @@
+#ifndef AUDIOFILESOURCE_H_INCLUDED
+#define AUDIOFILESOURCE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ParallelOfflineAnalyser.h"
+
+//----------------------------------------------------------------------------//
+
+/* Any file JUCE can decode. Reads straight into the analyser's block
+   buffers, no intermediate copy. */
+
+class AudioFileSource : public MultichannelSource
+{
+public:
+    AudioFileSource (AudioFormatReader* readerToUse) : reader (readerToUse) {}
+
+    int getNumChannels() const override             { return (int) reader->numChannels; }
+    int64_t getLengthInSamples() const override     { return reader->lengthInSamples; }
+    double getSampleRate() const override           { return reader->sampleRate; }
+
+    bool read (float* const* dest, int64_t startSample, int numSamples) override
+    {
+        AudioSampleBuffer buffer (dest, getNumChannels(), numSamples);
+        reader->read (&buffer, 0, numSamples, startSample, true, true);
+        return true;
+    }
+
+private:
+    ScopedPointer<AudioFormatReader> reader;
+};
+
+/* One reader per worker thread, all on the same file. */
+
+class AudioFileSourceFactory : public MultichannelSourceFactory
+{
+public:
+    AudioFileSourceFactory (AudioFormatManager& formatManagerToUse, const File& fileToUse)
+        : formatManager (formatManagerToUse), file (fileToUse)
+    {
+    }
+
+    MultichannelSource* createSource() override
+    {
+        const ScopedLock sl (lock);     // AudioFormatManager isn't thread-safe
+
+        if (AudioFormatReader* reader = formatManager.createReaderFor (file))
+            return new AudioFileSource (reader);
+
+        return nullptr;
+    }
+
+private:
+    AudioFormatManager& formatManager;
+    File file;
+    CriticalSection lock;
+};
+
+#endif  // AUDIOFILESOURCE_H_INCLUDED
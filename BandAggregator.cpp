@@ -0,0 +1,178 @@
+#include "BandAggregator.h"
+
+#include <cmath>
+#include <cstring>
+
+//----------------------------------------------------------------------------//
+
+namespace
+{
+    // Glasberg & Moore's ERB-number scale, and the mel scale
+    double hzToErb (double hz)      { return 21.4 * std::log10 (1.0 + 0.00437 * hz); }
+    double erbToHz (double erbs)    { return (std::pow (10.0, erbs / 21.4) - 1.0) / 0.00437; }
+    double hzToMel (double hz)      { return 2595.0 * std::log10 (1.0 + hz / 700.0); }
+    double melToHz (double mels)    { return 700.0 * (std::pow (10.0, mels / 2595.0) - 1.0); }
+
+    /* sum w * m^2, 8 lanes at a time, so it vectorises without -ffast-math. */
+    float weightedPower (const float* __restrict w, const float* __restrict m, int n)
+    {
+        float lanes[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        int i = 0;
+
+        for (; i + 8 <= n; i += 8)
+            for (int j = 0; j < 8; j++)
+                lanes[j] += w[i + j] * m[i + j] * m[i + j];
+
+        float sum = 0.0f;
+        for (; i < n; i++)
+            sum += w[i] * m[i] * m[i];
+
+        for (int j = 0; j < 8; j++)
+            sum += lanes[j];
+
+        return sum;
+    }
+}
+
+void BandAggregator::prepare (Scale newScale, int newNumBins, double sampleRate, float minHz, float maxHz)
+{
+    scale = newScale;
+    numBins = newNumBins;
+
+    firstBin.clear();
+    weightStart.assign (1, 0);
+    weights.clear();
+    centreHz.clear();
+
+    // the range in bins, where bin i covers i - 0.5 .. i + 0.5; at least one bin
+    const double binHz = sampleRate / (2.0 * numBins);
+    const double lowHz = std::fmax (0.0, (double) minHz);
+    const double highHz = std::fmax (lowHz + binHz, (double) maxHz);
+
+    const double low = std::fmin (numBins - 1.5, std::fmax (-0.5, lowHz / binHz));
+    const double high = std::fmin (numBins - 0.5, std::fmax (low + 1.0, highHz / binHz));
+
+    if (scale == bins)
+    {
+        for (int i = (int) std::ceil (low); i <= (int) std::floor (high); i++)
+            addBand (i - 0.5, i + 0.5, (float) (i * binHz));
+    }
+    else
+    {
+        // band edges in Hz over the range, the first and last clipped to it
+        std::vector<double> edges (1, lowHz);
+
+        if (scale == thirdOctave)
+        {
+            // centres 1000 * 2^(k/3), edges a sixth of an octave either side
+            const double lowest = std::fmax (lowHz, 1.0);
+            for (int k = (int) std::ceil (3.0 * std::log2 (lowest / 1000.0)); 1000.0 * std::exp2 (k / 3.0) < highHz; k++)
+            {
+                const double upper = 1000.0 * std::exp2 ((k + 0.5) / 3.0);
+
+                if (upper > lowHz && upper < highHz)
+                    edges.push_back (upper);
+            }
+        }
+        else
+        {
+            const bool useErb = scale == erb;
+            const double from = useErb ? hzToErb (lowHz) : hzToMel (lowHz);
+            const double to = useErb ? hzToErb (highHz) : hzToMel (highHz);
+            const int numBands = useErb ? (int) std::fmax (1.0, std::floor (to - from + 0.5)) : (int) numMelBands;
+
+            for (int k = 1; k < numBands; k++)
+            {
+                const double position = from + (to - from) * k / numBands;
+                edges.push_back (useErb ? erbToHz (position) : melToHz (position));
+            }
+        }
+
+        edges.push_back (highHz);
+
+        // into bins, merging bands until each covers a bin
+        std::vector<double> kept (1, low);
+
+        for (size_t j = 1; j + 1 < edges.size(); j++)
+        {
+            const double edge = edges[j] / binHz;
+
+            if (edge - kept.back() >= 1.0 && high - edge >= 1.0)
+                kept.push_back (edge);
+        }
+
+        kept.push_back (high);
+
+        for (size_t j = 0; j + 1 < kept.size(); j++)
+        {
+            const double lowEdgeHz = std::fmax (0.0, kept[j] * binHz);
+            const double highEdgeHz = kept[j + 1] * binHz;
+            const double centre = lowEdgeHz > 0.0 ? std::sqrt (lowEdgeHz * highEdgeHz) : 0.5 * highEdgeHz;
+
+            addBand (kept[j], kept[j + 1], (float) centre);
+        }
+    }
+
+    // channels aren't known until the first frame
+    bandFrame.allocate (bandFrame.numChannels, getNumBands());
+}
+
+void BandAggregator::addBand (double lowBin, double highBin, float centre)
+{
+    // every bin overlapping the band, weighted by how much of it is inside
+    int first = (int) std::floor (lowBin + 0.5);
+    int last = (int) std::floor (highBin + 0.5);
+
+    if (first < 0)
+        first = 0;
+
+    if (last > numBins - 1)
+        last = numBins - 1;
+
+    while (first < last && std::fmin (first + 0.5, highBin) - std::fmax (first - 0.5, lowBin) < 1.0e-6)
+        first++;
+
+    while (last > first && std::fmin (last + 0.5, highBin) - std::fmax (last - 0.5, lowBin) < 1.0e-6)
+        last--;
+
+    for (int i = first; i <= last; i++)
+        weights.push_back ((float) (std::fmin (i + 0.5, highBin) - std::fmax (i - 0.5, lowBin)));
+
+    firstBin.push_back (first);
+    weightStart.push_back ((int) weights.size());
+    centreHz.push_back (centre);
+}
+
+void BandAggregator::process (const SpectrumFrame& frame)
+{
+    if (bandFrame.numChannels != frame.numChannels)
+        bandFrame.allocate (frame.numChannels, getNumBands());
+
+    const int numBands = getNumBands();
+
+    for (int ch = 0; ch < frame.numChannels; ch++)
+    {
+        const float* magnitudes = frame.getChannel (ch);
+        float* out = bandFrame.getChannel (ch);
+
+        // one bin per band: nothing to sum
+        if (scale == bins)
+        {
+            std::memcpy (out, magnitudes + firstBin[0], numBands * sizeof (float));
+            continue;
+        }
+
+        for (int b = 0; b < numBands; b++)
+            out[b] = std::sqrt (weightedPower (weights.data() + weightStart[b], magnitudes + firstBin[b],
+                                               weightStart[b + 1] - weightStart[b]));
+    }
+
+    bandFrame.sequence = frame.sequence;
+}
+
+const char* BandAggregator::getScaleName (Scale scale)
+{
+    static const char* const names[numScales] = { "bins", "1/3 octave", "ERB", "mel" };
+
+    return names[scale];
+}
@@ -0,0 +1,95 @@
+#ifndef BANDAGGREGATOR_H_INCLUDED
+#define BANDAGGREGATOR_H_INCLUDED
+
+#include "SpectrumFrame.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Folds fft bins into frequency bands before localizing, so the panogram
+  draws a few dozen band points instead of hundreds of noisy bins.
+
+  Each band's level is the square root of the summed power of its bins,
+  per channel, so a band reads like the output of a filter bank and level
+  ratios between mics stay energy-weighted. The bins go through a sparse
+  matrix built once in prepare(): every band is a run of neighbouring bins
+  with a weight each. A bin that straddles a band edge is split between the
+  two bands by how much of it falls in each, so within the range every
+  bin's weights add up to 1 and no power is counted twice or lost.
+
+  scales:
+    bins         every bin in the range on its own (weight 1), for the
+                 plain fft view over a limited range
+    thirdOctave  1/3 octave bands on the nominal 1 kHz series
+    erb          one ERB (Glasberg & Moore) per band
+    mel          40 bands of equal width in mel over the range
+
+  note:
+  - bins are the first half of an fft of 2 * numBins, like GeometryLocalizer
+    assumes
+  - bands narrower than one bin (the lowest ones at small ffts) are merged
+    with the bands above them until each covers at least a bin
+  - process() doesn't allocate once prepare() and the channel count match;
+    the band frame's magnitudes only, no complex bins, so TDOA stays per bin
+
+ */
+
+class BandAggregator
+{
+public:
+    enum Scale
+    {
+        bins = 0,
+        thirdOctave,
+        erb,
+        mel,
+        numScales
+    };
+
+    enum { numMelBands = 40 };
+
+    BandAggregator() {}
+
+    /* Builds the band matrix for numBins fft bins at sampleRate, keeping
+       minHz..maxHz. Allocates. */
+    void prepare (Scale scale, int numBins, double sampleRate, float minHz, float maxHz);
+
+    Scale getScale() const                          { return scale; }
+    int getNumBins() const                          { return numBins; }
+    int getNumBands() const                         { return (int) centreHz.size(); }
+
+    /* Per band: where it sits (for the geometry eq), and its row of the matrix. */
+    const float* getCentreHz() const                { return centreHz.data(); }
+    int getFirstBin (int band) const                { return firstBin[band]; }
+    int getNumBinsInBand (int band) const           { return weightStart[band + 1] - weightStart[band]; }
+    const float* getWeights (int band) const        { return weights.data() + weightStart[band]; }
+
+    /* Band levels of every channel. frame.numBins must match prepare(). */
+    void process (const SpectrumFrame& frame);
+
+    /* The bands, as a frame the localizers take like any other. */
+    const SpectrumFrame& getFrame() const           { return bandFrame; }
+
+    static const char* getScaleName (Scale scale);
+
+private:
+    void addBand (double lowBin, double highBin, float centre);
+
+    Scale scale = bins;
+    int numBins = 0;
+
+    std::vector<int> firstBin;          // [band]
+    std::vector<int> weightStart;       // [band + 1], into weights
+    std::vector<float> weights;         // every band's run of bin weights, one after the other
+    std::vector<float> centreHz;        // [band]
+
+    SpectrumFrame bandFrame;
+
+    BandAggregator (const BandAggregator&);
+    BandAggregator& operator= (const BandAggregator&);
+};
+
+#endif  // BANDAGGREGATOR_H_INCLUDED
@@ -0,0 +1,257 @@
+/*
+  ==============================================================================
+
+ Benchmark for BandAggregator.
+
+ Checks the band matrix for every scale and fft size: no bin weighs more
+ than 1 in total, every bin between the first and last band weighs exactly
+ 1, every band covers at least a bin and the centres go up.
+
+ Then a broadband source (pink, moving from frame to frame) over the 3x3
+ grid, with independent noise on every mic and bin, 0 dB per bin at 1 kHz.
+ For bins and for each scale over 50 Hz..16 kHz: the display work per
+ frame (aggregate, localize with GridLocalizer, track, add to the
+ rasterizer; the rasterizer's per-pixel render is the same either way and
+ left out), how many points are drawn, and their rms distance from the
+ source. Bands must be at least 5x cheaper than bins at fft 2048 and
+ closer to the source.
+
+ build (no JUCE needed):
+   c++ -O3 -std=c++11 -I.. BandAggregatorBenchmark.cpp ../BandAggregator.cpp ../GridLocalizer.cpp
+       ../QuadLocalizer.cpp ../SourceTracker.cpp ../PanogramRasterizer.cpp ../DSPKernels.cpp -o BandAggregatorBenchmark
+
+  ==============================================================================
+*/
+
+#include "../BandAggregator.h"
+#include "../GridLocalizer.h"
+#include "../PanogramRasterizer.h"
+#include "../SourceTracker.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+template <typename Function>
+static double microsPerFrame (Function process)
+{
+    int iterations = 10;
+    for (;;)
+    {
+        const Clock::time_point start = Clock::now();
+
+        for (int i = 0; i < iterations; i++)
+            process();
+
+        const double us = std::chrono::duration<double, std::micro> (Clock::now() - start).count();
+
+        if (us > 5.0e4)
+            return us / iterations;
+
+        iterations *= 4;
+    }
+}
+
+static int checkMatrix (BandAggregator::Scale scale, int numBins)
+{
+    BandAggregator bands;
+    bands.prepare (scale, numBins, 44100.0, 50.0f, 16000.0f);
+
+    std::vector<double> total (numBins, 0.0);
+    int failures = 0;
+
+    for (int b = 0; b < bands.getNumBands(); b++)
+    {
+        double width = 0.0;
+
+        for (int i = 0; i < bands.getNumBinsInBand (b); i++)
+        {
+            total[bands.getFirstBin (b) + i] += bands.getWeights (b)[i];
+            width += bands.getWeights (b)[i];
+        }
+
+        if (width < 1.0 - 1.0e-5 || (b > 0 && bands.getCentreHz()[b] <= bands.getCentreHz()[b - 1]))
+            failures++;
+    }
+
+    const int last = bands.getNumBands() - 1;
+    const int firstBin = bands.getFirstBin (0);
+    const int lastBin = bands.getFirstBin (last) + bands.getNumBinsInBand (last) - 1;
+
+    for (int i = 0; i < numBins; i++)
+    {
+        if (total[i] > 1.0 + 1.0e-5 || (i > firstBin && i < lastBin && std::fabs (total[i] - 1.0) > 1.0e-5))
+            failures++;
+    }
+
+    if (failures > 0)
+        std::printf ("%s at %d bins: %d bad bins or bands\n", BandAggregator::getScaleName (scale), numBins, failures);
+
+    return failures > 0 ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------//
+
+/* 9 channels, one broadband source somewhere over the array, plus noise.
+   A few dozen frames made up front, so the timing is all aggregator. */
+
+struct NoisyGrid
+{
+    enum { numFrames = 32 };
+
+    NoisyGrid (int numBinsToUse) : numBins (numBinsToUse), frames (new SpectrumFrame[numFrames])
+    {
+        std::mt19937 random (3);
+        std::uniform_real_distribution<float> position (0.1f, 0.9f);
+        std::normal_distribution<float> noise (0.0f, 1.0f);
+
+        for (int f = 0; f < numFrames; f++)
+        {
+            SpectrumFrame& frame = frames[f];
+            frame.allocate (9, numBins);
+            frame.sequence = f + 1;
+
+            sourceX[f] = position (random);
+            sourceY[f] = position (random);
+
+            for (int row = 0; row < 3; row++)
+            {
+                for (int column = 0; column < 3; column++)
+                {
+                    const float dx = 0.5f * column - sourceX[f];
+                    const float dy = 0.5f * row - sourceY[f];
+                    const float level = 0.5f / (std::sqrt (dx * dx + dy * dy) + 0.15f);
+
+                    float* m = frame.getChannel (GridLocalizer::layout[row][column]);
+
+                    for (int i = 0; i < numBins; i++)
+                    {
+                        // pink: amplitude falls as 1 / sqrt (f), 1 at 1 kHz; noise 1 per bin
+                        const float hz = (i + 0.5f) * 22050.0f / numBins;
+                        const float amplitude = level * std::sqrt (1000.0f / hz);
+                        const float re = amplitude + noise (random), im = noise (random);
+
+                        m[i] = std::sqrt (re * re + im * im);
+                    }
+                }
+            }
+        }
+    }
+
+    const SpectrumFrame& next()
+    {
+        current = (current + 1) % numFrames;
+        return frames[current];
+    }
+
+    int numBins;
+    std::unique_ptr<SpectrumFrame[]> frames;
+    float sourceX[numFrames], sourceY[numFrames];
+    int current = 0;
+};
+
+static double rmsError (const LocalizationFrame& frame, float x, float y)
+{
+    double sum = 0.0;
+
+    for (int i = 0; i < frame.numBins; i++)
+        sum += (frame.x[i] - x) * (frame.x[i] - x) + (frame.y[i] - y) * (frame.y[i] - y);
+
+    return std::sqrt (sum / frame.numBins);
+}
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    int failures = 0;
+
+    for (int s = 0; s < BandAggregator::numScales; s++)
+        for (int order = 8; order <= 13; order++)
+            failures += checkMatrix ((BandAggregator::Scale) s, 1 << (order - 1));
+
+    std::printf ("%-6s %-12s %8s %12s %10s %10s\n", "fft", "mode", "points", "us/frame", "speedup", "rms error");
+
+    for (int order = 10; order <= 12; order++)
+    {
+        const int numBins = 1 << (order - 1);
+        NoisyGrid grid (numBins);
+
+        double binsMicros = 0.0, binsError = 0.0;
+
+        for (int s = -1; s < BandAggregator::numScales; s++)
+        {
+            // -1: the plain fft bins, no aggregator at all
+            BandAggregator bands;
+            if (s >= 0)
+                bands.prepare ((BandAggregator::Scale) s, numBins, 44100.0, 50.0f, 16000.0f);
+
+            GridLocalizer localizer;
+            SourceTracker tracker;
+            PanogramRasterizer rasterizer;
+            rasterizer.setSize (400, 400);
+
+            // the same frames untimed, for the error
+            double error = 0.0;
+
+            for (int f = 0; f < NoisyGrid::numFrames; f++)
+            {
+                const SpectrumFrame& frame = grid.next();
+
+                if (s >= 0)
+                    bands.process (frame);
+
+                localizer.process (s >= 0 ? bands.getFrame() : frame);
+                error += rmsError (localizer.getFrame(), grid.sourceX[grid.current], grid.sourceY[grid.current]) / NoisyGrid::numFrames;
+            }
+
+            const double micros = microsPerFrame ([&]
+            {
+                const SpectrumFrame& input = grid.next();
+
+                if (s >= 0)
+                    bands.process (input);
+
+                localizer.process (s >= 0 ? bands.getFrame() : input);
+                tracker.process (localizer.getFrame());
+
+                const LocalizationFrame frame = tracker.getFrame();
+
+                if (rasterizer.getNumBins() != frame.numBins)
+                    rasterizer.setNumBins (frame.numBins);
+
+                rasterizer.addFrame (frame.x, frame.y, frame.gain, frame.numBins);
+            });
+
+            const int numPoints = s >= 0 ? bands.getNumBands() : numBins;
+            const char* name = s >= 0 ? BandAggregator::getScaleName ((BandAggregator::Scale) s) : "fft bins";
+
+            if (s < 0)
+            {
+                binsMicros = micros;
+                binsError = error;
+            }
+
+            std::printf ("%-6d %-12s %8d %12.2f %9.1fx %10.3f\n", 2 * numBins, name, numPoints, micros, binsMicros / micros, error);
+
+            // the bins scale is the fft over a range: cheaper, but no less noisy
+            if (s > BandAggregator::bins && (error >= binsError || (order == 11 && binsMicros / micros < 5.0)))
+            {
+                std::printf ("  %s isn't cheaper and cleaner than the bins\n", name);
+                failures++;
+            }
+        }
+    }
+
+    if (failures > 0)
+        std::printf ("\n%d check(s) failed\n", failures);
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+/*
+  ==============================================================================
+
+ Simulation of the display's pacing (FramePacer, driven the way
+ RenderScheduler drives it) against a made-up message thread.
+
+ Frames are published at a steady rate and each triggers the scheduler,
+ which renders now or starts a one-shot timer for the rest of the interval.
+ A render costs a fixed part plus a part that scales with the pixels drawn,
+ and holds the message thread for as long. Per scenario: renders per second,
+ the share of the message thread they took, wakeups (scheduler callbacks)
+ per second and the resolution divisor at the end.
+
+ checks:
+   idle       no frames: no wakeups, no renders
+   light      86 frames/s at 2 ms: every render the display allows (55..60/s)
+   slow       86 frames/s at 20 ms: rate backs off to keep within the
+              budget, full resolution
+   heavy      43 frames/s at 80 ms full resolution: resolution drops, rate
+              stays at 15/s or more, within the budget
+   recovery   heavy for 10 s, then light: back to full resolution
+
+ build (no JUCE needed):
+   c++ -O2 -std=c++11 -I.. FramePacerBenchmark.cpp ../FramePacer.cpp -o FramePacerBenchmark
+
+  ==============================================================================
+*/
+
+#include "../FramePacer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+//----------------------------------------------------------------------------//
+
+struct Scenario
+{
+    const char* name;
+    double frameHz;         // 0 = no frames at all
+    double fixedMs;         // localize and track, whatever the resolution
+    double pixelMs;         // rasterize and paint at full resolution
+    double lightAfterSeconds;   // from then on pixelMs is 1, 0 = never
+    double seconds;
+};
+
+struct Result
+{
+    double rendersPerSecond = 0.0;
+    double busyShare = 0.0;
+    double wakeupsPerSecond = 0.0;
+    int divisor = 1;
+};
+
+static Result simulate (const Scenario& scenario, FramePacer& pacer)
+{
+    const double never = std::numeric_limits<double>::infinity();
+    const double endMs = scenario.seconds * 1000.0;
+
+    double now = 0.0;
+    double nextFrameMs = scenario.frameHz > 0.0 ? 0.0 : never;
+    double timerMs = never;
+    bool triggered = false;     // an async update is pending
+    bool newFrame = false;      // something published since the last render
+
+    int renders = 0, wakeups = 0;
+    double busyMs = 0.0;
+
+    pacer.reset();
+
+    auto render = [&]
+    {
+        if (! newFrame)
+            return;
+
+        newFrame = false;
+
+        const double pixelMs = (scenario.lightAfterSeconds > 0.0 && now > scenario.lightAfterSeconds * 1000.0)
+                                 ? 1.0 : scenario.pixelMs;
+        const double divisor = pacer.getResolutionDivisor();
+        const double cost = scenario.fixedMs + pixelMs / (divisor * divisor);
+
+        pacer.addRender (now, cost);
+        now += cost;
+        busyMs += cost;
+        renders++;
+    };
+
+    for (;;)
+    {
+        // the message thread gets to the async update as soon as it's free
+        if (triggered)
+        {
+            triggered = false;
+            wakeups++;
+
+            if (timerMs == never)
+            {
+                const double wait = pacer.getNextRenderMs() - now;
+
+                if (wait >= 1.0)
+                    timerMs = now + std::floor (wait + 0.5);
+                else
+                    render();
+            }
+
+            continue;
+        }
+
+        const double next = nextFrameMs < timerMs ? nextFrameMs : timerMs;
+        if (next >= endMs)
+            break;
+
+        // frames published while a render held the thread are seen after it
+        if (next > now)
+            now = next;
+
+        if (nextFrameMs <= timerMs)
+        {
+            newFrame = true;
+            triggered = true;
+            nextFrameMs += 1000.0 / scenario.frameHz;
+        }
+        else
+        {
+            timerMs = never;
+            wakeups++;
+            render();
+        }
+    }
+
+    Result result;
+    result.rendersPerSecond = renders / scenario.seconds;
+    result.busyShare = busyMs / endMs;
+    result.wakeupsPerSecond = wakeups / scenario.seconds;
+    result.divisor = pacer.getResolutionDivisor();
+    return result;
+}
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    const Scenario scenarios[] =
+    {
+        { "idle",      0.0,  2.0,  0.0,  0.0, 20.0 },
+        { "light",    86.0,  1.0,  1.0,  0.0, 20.0 },
+        { "slow",     86.0,  5.0, 15.0,  0.0, 20.0 },
+        { "heavy",    43.0,  4.0, 76.0,  0.0, 20.0 },
+        { "recovery", 43.0,  4.0, 76.0, 10.0, 40.0 }
+    };
+
+    FramePacer pacer;
+    pacer.setRefreshRate (60.0);
+    pacer.setBudget (0.5);
+    pacer.setMinimumRate (15.0);
+
+    int failures = 0;
+
+    std::printf ("%-10s %10s %10s %12s %10s %10s\n", "scenario", "frames/s", "renders/s", "thread use", "wakeups/s", "divisor");
+
+    for (const Scenario& scenario : scenarios)
+    {
+        const Result r = simulate (scenario, pacer);
+
+        std::printf ("%-10s %10.0f %10.1f %11.1f%% %10.1f %10d\n", scenario.name, scenario.frameHz,
+                     r.rendersPerSecond, 100.0 * r.busyShare, r.wakeupsPerSecond, r.divisor);
+
+        const bool withinBudget = r.busyShare <= 0.55;
+        bool ok = true;
+
+        switch (&scenario - scenarios)
+        {
+            case 0:  ok = r.wakeupsPerSecond == 0.0 && r.rendersPerSecond == 0.0; break;
+            case 1:  ok = r.rendersPerSecond >= 55.0 && r.rendersPerSecond <= 60.5 && r.divisor == 1; break;
+            case 2:  ok = withinBudget && r.rendersPerSecond >= 15.0 && r.rendersPerSecond < 40.0 && r.divisor == 1; break;
+            case 3:  ok = withinBudget && r.rendersPerSecond >= 15.0 && r.divisor > 1; break;
+            default: ok = r.divisor == 1; break;
+        }
+
+        if (! ok)
+        {
+            std::printf ("  %s isn't paced as it should be\n", scenario.name);
+            failures++;
+        }
+    }
+
+    if (failures > 0)
+        std::printf ("\n%d check(s) failed\n", failures);
+
+    return failures > 0 ? 1 : 0;
+}
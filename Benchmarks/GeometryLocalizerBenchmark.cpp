@@ -0,0 +1,245 @@
+/*
+  ==============================================================================
+
+ Benchmark for GeometryLocalizer.
+
+ On the 3x3 array: microseconds per frame and mean position error of the
+ hard-coded 4-channel UDLR path (QuadLocalizer), of GridLocalizer and of
+ the geometry engine at each sharpness. Then the engine alone on 4x4 and
+ 5x5 grids. Sources as in GridLocalizerBenchmark: one point source per bin,
+ each mic hearing 1 / (distance + 0.15).
+
+ Also checks that a geometry file parses (and a broken one doesn't), and
+ that the compiled tables, with a gain and an eq in them, give the same
+ answer as evaluating the formula directly.
+
+ build (no JUCE needed):
+   c++ -O3 -std=c++11 -I.. GeometryLocalizerBenchmark.cpp ../GeometryLocalizer.cpp ../ArrayGeometry.cpp
+       ../GridLocalizer.cpp ../QuadLocalizer.cpp ../DSPKernels.cpp -o GeometryLocalizerBenchmark
+
+  ==============================================================================
+*/
+
+#include "../GeometryLocalizer.h"
+#include "../GridLocalizer.h"
+#include "../QuadLocalizer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+/* Magnitudes for every channel of a geometry, one point source per bin,
+   positions in the 0..1 box the localizer maps the array onto. */
+
+struct SyntheticArray
+{
+    SyntheticArray (const ArrayGeometry& geometry, int numBinsToUse)
+        : numBins (numBinsToUse), numChannels (geometry.getNumChannelsNeeded()),
+          magnitudes ((size_t) numChannels * numBins), sourceX (numBins), sourceY (numBins)
+    {
+        float maxX = 0.0f, maxY = 0.0f;
+        for (const ArrayMic& mic : geometry.mics)
+        {
+            maxX = std::fmax (maxX, mic.x);
+            maxY = std::fmax (maxY, mic.y);
+        }
+
+        std::srand (7);
+
+        for (int i = 0; i < numBins; i++)
+        {
+            sourceX[i] = 0.05f + 0.9f * std::rand() / RAND_MAX;
+            sourceY[i] = 0.05f + 0.9f * std::rand() / RAND_MAX;
+            const float amplitude = 1.0f + 20.0f * std::rand() / RAND_MAX;
+
+            for (const ArrayMic& mic : geometry.mics)
+            {
+                const float dx = mic.x / maxX - sourceX[i];
+                const float dy = mic.y / maxY - sourceY[i];
+                magnitudes[(size_t) mic.channel * numBins + i] = amplitude / (std::sqrt (dx * dx + dy * dy) + 0.15f);
+            }
+        }
+
+        for (int ch = 0; ch < numChannels; ch++)
+            pointers.push_back (&magnitudes[(size_t) ch * numBins]);
+    }
+
+    float meanError (const LocalizationFrame& frame) const
+    {
+        double sum = 0.0;
+
+        for (int i = 0; i < numBins; i++)
+            sum += std::hypot (frame.x[i] - sourceX[i], frame.y[i] - sourceY[i]);
+
+        return (float) (sum / numBins);
+    }
+
+    int numBins, numChannels;
+    std::vector<float> magnitudes;
+    std::vector<const float*> pointers;
+    std::vector<float> sourceX, sourceY;
+};
+
+template <typename Function>
+static double microsPerFrame (Function process)
+{
+    int iterations = 100;
+    for (;;)
+    {
+        const Clock::time_point start = Clock::now();
+
+        for (int i = 0; i < iterations; i++)
+            process();
+
+        const double us = std::chrono::duration<double, std::micro> (Clock::now() - start).count();
+
+        if (us > 5.0e4)
+            return us / iterations;
+
+        iterations *= 4;
+    }
+}
+
+//----------------------------------------------------------------------------//
+
+static const char* testFile =
+    "# test array\n"
+    "name corrected 3x3\n"
+    "sharpness 4\n"
+    "mic 3 0 0\n"
+    "mic 6 1 0   1.5     # a hot one\n"
+    "mic 7 2 0\n"
+    "mic 2 0 1\n"
+    "mic 5 1 1\n"
+    "mic 8 2 1\n"
+    "mic 1 0 2\n"
+    "mic 4 1 2  -2\n"
+    "mic 9 2 2\n"
+    "eq 5 100 -3 1000 0 8000 4\n";
+
+static int checkParsingAndTables()
+{
+    int failures = 0;
+
+    ArrayGeometry broken;
+    if (broken.parse ("mic 1 0 0\nmic 2 1 0\nmicrophone 3 2 0\n") || broken.getLastError().find ("line 3") != 0)
+    {
+        std::printf ("broken geometry wasn't caught (%s)\n", broken.getLastError().c_str());
+        failures++;
+    }
+
+    ArrayGeometry geometry;
+    if (! geometry.parse (testFile) || geometry.mics.size() != 9 || geometry.name != "corrected 3x3")
+    {
+        std::printf ("test geometry didn't parse: %s\n", geometry.getLastError().c_str());
+        return failures + 1;
+    }
+
+    const int numBins = 512;
+    const double sampleRate = 44100.0;
+    SyntheticArray array (geometry, numBins);
+
+    GeometryLocalizer localizer;
+    localizer.prepare (geometry, numBins, sampleRate);
+    localizer.process (array.pointers.data());
+
+    // the formula straight, in double
+    float maxDiff = 0.0f;
+
+    for (int i = 0; i < numBins; i++)
+    {
+        double den = 0.0, xSum = 0.0, ySum = 0.0;
+
+        for (const ArrayMic& mic : geometry.mics)
+        {
+            const double gain = std::pow (10.0, geometry.getGainDb (mic, (float) (i * sampleRate / (2.0 * numBins))) / 20.0);
+            const double f = std::pow (gain * array.pointers[mic.channel][i], (double) geometry.sharpness);
+
+            den += f;
+            xSum += f * mic.x / 2.0;
+            ySum += f * mic.y / 2.0;
+        }
+
+        maxDiff = std::fmax (maxDiff, (float) std::fabs (localizer.getFrame().x[i] - xSum / den));
+        maxDiff = std::fmax (maxDiff, (float) std::fabs (localizer.getFrame().y[i] - ySum / den));
+    }
+
+    std::printf ("compiled tables vs direct formula (gain + eq): max diff %.2g\n\n", maxDiff);
+
+    if (maxDiff > 1.0e-4f)
+        failures++;
+
+    return failures;
+}
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    int failures = checkParsingAndTables();
+
+    const int numBins = 512;
+
+    std::printf ("%-8s %-26s %10s %9s %12s\n", "array", "localizer", "us/frame", "vs udlr", "mean error");
+
+    // 3x3, against the hard-coded paths
+    {
+        const ArrayGeometry geometry = ArrayGeometry::makeDefault();
+        const SyntheticArray array (geometry, numBins);
+
+        QuadLocalizer udlr (5, 3, 1, 7, QuadLocalizer::udlr);
+        udlr.setNumBins (numBins);
+        const double udlrUs = microsPerFrame ([&] { udlr.process (array.pointers.data()); });
+        std::printf ("%-8s %-26s %10.2f %8.2fx %12.3f\n", "3x3", "udlr (hard-coded, 4 ch)", udlrUs, 1.0, array.meanError (udlr.getFrame()));
+
+        GridLocalizer grid;
+        grid.setNumBins (numBins);
+        const double gridUs = microsPerFrame ([&] { grid.process (array.pointers.data()); });
+        std::printf ("%-8s %-26s %10.2f %8.2fx %12.3f\n", "3x3", "grid (hard-coded, 9 ch)", gridUs, gridUs / udlrUs, array.meanError (grid.getFrame()));
+
+        const int sharpnesses[] = { 1, 2, 4, 8 };
+        for (int sharpness : sharpnesses)
+        {
+            ArrayGeometry sharpened = geometry;
+            sharpened.sharpness = sharpness;
+
+            GeometryLocalizer localizer;
+            localizer.prepare (sharpened, numBins, 44100.0);
+
+            const double us = microsPerFrame ([&] { localizer.process (array.pointers.data()); });
+            char label[64];
+            std::snprintf (label, sizeof (label), "geometry, sharpness %d", sharpness);
+            std::printf ("%-8s %-26s %10.2f %8.2fx %12.3f\n", "3x3", label, us, us / udlrUs, array.meanError (localizer.getFrame()));
+        }
+
+        std::printf ("\n");
+    }
+
+    // bigger grids, engine only
+    const int sizes[] = { 4, 5 };
+    for (int size : sizes)
+    {
+        const ArrayGeometry geometry = ArrayGeometry::makeGrid (size, size);
+        const SyntheticArray array (geometry, numBins);
+
+        GeometryLocalizer localizer;
+        localizer.prepare (geometry, numBins, 44100.0);
+
+        const double us = microsPerFrame ([&] { localizer.process (array.pointers.data()); });
+
+        char name[16];
+        std::snprintf (name, sizeof (name), "%dx%d", size, size);
+        std::printf ("%-8s %-26s %10.2f %9s %12.3f\n", name, "geometry, sharpness 4", us, "", array.meanError (localizer.getFrame()));
+    }
+
+    if (failures > 0)
+        std::printf ("\n%d check(s) failed\n", failures);
+
+    return failures > 0 ? 1 : 0;
+}
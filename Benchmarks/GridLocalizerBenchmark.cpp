@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+ Benchmark for GridLocalizer.
+
+ Cost: microseconds per frame for one UDLR quad (what the panogram used to
+ show), for all four sub-quads run as separate CORNERS QuadLocalizers (the
+ obvious way to use all 9 mics), and for GridLocalizer.
+
+ Accuracy: point sources at random positions over the array, each mic
+ hearing 1 / (distance + 0.15). Reports the mean position error of UDLR and
+ of the grid. Also checks the grid against a plain per-quad reference of
+ the same fusion (the shared sums and the single divide must not change
+ the answer).
+
+ build (no JUCE needed):
+   c++ -O3 -std=c++11 -I.. GridLocalizerBenchmark.cpp ../GridLocalizer.cpp ../QuadLocalizer.cpp ../DSPKernels.cpp -o GridLocalizerBenchmark
+
+  ==============================================================================
+*/
+
+#include "../GridLocalizer.h"
+#include "../QuadLocalizer.h"
+#include "../DSPKernels.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+/* 9 channels of magnitudes, one point source per bin. */
+
+struct SyntheticGrid
+{
+    SyntheticGrid (int numBinsToUse) : numBins (numBinsToUse), sourceX (numBins), sourceY (numBins)
+    {
+        for (int ch = 0; ch < 9; ch++)
+            channels[ch].allocate (numBins);
+
+        std::srand (7);
+
+        for (int i = 0; i < numBins; i++)
+        {
+            sourceX[i] = 0.05f + 0.9f * std::rand() / RAND_MAX;
+            sourceY[i] = 0.05f + 0.9f * std::rand() / RAND_MAX;
+            const float amplitude = 1.0f + 20.0f * std::rand() / RAND_MAX;
+
+            for (int row = 0; row < 3; row++)
+            {
+                for (int column = 0; column < 3; column++)
+                {
+                    const float dx = 0.5f * column - sourceX[i];
+                    const float dy = 0.5f * row - sourceY[i];
+                    channels[GridLocalizer::layout[row][column]][i] = amplitude / (std::sqrt (dx * dx + dy * dy) + 0.15f);
+                }
+            }
+        }
+
+        for (int ch = 0; ch < 9; ch++)
+            pointers[ch] = channels[ch];
+    }
+
+    int numBins;
+    AlignedBuffer<float> channels[9];
+    const float* pointers[9];
+    std::vector<float> sourceX, sourceY;
+};
+
+static float meanError (const LocalizationFrame& frame, const SyntheticGrid& grid)
+{
+    double sum = 0.0;
+
+    for (int i = 0; i < grid.numBins; i++)
+        sum += std::sqrt ((frame.x[i] - grid.sourceX[i]) * (frame.x[i] - grid.sourceX[i])
+                        + (frame.y[i] - grid.sourceY[i]) * (frame.y[i] - grid.sourceY[i]));
+
+    return (float) (sum / grid.numBins);
+}
+
+/* The fusion written out quad by quad, with a divide per quad. */
+static float maxDiffFromReference (const LocalizationFrame& frame, const SyntheticGrid& grid)
+{
+    float maxDiff = 0.0f;
+
+    for (int i = 0; i < grid.numBins; i++)
+    {
+        double total9 = 0.0;
+        for (int quadRow = 0; quadRow < 2; quadRow++)
+            for (int quadColumn = 0; quadColumn < 2; quadColumn++)
+                for (int corner = 0; corner < 4; corner++)
+                    total9 += grid.pointers[GridLocalizer::layout[quadRow + corner / 2][quadColumn + corner % 2]][i];
+
+        double sumW = 0.0, sumX = 0.0, sumY = 0.0;
+
+        for (int quadRow = 0; quadRow < 2; quadRow++)
+        {
+            for (int quadColumn = 0; quadColumn < 2; quadColumn++)
+            {
+                const float ul = grid.pointers[GridLocalizer::layout[quadRow][quadColumn]][i];
+                const float ur = grid.pointers[GridLocalizer::layout[quadRow][quadColumn + 1]][i];
+                const float ll = grid.pointers[GridLocalizer::layout[quadRow + 1][quadColumn]][i];
+                const float lr = grid.pointers[GridLocalizer::layout[quadRow + 1][quadColumn + 1]][i];
+                const double total = ul + ur + ll + lr;
+
+                const double share = total / total9;
+                const double w = std::pow (share + 0.01, 15.0) * share;
+                sumW += w;
+                sumX += w * 0.5 * (quadColumn + (ur + lr) / total);
+                sumY += w * 0.5 * (quadRow + (ll + lr) / total);
+            }
+        }
+
+        maxDiff = std::fmax (maxDiff, (float) std::fabs (frame.x[i] - sumX / sumW));
+        maxDiff = std::fmax (maxDiff, (float) std::fabs (frame.y[i] - sumY / sumW));
+    }
+
+    return maxDiff;
+}
+
+template <typename Function>
+static double microsPerFrame (Function process)
+{
+    int iterations = 100;
+    for (;;)
+    {
+        const Clock::time_point start = Clock::now();
+
+        for (int i = 0; i < iterations; i++)
+            process();
+
+        const double us = std::chrono::duration<double, std::micro> (Clock::now() - start).count();
+
+        if (us > 5.0e4)
+            return us / iterations;
+
+        iterations *= 4;
+    }
+}
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    // channels of the UDLR panogram and of the four CORNERS sub-quads
+    const int udlr[4] = { 5, 3, 1, 7 };
+    int quads[4][4];
+
+    for (int q = 0; q < 4; q++)
+    {
+        const int row = q / 2, column = q % 2;
+        quads[q][0] = GridLocalizer::layout[row][column];
+        quads[q][1] = GridLocalizer::layout[row][column + 1];
+        quads[q][2] = GridLocalizer::layout[row + 1][column];
+        quads[q][3] = GridLocalizer::layout[row + 1][column + 1];
+    }
+
+    int failures = 0;
+
+    std::printf ("%6s %-24s %10s %8s %12s\n", "bins", "localizer", "us/frame", "vs udlr", "mean error");
+
+    const int sizes[] = { 512, 2048 };
+
+    for (int numBins : sizes)
+    {
+        SyntheticGrid grid (numBins);
+
+        QuadLocalizer single (udlr[0], udlr[1], udlr[2], udlr[3], QuadLocalizer::udlr);
+        single.setNumBins (numBins);
+
+        QuadLocalizer* corners[4];
+        for (int q = 0; q < 4; q++)
+        {
+            corners[q] = new QuadLocalizer (quads[q][0], quads[q][1], quads[q][2], quads[q][3], QuadLocalizer::corners);
+            corners[q]->setNumBins (numBins);
+        }
+
+        GridLocalizer fused;
+        fused.setNumBins (numBins);
+
+        const double singleUs = microsPerFrame ([&] { single.process (grid.pointers); });
+        const double cornersUs = microsPerFrame ([&] { for (int q = 0; q < 4; q++) corners[q]->process (grid.pointers); });
+        const double fusedUs = microsPerFrame ([&] { fused.process (grid.pointers); });
+
+        single.process (grid.pointers);
+        fused.process (grid.pointers);
+
+        const float diff = maxDiffFromReference (fused.getFrame(), grid);
+        if (diff > 1.0e-4f)
+            failures++;
+
+        std::printf ("%6d %-24s %10.2f %7.2fx %12.3f\n", numBins, "udlr (1 quad)", singleUs, 1.0, meanError (single.getFrame(), grid));
+        std::printf ("%6d %-24s %10.2f %7.2fx %12s\n", numBins, "4 x corners quads", cornersUs, cornersUs / singleUs, "-");
+        std::printf ("%6d %-24s %10.2f %7.2fx %12.3f   (max diff from reference %.2g)\n\n", numBins, "grid (4 quads, fused)",
+                     fusedUs, fusedUs / singleUs, meanError (fused.getFrame(), grid), diff);
+
+        for (int q = 0; q < 4; q++)
+            delete corners[q];
+    }
+
+    if (failures > 0)
+        std::printf ("grid localizer disagrees with the per-quad reference\n");
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,410 @@
+/*
+  ==============================================================================
+
+ Benchmark for LocalizationStream.
+
+ Synthetic localizer output (two sources circling, each owning a third of
+ the bins, the rest quiet noise), smoothed by a SourceTracker as the
+ publisher does, encoded and sent over UDP on 127.0.0.1 to two viewers.
+ One of them loses 5% of its packets at random.
+
+ Checks that every bin a viewer just received decodes to the sent value
+ within the quantisation step, that the lossy viewer marks exactly the
+ bins stale that it can't have (a delta after a lost one, until the next
+ keyframe), that the sources arrive as they were sent, that truncated
+ or foreign packets are rejected, and that NaN gains and positions go out
+ as 0 like the recording writes them.
+
+ Reports bytes and packets per frame, kbit/s at 43 frames a second (44.1k,
+ hop 1024), against 12 bytes per bin for raw floats, and the encode and
+ decode cost per frame.
+
+ build (no JUCE needed, POSIX sockets):
+   c++ -O3 -std=c++11 -I.. LocalizationStreamBenchmark.cpp ../LocalizationStream.cpp ../SourceTracker.cpp
+       -o LocalizationStreamBenchmark
+
+  ==============================================================================
+*/
+
+#include "../LocalizationStream.h"
+#include "../SourceTracker.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+struct SyntheticScene
+{
+    SyntheticScene (int numBinsToUse) : numBins (numBinsToUse), random (11), x (numBins), y (numBins), gain (numBins)
+    {
+    }
+
+    LocalizationFrame next (int frameIndex)
+    {
+        std::normal_distribution<float> scatter (0.0f, 0.06f);
+        std::uniform_real_distribution<float> anywhere (0.0f, 1.0f);
+        std::uniform_real_distribution<float> loud (5.0f, 30.0f);
+        std::uniform_real_distribution<float> quiet (-30.0f, 4.0f);
+
+        for (int i = 0; i < numBins; i++)
+        {
+            const int source = 3 * i / numBins;
+
+            if (source < 2)
+            {
+                const float angle = 0.004f * frameIndex + 3.14159265f * source;
+
+                x[i] = 0.5f + 0.3f * std::cos (angle) + scatter (random);
+                y[i] = 0.5f + 0.3f * std::sin (angle) + scatter (random);
+                gain[i] = loud (random);
+            }
+            else
+            {
+                x[i] = anywhere (random);
+                y[i] = anywhere (random);
+                gain[i] = quiet (random);
+            }
+        }
+
+        LocalizationFrame frame = { numBins, x.data(), y.data(), gain.data(), gain.data() };
+        return frame;
+    }
+
+    const int numBins;
+    std::mt19937 random;
+    std::vector<float> x, y, gain;
+};
+
+//----------------------------------------------------------------------------//
+
+struct UdpSocket
+{
+    UdpSocket()
+    {
+        handle = socket (AF_INET, SOCK_DGRAM, 0);
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+        socklen_t length = sizeof (address);
+        ok = handle >= 0 && bind (handle, (sockaddr*) &address, sizeof (address)) == 0
+              && getsockname (handle, (sockaddr*) &address, &length) == 0;
+        port = ntohs (address.sin_port);
+
+        int bufferSize = 1 << 20;
+        setsockopt (handle, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof (bufferSize));
+    }
+
+    ~UdpSocket()
+    {
+        if (handle >= 0)
+            close (handle);
+    }
+
+    bool send (int toPort, const void* data, int size) const
+    {
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+        address.sin_port = htons ((uint16_t) toPort);
+
+        return sendto (handle, data, size, 0, (const sockaddr*) &address, sizeof (address)) == size;
+    }
+
+    /* -1 once nothing is waiting */
+    int receive (void* data, int size) const
+    {
+        return (int) recv (handle, data, size, MSG_DONTWAIT);
+    }
+
+    int handle = -1;
+    int port = 0;
+    bool ok = false;
+};
+
+static float clamp01 (float v)     { return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v); }
+
+/* Bins off by more than the quantisation, among those just received. */
+static int countWrongBins (const LocalizationStreamDecoder& decoder, const LocalizationFrame& sent,
+                           const std::vector<bool>& fresh, const LocalizationStreamSettings& settings)
+{
+    const LocalizationFrame received = decoder.getFrame();
+    const float maxGainDb = settings.gainMinDb + 255 * settings.gainStepDb;
+    int wrong = 0;
+
+    for (int i = 0; i < sent.numBins; i++)
+    {
+        if (! fresh[i])
+            continue;
+
+        const float expectedGain = sent.gain[i] < settings.gainMinDb ? settings.gainMinDb
+                                     : (sent.gain[i] > maxGainDb ? maxGainDb : sent.gain[i]);
+
+        if (std::fabs (received.gain[i] - expectedGain) > 0.5f * settings.gainStepDb + 1.0e-4f)
+            wrong++;
+        else if (received.gain[i] > settings.quietGainDb
+                  && (std::fabs (received.x[i] - clamp01 (sent.x[i])) > 0.5f / 255 + 1.0e-5f
+                       || std::fabs (received.y[i] - clamp01 (sent.y[i])) > 0.5f / 255 + 1.0e-5f))
+            wrong++;
+    }
+
+    return wrong;
+}
+
+//----------------------------------------------------------------------------//
+
+static int runStream (int numBins, bool report)
+{
+    int failures = 0;
+
+    const LocalizationStreamSettings settings;
+    SyntheticScene scene (numBins);
+    SourceTracker tracker;
+    tracker.prepare (numBins);
+
+    LocalizationStreamEncoder encoder;
+    encoder.prepare (numBins, settings);
+
+    UdpSocket sender, viewers[2];
+    LocalizationStreamDecoder decoders[2];
+
+    if (! sender.ok || ! viewers[0].ok || ! viewers[1].ok)
+    {
+        std::printf ("can't open loopback sockets\n");
+        return 1;
+    }
+
+    // viewer 1 loses 5% of the packets
+    std::mt19937 random (5);
+    std::uniform_real_distribution<float> chance (0.0f, 1.0f);
+
+    const int numFrames = 2000;
+    int64_t totalBytes = 0, totalPackets = 0;
+    int wrongBins[2] = { 0, 0 }, wrongStale = 0, wrongSources = 0, lostPackets = 0;
+    double encodeSeconds = 0.0, decodeSeconds = 0.0;
+    std::vector<uint8_t> buffer (65536);
+
+    // what the lossy viewer should have per packet range: a delta only applies
+    // after the one before it, a keyframe always does
+    const int numRanges = (numBins + settings.binsPerPacket - 1) / settings.binsPerPacket;
+    std::vector<bool> rangeValid (numRanges, false);
+    std::vector<int> rangeReceived (numRanges, -2);
+    std::vector<bool> fresh[2] = { std::vector<bool> (numBins, true), std::vector<bool> (numBins) };
+
+    for (int f = 0; f < numFrames; f++)
+    {
+        tracker.process (scene.next (f));
+        const LocalizationFrame frame = tracker.getFrame();
+
+        TrackedSource sources[SourceTracker::maxSources];
+        for (int k = 0; k < SourceTracker::maxSources; k++)
+            sources[k] = tracker.getSource (k);
+
+        const Clock::time_point encodeStart = Clock::now();
+        encoder.encodeFrame (frame, sources, SourceTracker::maxSources);
+        encodeSeconds += std::chrono::duration<double> (Clock::now() - encodeStart).count();
+
+        const bool keyframe = f % settings.keyframeInterval == 0;
+
+        for (int i = 0; i < encoder.getNumPackets(); i++)
+        {
+            const int size = encoder.getPacketSize (i);
+            totalBytes += size;
+            totalPackets++;
+
+            if (! sender.send (viewers[0].port, encoder.getPacket (i), size))
+                failures++;
+
+            // the sources packet is never dropped, to check it every frame
+            const int range = i - 1;
+            const bool lost = i > 0 && chance (random) < 0.05f;
+
+            if (range >= 0)
+            {
+                if (! lost)
+                {
+                    rangeValid[range] = keyframe || (rangeValid[range] && rangeReceived[range] == f - 1);
+                    rangeReceived[range] = f;
+                }
+
+                for (int b = range * settings.binsPerPacket; b < numBins && b < (range + 1) * settings.binsPerPacket; b++)
+                    fresh[1][b] = rangeValid[range] && rangeReceived[range] == f;
+            }
+
+            if (lost)
+            {
+                lostPackets++;
+                continue;
+            }
+
+            if (! sender.send (viewers[1].port, encoder.getPacket (i), size))
+                failures++;
+        }
+
+        for (int v = 0; v < 2; v++)
+        {
+            for (;;)
+            {
+                const int size = viewers[v].receive (buffer.data(), (int) buffer.size());
+                if (size < 0)
+                    break;
+
+                const Clock::time_point decodeStart = Clock::now();
+                if (! decoders[v].receive (buffer.data(), size))
+                    failures++;
+                decodeSeconds += std::chrono::duration<double> (Clock::now() - decodeStart).count();
+            }
+
+            // the first viewer gets everything, the second misses the lost packets
+            int expectedStale = 0;
+
+            if (v == 1)
+                for (int range = 0; range < numRanges; range++)
+                    if (! rangeValid[range])
+                        expectedStale += std::min (numBins, (range + 1) * settings.binsPerPacket) - range * settings.binsPerPacket;
+
+            wrongBins[v] += countWrongBins (decoders[v], frame, fresh[v], settings);
+
+            if (decoders[v].getNumStaleBins() != expectedStale)
+                wrongStale++;
+
+            int numActive = 0;
+            for (int k = 0; k < SourceTracker::maxSources; k++)
+            {
+                if (sources[k].id == 0)
+                    continue;
+
+                const TrackedSource& received = decoders[v].getSource (numActive++);
+
+                if (received.id != sources[k].id || received.x != sources[k].x
+                     || received.y != sources[k].y || received.confidence != sources[k].confidence)
+                    wrongSources++;
+            }
+
+            if (decoders[v].getNumSources() != numActive || decoders[v].getSourceSequence() != encoder.getSequence())
+                wrongSources++;
+        }
+    }
+
+    // truncated and foreign packets change nothing
+    const int64_t rejectedBefore = decoders[0].getNumRejected();
+    const int lastPacket = encoder.getNumPackets() - 1;
+
+    for (int size = 0; size < encoder.getPacketSize (lastPacket); size += 3)
+        decoders[0].receive (encoder.getPacket (lastPacket), size);
+
+    const char foreign[] = "/other\0\0,i\0\0\0\0\0\1";
+    decoders[0].receive (foreign, sizeof (foreign) - 1);
+
+    const int64_t rejected = decoders[0].getNumRejected() - rejectedBefore;
+    const int64_t expectedRejected = (encoder.getPacketSize (lastPacket) + 2) / 3 + 1;
+
+    const double bytesPerFrame = (double) totalBytes / numFrames;
+    const double framesPerSecond = 44100.0 / 1024;
+
+    if (report)
+        std::printf ("%-6s %8s %8s %8s %8s %10s %10s %10s %10s\n", "bins", "bytes", "raw", "packets", "max",
+                     "kbit/s", "encode us", "decode us", "lost");
+
+    std::printf ("%-6d %8.0f %8d %8.1f %8d %10.1f %10.2f %10.2f %10d\n", numBins, bytesPerFrame, 12 * numBins,
+                 (double) totalPackets / numFrames, encoder.getMaxPacketSize(), bytesPerFrame * 8 * framesPerSecond / 1000,
+                 1.0e6 * encodeSeconds / numFrames, 1.0e6 * decodeSeconds / (2 * numFrames), lostPackets);
+
+    if (wrongBins[0] > 0 || wrongBins[1] > 0)
+    {
+        std::printf ("  %d / %d bins decoded outside the quantisation step\n", wrongBins[0], wrongBins[1]);
+        failures++;
+    }
+
+    if (wrongStale > 0)
+    {
+        std::printf ("  stale bins were off in %d frames\n", wrongStale);
+        failures++;
+    }
+
+    if (wrongSources > 0)
+    {
+        std::printf ("  %d sources arrived wrong\n", wrongSources);
+        failures++;
+    }
+
+    if (rejected != expectedRejected)
+    {
+        std::printf ("  %lld of %lld bad packets rejected\n", (long long) rejected, (long long) expectedRejected);
+        failures++;
+    }
+
+    return failures;
+}
+
+/* NaN (a localizer fed silence or garbage) has to quantise to 0, not to
+   whatever an out of range float to int cast gives. */
+static int checkNaN()
+{
+    const int numBins = 16;
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    float x[numBins], y[numBins], gain[numBins];
+
+    for (int b = 0; b < numBins; b++)
+    {
+        x[b] = (b % 2 == 0) ? nan : 0.75f;
+        y[b] = (b % 3 == 0) ? nan : 0.25f;
+        gain[b] = (b % 4 == 0) ? nan : 10.0f;
+    }
+
+    const LocalizationFrame frame = { numBins, x, y, gain, gain };
+    const LocalizationStreamSettings settings;
+
+    LocalizationStreamEncoder encoder;
+    encoder.prepare (numBins, settings);
+    encoder.encodeFrame (frame, nullptr, 0);
+
+    LocalizationStreamDecoder decoder;
+    for (int p = 0; p < encoder.getNumPackets(); p++)
+        decoder.receive (encoder.getPacket (p), (size_t) encoder.getPacketSize (p));
+
+    const LocalizationFrame decoded = decoder.getFrame();
+    int wrong = decoded.numBins == numBins ? 0 : numBins;
+
+    for (int b = 0; b < numBins && wrong == 0; b++)
+    {
+        if ((b % 2 == 0 && decoded.x[b] != 0.0f) || (b % 3 == 0 && decoded.y[b] != 0.0f)
+             || (b % 4 == 0 && decoded.gain[b] != settings.gainMinDb))
+            wrong++;
+    }
+
+    if (wrong > 0)
+        std::printf ("  NaN bins didn't decode as 0\n");
+
+    return wrong > 0 ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    int failures = checkNaN();
+
+    failures += runStream (512, true);
+    failures += runStream (1024, false);
+    failures += runStream (2048, false);
+
+    if (failures > 0)
+        std::printf ("\n%d check(s) failed\n", failures);
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+/*
+  ==============================================================================
+
+ Benchmark for MappedAudioFile against the copying read path.
+
+ Writes a 9 channel float WAV (1024 MB by default, or the size in MB given
+ as the first argument), then:
+
+ - ingest: GB/s getting every sample to where the STFT reads it. The copy
+   path is what a decoding reader does (fread into a scratch block, then
+   de-interleave into per-channel buffers); the mapped path just walks the
+   view the STFT window reads from.
+ - analyse: OfflineAnalyser end to end (fft 1024, hop 1024) on both.
+ - peak RSS after the mapped runs, which should be a few MB however big the
+   file is, and a check that both paths localize identically.
+
+ The file was just written, so it is in the page cache: this measures the
+ memory side of ingest, not the disk.
+
+ build (no JUCE needed, POSIX only because of getrusage):
+   c++ -O3 -std=c++11 -I.. MappedReaderBenchmark.cpp ../MappedAudioFile.cpp ../OfflineAnalyser.cpp
+       ../QuadLocalizer.cpp ../GridLocalizer.cpp ../GeometryLocalizer.cpp ../TdoaLocalizer.cpp ../ArrayGeometry.cpp ../MultichannelSTFT.cpp ../DSPKernels.cpp -o MappedReaderBenchmark
+
+  ==============================================================================
+*/
+
+#include "../MappedAudioFile.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sys/resource.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const int numChannels = 9;
+static const double sampleRate = 44100.0;
+
+//----------------------------------------------------------------------------//
+
+static bool writeTestFile (const char* path, int64_t numSamples)
+{
+    FILE* f = std::fopen (path, "wb");
+    if (f == nullptr)
+        return false;
+
+    const uint32_t dataBytes = (uint32_t) (numSamples * numChannels * sizeof (float));
+    const uint32_t riffBytes = 4 + 8 + 16 + 8 + dataBytes;
+    const uint16_t format = 3, channels = numChannels, blockAlign = numChannels * 4, bits = 32;
+    const uint32_t fmtBytes = 16, rate = (uint32_t) sampleRate, byteRate = rate * blockAlign;
+
+    std::fwrite ("RIFF", 1, 4, f);  std::fwrite (&riffBytes, 4, 1, f);  std::fwrite ("WAVE", 1, 4, f);
+    std::fwrite ("fmt ", 1, 4, f);  std::fwrite (&fmtBytes, 4, 1, f);
+    std::fwrite (&format, 2, 1, f); std::fwrite (&channels, 2, 1, f);   std::fwrite (&rate, 4, 1, f);
+    std::fwrite (&byteRate, 4, 1, f); std::fwrite (&blockAlign, 2, 1, f); std::fwrite (&bits, 2, 1, f);
+    std::fwrite ("data", 1, 4, f);  std::fwrite (&dataBytes, 4, 1, f);
+
+    std::vector<float> block (4096 * numChannels);
+
+    for (int64_t done = 0; done < numSamples;)
+    {
+        const int n = (int) std::min<int64_t> (4096, numSamples - done);
+
+        for (int i = 0; i < n; i++)
+            for (int ch = 0; ch < numChannels; ch++)
+                block[i * numChannels + ch] = (ch == 3 ? 0.8f : 0.2f) * (float) std::sin (0.05 * (double) (done + i))
+                                            + 0.001f * (float) ((done + i) * (ch + 7) % 101);
+
+        std::fwrite (block.data(), sizeof (float), (size_t) n * numChannels, f);
+        done += n;
+    }
+
+    return std::fclose (f) == 0;
+}
+
+/* What a decoding reader does: file -> scratch block -> per-channel buffers. */
+
+class CopyingSource : public MultichannelSource
+{
+public:
+    CopyingSource (const char* path, int64_t dataOffsetToUse, int64_t lengthToUse)
+        : file (std::fopen (path, "rb")), dataOffset (dataOffsetToUse), length (lengthToUse)
+    {
+    }
+
+    ~CopyingSource()                                { if (file != nullptr) std::fclose (file); }
+
+    int getNumChannels() const override             { return numChannels; }
+    int64_t getLengthInSamples() const override     { return length; }
+    double getSampleRate() const override           { return sampleRate; }
+
+    bool read (float* const* dest, int64_t startSample, int numSamples) override
+    {
+        scratch.resize ((size_t) numSamples * numChannels);
+
+        if (std::fseek (file, (long) (dataOffset + startSample * numChannels * 4), SEEK_SET) != 0
+             || std::fread (scratch.data(), sizeof (float), scratch.size(), file) != scratch.size())
+            return false;
+
+        for (int ch = 0; ch < numChannels; ch++)
+            for (int i = 0; i < numSamples; i++)
+                dest[ch][i] = scratch[(size_t) i * numChannels + ch];
+
+        return true;
+    }
+
+private:
+    FILE* file;
+    int64_t dataOffset, length;
+    std::vector<float> scratch;
+};
+
+class ChecksumSink : public LocalizationSink
+{
+public:
+    void frameReady (int64_t, const LocalizationFrame& frame) override
+    {
+        for (int i = 0; i < frame.numBins; i++)
+            sum += frame.x[i] + frame.y[i] + 1.0e-3 * frame.gain[i];
+    }
+
+    double sum = 0.0;
+};
+
+static volatile float blackHole;   // keeps the ingest loops from being optimised away
+
+static double peakRSSMegabytes()
+{
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;   // kilobytes on Linux
+}
+
+static double secondsSince (Clock::time_point start)
+{
+    return std::chrono::duration<double> (Clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------//
+
+int main (int argc, char* argv[])
+{
+    const int64_t megabytes = argc > 1 ? std::atoll (argv[1]) : 1024;
+    const int64_t numSamples = megabytes * 1024 * 1024 / (numChannels * sizeof (float));
+    const double gigabytes = (double) numSamples * numChannels * sizeof (float) / 1.0e9;
+    const char* path = "MappedReaderBenchmark.wav";
+
+    if (! writeTestFile (path, numSamples))
+    {
+        std::printf ("can't write %s\n", path);
+        return 1;
+    }
+
+    std::printf ("%.2f GB, %d channels, %.1f minutes of audio\n", gigabytes, numChannels, numSamples / sampleRate / 60.0);
+    std::printf ("peak RSS before: %.1f MB\n\n", peakRSSMegabytes());
+
+    const int blockSamples = 32 * 1024;    // what OfflineAnalyser reads at fft 1024, hop 1024
+    AnalysisSettings settings;
+
+    // mapped first, so the RSS figure isn't hiding behind the copy path's
+    double mappedIngest, mappedAnalyse, mappedSum;
+    {
+        MappedAudioFile mapped;
+        if (! mapped.openWav (path))
+        {
+            std::printf ("%s\n", mapped.getLastError().c_str());
+            return 1;
+        }
+
+        Clock::time_point start = Clock::now();
+        float acc[8] = {};
+
+        for (int64_t pos = 0; pos + blockSamples <= numSamples; pos += blockSamples)
+        {
+            int stride = 0;
+            const float* view = mapped.getInterleavedView (pos, blockSamples, stride);
+
+            for (size_t i = 0; i < (size_t) blockSamples * stride; i += 8)
+                for (int j = 0; j < 8; j++)
+                    acc[j] += view[i + j];
+        }
+
+        blackHole = acc[0];
+
+        mappedIngest = gigabytes / secondsSince (start);
+
+        MappedAudioFile reopened;
+        reopened.openWav (path);
+        OfflineAnalyser analyser (settings, numChannels);
+        ChecksumSink sink;
+
+        start = Clock::now();
+        analyser.analyse (reopened, sink);
+        mappedAnalyse = gigabytes / secondsSince (start);
+        mappedSum = sink.sum;
+    }
+
+    const double mappedPeakRSS = peakRSSMegabytes();
+
+    double copyIngest, copyAnalyse, copySum;
+    {
+        CopyingSource copying (path, 44, numSamples);
+        std::vector<float> channels ((size_t) numChannels * blockSamples);
+        std::vector<float*> pointers;
+        for (int ch = 0; ch < numChannels; ch++)
+            pointers.push_back (channels.data() + (size_t) ch * blockSamples);
+
+        Clock::time_point start = Clock::now();
+
+        for (int64_t pos = 0; pos + blockSamples <= numSamples; pos += blockSamples)
+        {
+            copying.read (pointers.data(), pos, blockSamples);
+            blackHole = channels[(size_t) (pos / blockSamples) % channels.size()];
+        }
+
+        copyIngest = gigabytes / secondsSince (start);
+
+        CopyingSource reopened (path, 44, numSamples);
+        OfflineAnalyser analyser (settings, numChannels);
+        ChecksumSink sink;
+
+        start = Clock::now();
+        analyser.analyse (reopened, sink);
+        copyAnalyse = gigabytes / secondsSince (start);
+        copySum = sink.sum;
+    }
+
+    std::remove (path);
+
+    std::printf ("%10s %12s %12s\n", "", "ingest GB/s", "analyse GB/s");
+    std::printf ("%10s %12.2f %12.3f\n", "copy", copyIngest, copyAnalyse);
+    std::printf ("%10s %12.2f %12.3f\n", "mapped", mappedIngest, mappedAnalyse);
+    std::printf ("\npeak RSS after the mapped runs: %.1f MB (file is %.0f MB)\n", mappedPeakRSS, gigabytes * 1000.0);
+
+    const bool identical = std::fabs (mappedSum - copySum) <= 1.0e-6 * std::fabs (copySum);
+    std::printf ("localization identical on both paths: %s\n", identical ? "yes" : "NO");
+
+    return identical ? 0 : 1;
+}
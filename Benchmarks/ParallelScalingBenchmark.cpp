@@ -0,0 +1,178 @@
+/*
+  ==============================================================================
+
+ Benchmark for ParallelOfflineAnalyser.
+
+ Runs a synthetic 9 channel recording (a tone panned right, plus noise)
+ through the serial OfflineAnalyser and then the parallel one at 1, 2, 4 ...
+ threads up to the core count. Reports frames per second and speedup, and
+ fails if any parallel run doesn't match the serial output bit for bit or
+ hands frames to the sink out of order. Then a source that stops reading
+ part way: the chunks before the hole come out, nothing from it on.
+
+ build (no JUCE needed):
+   c++ -O3 -std=c++11 -pthread -I.. ParallelScalingBenchmark.cpp ../ParallelOfflineAnalyser.cpp ../WorkStealingPool.cpp
+       ../OfflineAnalyser.cpp ../QuadLocalizer.cpp ../GridLocalizer.cpp ../GeometryLocalizer.cpp ../TdoaLocalizer.cpp ../ArrayGeometry.cpp ../MultichannelSTFT.cpp ../DSPKernels.cpp -o ParallelScalingBenchmark
+
+  ==============================================================================
+*/
+
+#include "../ParallelOfflineAnalyser.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+/* Generated on the fly, so every worker can have its own without copying audio. */
+
+class SyntheticSource : public MultichannelSource
+{
+public:
+    SyntheticSource (int64_t lengthToUse, int64_t failFromToUse = -1)
+        : length (lengthToUse), failFrom (failFromToUse) {}
+
+    int getNumChannels() const override             { return 9; }
+    int64_t getLengthInSamples() const override     { return length; }
+    double getSampleRate() const override           { return 44100.0; }
+
+    bool read (float* const* dest, int64_t startSample, int numSamples) override
+    {
+        if (failFrom >= 0 && startSample + numSamples > failFrom)
+            return false;
+
+        for (int ch = 0; ch < 9; ch++)
+        {
+            // mic 4 (index 3) loudest, so the tone sits to the right
+            const float level = (ch == 3) ? 1.0f : 0.25f;
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                const int64_t n = startSample + i;
+                const uint32_t hash = (uint32_t) (n * 2654435761u) ^ (uint32_t) (ch * 40503u);
+
+                dest[ch][i] = level * (float) std::sin (0.0712 * (double) n)
+                            + 0.01f * ((float) (hash & 0xffff) / 65535.0f - 0.5f);
+            }
+        }
+
+        return true;
+    }
+
+private:
+    int64_t length;
+    int64_t failFrom;       // reads reaching this sample fail, -1 never
+};
+
+class SyntheticSourceFactory : public MultichannelSourceFactory
+{
+public:
+    SyntheticSourceFactory (int64_t lengthToUse, int64_t failFromToUse = -1)
+        : length (lengthToUse), failFrom (failFromToUse) {}
+
+    MultichannelSource* createSource() override     { return new SyntheticSource (length, failFrom); }
+
+private:
+    int64_t length;
+    int64_t failFrom;
+};
+
+/* Hashes everything it sees and checks the frames arrive in order. */
+
+class ChecksumSink : public LocalizationSink
+{
+public:
+    void frameReady (int64_t frameIndex, const LocalizationFrame& frame) override
+    {
+        if (frameIndex != numFrames)
+            inOrder = false;
+
+        add (frame.x, frame.numBins);
+        add (frame.y, frame.numBins);
+        add (frame.gain, frame.numBins);
+        ++numFrames;
+    }
+
+    uint64_t checksum = 1469598103934665603ull;
+    int64_t numFrames = 0;
+    bool inOrder = true;
+
+private:
+    void add (const float* data, int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            uint32_t bits;
+            std::memcpy (&bits, data + i, sizeof (bits));
+            checksum = (checksum ^ bits) * 1099511628211ull;
+        }
+    }
+};
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    const int64_t length = 44100 * 120;     // two minutes
+    const int maxThreads = std::max (1, (int) std::thread::hardware_concurrency());
+
+    AnalysisSettings settings;
+    settings.fftOrder = 10;
+    settings.hopSize = 512;
+
+    SyntheticSource serialSource (length);
+    OfflineAnalyser serial (settings, serialSource.getNumChannels());
+    ChecksumSink reference;
+
+    Clock::time_point start = Clock::now();
+    serial.analyse (serialSource, reference);
+    const double serialSeconds = std::chrono::duration<double> (Clock::now() - start).count();
+
+    std::printf ("%lld frames, fft 1024, hop 512, 9 channels, %d cores\n\n", (long long) reference.numFrames, maxThreads);
+    std::printf ("%8s %14s %9s\n", "threads", "frames/s", "speedup");
+    std::printf ("%8s %14.0f %9s\n", "serial", reference.numFrames / serialSeconds, "1.00x");
+
+    bool ok = true;
+
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    {
+        SyntheticSourceFactory factory (length);
+        ChecksumSink sink;
+
+        start = Clock::now();
+        ParallelOfflineAnalyser (settings, numThreads).analyse (factory, sink);
+        const double seconds = std::chrono::duration<double> (Clock::now() - start).count();
+
+        const bool matches = sink.inOrder && sink.numFrames == reference.numFrames && sink.checksum == reference.checksum;
+        ok = ok && matches;
+
+        std::printf ("%8d %14.0f %8.2fx%s\n", numThreads, sink.numFrames / seconds, serialSeconds / seconds,
+                     matches ? "" : "  MISMATCH");
+
+        if (numThreads < maxThreads && numThreads * 2 > maxThreads)
+            numThreads = maxThreads / 2;    // always finish on the full core count
+    }
+
+    // a read failing a third of the way in
+    {
+        SyntheticSourceFactory factory (length, length / 3);
+        ChecksumSink sink;
+
+        const int64_t returned = ParallelOfflineAnalyser (settings, std::max (2, maxThreads)).analyse (factory, sink);
+        const int64_t lastGood = (length / 3 - 1024) / settings.hopSize;    // frames whose samples all read
+
+        const bool stopped = sink.inOrder && returned == sink.numFrames && returned < reference.numFrames && returned <= lastGood;
+        ok = ok && stopped;
+
+        std::printf ("\nfailing source: %lld of %lld frames%s\n", (long long) returned, (long long) reference.numFrames,
+                     stopped ? "" : "  NOT STOPPED AT THE HOLE");
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,434 @@
+/*
+  ==============================================================================
+
+ The whole pipeline on synthetic audio, as a regression check.
+
+ Two point sources move over the array with background noise. One
+ circles the centre and plays band-limited noise at 200-2000 Hz. The
+ other slides along a diagonal at 3-8 kHz. Every mic hears each source at
+ 1 / (distance + 0.15), as in the localizer benchmarks, plus its own white
+ noise 30 dB down. The audio is rendered for the 3x3 array (FERP channel
+ order), a 4x4 grid and a 5x5 grid, and every frame goes through:
+
+   load (the fifo read) -> window -> fft -> magnitudes -> localize
+   (crossover and dB) -> rasterize (400 x 400, every frame rather than
+   at 30 Hz)
+
+ The 3x3 array is localized both by GridLocalizer, as the app does, and
+ by GeometryLocalizer. The bigger grids use GeometryLocalizer only. Each
+ of those runs at fft sizes 512 to 4096, with 50% overlap.
+
+ Per run it reports:
+ - frames per second and realtime factor
+ - per-stage mean and p99, from PipelineProfiler
+ - the mean and 90th percentile distance from each bin inside a source's
+   band to where that source was at the frame's centre
+
+ Seeds are fixed, so a run's error is the same on every build and only
+ the timings move. --json file.json writes every run as machine-readable
+ JSON, to diff between builds. It returns 1 if any run is slower than
+ realtime or has a mean error over 0.2.
+
+ build (no JUCE needed):
+   c++ -O3 -std=c++11 -I.. PipelineBenchmark.cpp ../PipelineProfiler.cpp ../MultichannelSTFT.cpp
+       ../GridLocalizer.cpp ../QuadLocalizer.cpp ../GeometryLocalizer.cpp ../ArrayGeometry.cpp
+       ../PanogramRasterizer.cpp ../DSPKernels.cpp -o PipelineBenchmark
+
+  ==============================================================================
+*/
+
+#include "../PipelineProfiler.h"
+#include "../GeometryLocalizer.h"
+#include "../GridLocalizer.h"
+#include "../MultichannelSTFT.h"
+#include "../PanogramRasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const double sampleRate = 44100.0;
+static const double durationSeconds = 6.0;
+static const double twoPi = 6.283185307179586;
+
+//----------------------------------------------------------------------------//
+
+struct MovingSource
+{
+    double lowHz, highHz;
+
+    void getPosition (double t, float& x, float& y) const
+    {
+        if (lowHz < 2500.0)
+        {
+            // a circle every 4 seconds
+            x = (float) (0.5 + 0.3 * std::cos (twoPi * t / 4.0));
+            y = (float) (0.5 + 0.3 * std::sin (twoPi * t / 4.0));
+        }
+        else
+        {
+            // corner to corner and back every 6 seconds
+            const double phase = std::fmod (t / 6.0, 1.0);
+            const double along = phase < 0.5 ? 2.0 * phase : 2.0 - 2.0 * phase;
+            x = (float) (0.15 + 0.7 * along);
+            y = (float) (0.85 - 0.7 * along);
+        }
+    }
+};
+
+static const MovingSource sources[] = { { 200.0, 2000.0 }, { 3000.0, 8000.0 } };
+static const int numSources = 2;
+
+/* Band-limited noise: a partial every 5 Hz across the band, random phases,
+   run as recursive oscillators. */
+static std::vector<float> makeBandNoise (double lowHz, double highHz, int numSamples, unsigned seed)
+{
+    std::mt19937 random (seed);
+    std::uniform_real_distribution<double> phase (0.0, twoPi);
+
+    const int numPartials = (int) ((highHz - lowHz) / 5.0) + 1;
+    std::vector<double> re (numPartials), im (numPartials), stepRe (numPartials), stepIm (numPartials);
+
+    for (int p = 0; p < numPartials; p++)
+    {
+        const double start = phase (random);
+        const double omega = twoPi * (lowHz + 5.0 * p) / sampleRate;
+        re[p] = std::cos (start);
+        im[p] = std::sin (start);
+        stepRe[p] = std::cos (omega);
+        stepIm[p] = std::sin (omega);
+    }
+
+    std::vector<float> out (numSamples);
+    const double scale = 1.0 / std::sqrt (0.5 * numPartials);     // about unit rms
+
+    for (int n = 0; n < numSamples; n++)
+    {
+        double sum = 0.0;
+
+        for (int p = 0; p < numPartials; p++)
+        {
+            const double r = re[p] * stepRe[p] - im[p] * stepIm[p];
+            const double i = re[p] * stepIm[p] + im[p] * stepRe[p];
+            re[p] = r;
+            im[p] = i;
+            sum += r;
+        }
+
+        out[n] = (float) (sum * scale);
+    }
+
+    return out;
+}
+
+//----------------------------------------------------------------------------//
+
+/* Every channel of a geometry hearing both sources and its own noise. */
+struct SyntheticRecording
+{
+    SyntheticRecording (const ArrayGeometry& geometry, const std::vector<float>* sourceSignals)
+        : numChannels (geometry.getNumChannelsNeeded()),
+          numSamples ((int) sourceSignals[0].size()),
+          channels (numChannels, std::vector<float> (numSamples))
+    {
+        float maxX = 0.0f, maxY = 0.0f;
+        for (const ArrayMic& mic : geometry.mics)
+        {
+            maxX = std::max (maxX, mic.x);
+            maxY = std::max (maxY, mic.y);
+        }
+
+        std::mt19937 random (11);
+        std::normal_distribution<float> noise (0.0f, 0.0316f);
+
+        // the levels follow the sources a block at a time
+        const int blockSize = 64;
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            const int end = std::min (numSamples, start + blockSize);
+            const double t = (start + 0.5 * (end - start)) / sampleRate;
+
+            for (const ArrayMic& mic : geometry.mics)
+            {
+                const float micX = mic.x / maxX, micY = mic.y / maxY;
+                float level[numSources];
+
+                for (int s = 0; s < numSources; s++)
+                {
+                    float x, y;
+                    sources[s].getPosition (t, x, y);
+                    level[s] = 1.0f / (std::hypot (micX - x, micY - y) + 0.15f);
+                }
+
+                float* out = channels[mic.channel].data();
+
+                for (int n = start; n < end; n++)
+                    out[n] = level[0] * sourceSignals[0][n] + level[1] * sourceSignals[1][n] + noise (random);
+            }
+        }
+    }
+
+    int numChannels, numSamples;
+    std::vector<std::vector<float>> channels;
+};
+
+//----------------------------------------------------------------------------//
+
+struct RunResult
+{
+    std::string array, localizer;
+    int numChannels, fftSize, hopSize, numFrames;
+    double framesPerSecond, realtimeFactor;
+    double meanError, p90Error;
+    PipelineProfiler::StageStats stages[PipelineProfiler::numStages];
+};
+
+static const PipelineProfiler::Stage timedStages[] =
+{
+    PipelineProfiler::fifoRead, PipelineProfiler::window, PipelineProfiler::fft,
+    PipelineProfiler::magnitudes, PipelineProfiler::localize, PipelineProfiler::rasterize
+};
+
+static RunResult run (const std::string& arrayName, const ArrayGeometry& geometry, const SyntheticRecording& recording,
+                      bool useGrid, int fftOrder)
+{
+    const int fftSize = 1 << fftOrder;
+    const int hopSize = fftSize / 2;
+    const int numBins = fftSize / 2;
+    const int numChannels = recording.numChannels;
+
+    MultichannelSTFT stft;
+    stft.prepare (fftOrder, numChannels, MultichannelSTFT::getCOLAWindowScale (fftSize, hopSize));
+
+    GridLocalizer grid;
+    GeometryLocalizer geometryLocalizer;
+
+    if (useGrid)
+        grid.setNumBins (numBins);
+    else
+        geometryLocalizer.prepare (geometry, numBins, sampleRate);
+
+    PanogramRasterizer rasterizer;
+    rasterizer.setSize (400, 400);
+    rasterizer.setNumBins (numBins);
+    std::vector<uint8_t> image (4 * 400 * 400);
+
+    std::vector<const float*> magnitudes (numChannels);
+    std::vector<float> errors;
+    errors.reserve ((size_t) (recording.numSamples / hopSize + 1) * numBins);
+
+    PipelineProfiler& profiler = PipelineProfiler::getInstance();
+    PipelineProfiler::Snapshot before, after;
+    profiler.takeSnapshot (before);
+
+    int numFrames = 0;
+    double processSeconds = 0.0;
+
+    for (int start = 0; start + fftSize <= recording.numSamples; start += hopSize)
+    {
+        const Clock::time_point frameStart = Clock::now();
+
+        {
+            PANOGRAM_PROFILE_SCOPE (PipelineProfiler::fifoRead);
+
+            for (int ch = 0; ch < numChannels; ch++)
+                stft.loadChannel (ch, recording.channels[ch].data() + start);
+        }
+
+        stft.process();
+
+        LocalizationFrame frame;
+        {
+            PANOGRAM_PROFILE_SCOPE (PipelineProfiler::localize);
+
+            for (int ch = 0; ch < numChannels; ch++)
+                magnitudes[ch] = stft.getMagnitudes (ch);
+
+            if (useGrid)
+            {
+                grid.process (magnitudes.data());
+                frame = grid.getFrame();
+            }
+            else
+            {
+                geometryLocalizer.process (magnitudes.data());
+                frame = geometryLocalizer.getFrame();
+            }
+        }
+
+        {
+            PANOGRAM_PROFILE_SCOPE (PipelineProfiler::rasterize);
+            rasterizer.addFrame (frame.x, frame.y, frame.gain, frame.numBins);
+            rasterizer.render (image.data(), 4 * 400);
+        }
+
+        processSeconds += std::chrono::duration<double> (Clock::now() - frameStart).count();
+        numFrames++;
+
+        // ground truth: bins well inside a source's band, at the frame's centre
+        const double t = (start + 0.5 * fftSize) / sampleRate;
+        const double binHz = sampleRate / fftSize;
+
+        for (int s = 0; s < numSources; s++)
+        {
+            float x, y;
+            sources[s].getPosition (t, x, y);
+
+            const int first = (int) std::ceil (sources[s].lowHz / binHz) + 3;
+            const int last = std::min (numBins - 1, (int) std::floor (sources[s].highHz / binHz) - 3);
+
+            for (int bin = first; bin <= last; bin++)
+                errors.push_back (std::hypot (frame.x[bin] - x, frame.y[bin] - y));
+        }
+    }
+
+    profiler.takeSnapshot (after);
+
+    RunResult result;
+    result.array = arrayName;
+    result.localizer = useGrid ? "grid" : "geometry";
+    result.numChannels = numChannels;
+    result.fftSize = fftSize;
+    result.hopSize = hopSize;
+    result.numFrames = numFrames;
+    result.framesPerSecond = numFrames / processSeconds;
+    result.realtimeFactor = (double) numFrames * hopSize / sampleRate / processSeconds;
+
+    double sum = 0.0;
+    for (float e : errors)
+        sum += e;
+
+    result.meanError = sum / errors.size();
+    std::nth_element (errors.begin(), errors.begin() + errors.size() * 9 / 10, errors.end());
+    result.p90Error = errors[errors.size() * 9 / 10];
+
+    for (int s = 0; s < PipelineProfiler::numStages; s++)
+        result.stages[s] = PipelineProfiler::getStageStats ((PipelineProfiler::Stage) s, after, before);
+
+    return result;
+}
+
+//----------------------------------------------------------------------------//
+
+static void writeJson (FILE* file, const std::vector<RunResult>& results)
+{
+    std::fprintf (file, "{\n  \"benchmark\": \"pipeline\",\n  \"sampleRate\": %.0f,\n  \"seconds\": %.1f,\n  \"runs\": [\n",
+                  sampleRate, durationSeconds);
+
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        const RunResult& result = results[r];
+
+        std::fprintf (file, "    {\"array\": \"%s\", \"localizer\": \"%s\", \"channels\": %d, \"fftSize\": %d, \"hopSize\": %d, "
+                            "\"frames\": %d, \"framesPerSecond\": %.1f, \"realtimeFactor\": %.2f, "
+                            "\"meanError\": %.5f, \"p90Error\": %.5f, \"stages\": {",
+                      result.array.c_str(), result.localizer.c_str(), result.numChannels, result.fftSize, result.hopSize,
+                      result.numFrames, result.framesPerSecond, result.realtimeFactor, result.meanError, result.p90Error);
+
+        for (size_t s = 0; s < sizeof (timedStages) / sizeof (timedStages[0]); s++)
+        {
+            const PipelineProfiler::StageStats& stats = result.stages[timedStages[s]];
+            std::fprintf (file, "%s\"%s\": {\"meanUs\": %.3f, \"p99Us\": %.3f}", s == 0 ? "" : ", ",
+                          stats.name, stats.meanMicros, stats.p99Micros);
+        }
+
+        std::fprintf (file, "}}%s\n", r + 1 < results.size() ? "," : "");
+    }
+
+    std::fprintf (file, "  ]\n}\n");
+}
+
+int main (int argc, char** argv)
+{
+    const char* jsonPath = nullptr;
+
+    for (int i = 1; i + 1 < argc; i++)
+        if (std::strcmp (argv[i], "--json") == 0)
+            jsonPath = argv[i + 1];
+
+    const int numSamples = (int) (durationSeconds * sampleRate);
+    const std::vector<float> sourceSignals[numSources] =
+    {
+        makeBandNoise (sources[0].lowHz, sources[0].highHz, numSamples, 1),
+        makeBandNoise (sources[1].lowHz, sources[1].highHz, numSamples, 2)
+    };
+
+    struct ArrayToRun { const char* name; ArrayGeometry geometry; };
+    const ArrayToRun arrays[] =
+    {
+        { "3x3", ArrayGeometry::makeDefault() },
+        { "4x4", ArrayGeometry::makeGrid (4, 4) },
+        { "5x5", ArrayGeometry::makeGrid (5, 5) }
+    };
+
+    std::vector<RunResult> results;
+
+    std::printf ("%-5s %-9s %5s %8s %9s %8s %7s %8s %8s %8s %8s %8s %8s\n", "array", "localizer", "fft",
+                 "frames/s", "realtime", "error", "p90", "load us", "window", "fft", "mags", "localize", "raster");
+
+    for (const ArrayToRun& array : arrays)
+    {
+        const SyntheticRecording recording (array.geometry, sourceSignals);
+
+        for (int fftOrder = 9; fftOrder <= 12; fftOrder++)
+        {
+            for (int useGrid = 1; useGrid >= 0; useGrid--)
+            {
+                // GridLocalizer only knows the 3x3 array
+                if (useGrid && recording.numChannels != 9)
+                    continue;
+
+                const RunResult result = run (array.name, array.geometry, recording, useGrid != 0, fftOrder);
+                results.push_back (result);
+
+                std::printf ("%-5s %-9s %5d %8.0f %8.1fx %8.3f %7.3f", result.array.c_str(), result.localizer.c_str(),
+                             result.fftSize, result.framesPerSecond, result.realtimeFactor, result.meanError, result.p90Error);
+
+                for (PipelineProfiler::Stage stage : timedStages)
+                    std::printf (" %8.1f", result.stages[stage].meanMicros);
+
+                std::printf ("\n");
+            }
+        }
+    }
+
+    if (jsonPath != nullptr)
+    {
+        if (FILE* file = std::fopen (jsonPath, "w"))
+        {
+            writeJson (file, results);
+            std::fclose (file);
+            std::printf ("\nwrote %s\n", jsonPath);
+        }
+        else
+        {
+            std::printf ("\ncouldn't write %s\n", jsonPath);
+            return 1;
+        }
+    }
+
+    int failures = 0;
+
+    for (const RunResult& result : results)
+    {
+        if (result.realtimeFactor < 1.0 || result.meanError > 0.2)
+        {
+            std::printf ("%s %s at fft %d: %.1fx realtime, error %.3f\n", result.array.c_str(), result.localizer.c_str(),
+                         result.fftSize, result.realtimeFactor, result.meanError);
+            failures++;
+        }
+    }
+
+    if (failures > 0)
+        std::printf ("\n%d check(s) failed\n", failures);
+
+    return failures > 0 ? 1 : 0;
+}
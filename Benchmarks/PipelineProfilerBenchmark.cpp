@@ -0,0 +1,232 @@
+/*
+  ==============================================================================
+
+ Benchmark for PipelineProfiler.
+
+ Checks that the histogram's percentiles and max land within a bucket of
+ the exact ones, and that four threads recording at once lose nothing.
+
+ Then the cost: nanoseconds per scoped timer and per bare record (what the
+ audio callback pays on top of AudioCallbackMonitor's own clock reads),
+ set against the stages they would be timing. Two paths, as the app runs
+ them: analysis (fifo read, window, fft, magnitudes: 4 scopes around a
+ 9-channel 1024 STFT) and display (localize, tracking, rasterize, paint,
+ tick: 5 scopes around the grid localizer, the tracker and the rasterizer
+ on 512 bins, paint not included). Each must stay under 1%.
+
+ build (no JUCE needed):
+   c++ -O3 -std=c++11 -I.. PipelineProfilerBenchmark.cpp ../PipelineProfiler.cpp ../MultichannelSTFT.cpp
+       ../GridLocalizer.cpp ../QuadLocalizer.cpp ../SourceTracker.cpp ../PanogramRasterizer.cpp ../DSPKernels.cpp
+       -pthread -o PipelineProfilerBenchmark
+
+  ==============================================================================
+*/
+
+#include "../PipelineProfiler.h"
+#include "../GridLocalizer.h"
+#include "../MultichannelSTFT.h"
+#include "../PanogramRasterizer.h"
+#include "../SourceTracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+template <typename Function>
+static double nanosPerCall (Function process)
+{
+    int iterations = 100;
+    for (;;)
+    {
+        const Clock::time_point start = Clock::now();
+
+        for (int i = 0; i < iterations; i++)
+            process();
+
+        const double ns = std::chrono::duration<double, std::nano> (Clock::now() - start).count();
+
+        if (ns > 5.0e7)
+            return ns / iterations;
+
+        iterations *= 4;
+    }
+}
+
+static PipelineProfiler testProfiler;
+
+static int checkHistogram()
+{
+    int failures = 0;
+
+    PipelineProfiler::Snapshot before, after;
+    testProfiler.takeSnapshot (before);
+
+    // log-normal around 50 us, like a stage with the odd slow frame
+    std::mt19937 random (7);
+    std::lognormal_distribution<double> latency (std::log (50000.0), 0.6);
+    std::vector<uint64_t> values (100000);
+
+    for (uint64_t& value : values)
+    {
+        value = (uint64_t) latency (random);
+        testProfiler.record (PipelineProfiler::fft, value);
+    }
+
+    testProfiler.takeSnapshot (after);
+    after.seconds = before.seconds + 1.0;
+
+    std::sort (values.begin(), values.end());
+    const double exactP50 = 1.0e-3 * values[values.size() / 2];
+    const double exactP99 = 1.0e-3 * values[values.size() * 99 / 100];
+    const double exactMax = 1.0e-3 * values.back();
+
+    const PipelineProfiler::StageStats stats = PipelineProfiler::getStageStats (PipelineProfiler::fft, after, before);
+
+    std::printf ("%-10s %10s %10s %8s\n", "", "exact us", "histogram", "error");
+    std::printf ("%-10s %10.2f %10.2f %7.2f%%\n", "p50", exactP50, stats.p50Micros, 100.0 * std::fabs (stats.p50Micros / exactP50 - 1.0));
+    std::printf ("%-10s %10.2f %10.2f %7.2f%%\n", "p99", exactP99, stats.p99Micros, 100.0 * std::fabs (stats.p99Micros / exactP99 - 1.0));
+    std::printf ("%-10s %10.2f %10.2f %7.2f%%\n", "max", exactMax, stats.maxMicros, 100.0 * std::fabs (stats.maxMicros / exactMax - 1.0));
+    std::printf ("%-10s %10.0f %10.0f\n\n", "calls", (double) values.size(), stats.callsPerSecond);
+
+    // within one bucket: 1/16 of the value
+    if (std::fabs (stats.p50Micros / exactP50 - 1.0) > 1.0 / 16 || std::fabs (stats.p99Micros / exactP99 - 1.0) > 1.0 / 16
+         || std::fabs (stats.maxMicros / exactMax - 1.0) > 1.0 / 16 || stats.callsPerSecond != (double) values.size())
+    {
+        std::printf ("histogram is off by more than a bucket\n");
+        failures++;
+    }
+
+    // every bucket starts where the last one ended, and values land in their own
+    for (int b = 1; b < PipelineProfiler::numBuckets; b++)
+    {
+        const uint64_t start = PipelineProfiler::getBucketStart (b);
+
+        if (start <= PipelineProfiler::getBucketStart (b - 1)
+             || PipelineProfiler::getBucket (start) != b || PipelineProfiler::getBucket (start - 1) != b - 1)
+        {
+            std::printf ("bucket %d is misplaced\n", b);
+            failures++;
+            break;
+        }
+    }
+
+    // four writers at once
+    const int numThreads = 4, perThread = 250000;
+    testProfiler.takeSnapshot (before);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++)
+        threads.push_back (std::thread ([t] { for (int i = 0; i < perThread; i++) testProfiler.record (PipelineProfiler::paint, 1000 + 37 * t + i % 5000); }));
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    testProfiler.takeSnapshot (after);
+    after.seconds = before.seconds + 1.0;
+
+    const double threadedCalls = PipelineProfiler::getStageStats (PipelineProfiler::paint, after, before).callsPerSecond;
+    std::printf ("%d threads x %d records: %.0f counted\n\n", numThreads, perThread, threadedCalls);
+
+    if (threadedCalls != (double) numThreads * perThread)
+    {
+        std::printf ("records were lost\n");
+        failures++;
+    }
+
+    return failures;
+}
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    int failures = checkHistogram();
+
+    PipelineProfiler& profiler = PipelineProfiler::getInstance();
+
+    const double scopeNs = nanosPerCall ([] { PANOGRAM_PROFILE_SCOPE (PipelineProfiler::tracking); });
+    uint64_t nanos = 0;
+    const double recordNs = nanosPerCall ([&] { profiler.record (PipelineProfiler::audioCallback, (nanos += 977) & 0xffff); });
+
+    std::printf ("scoped timer    %6.1f ns\n", scopeNs);
+    std::printf ("record          %6.1f ns\n\n", recordNs);
+
+    // analysis path: 9 channels, fft 1024 (its 3 scopes are inside, so this includes them)
+    const int numChannels = 9, fftOrder = 10, numBins = 512;
+
+    MultichannelSTFT stft;
+    stft.prepare (fftOrder, numChannels, 0.5f, true);
+
+    std::mt19937 random (3);
+    std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+    std::vector<float> samples (stft.getFFTSize());
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        for (float& s : samples)
+            s = noise (random);
+
+        stft.loadChannel (ch, samples.data());
+    }
+
+    const double stftNs = nanosPerCall ([&] { stft.process(); });
+
+    // display path: grid localizer, tracker, rasterizer on a 400 x 400 image
+    std::vector<std::vector<float>> magnitudes (numChannels, std::vector<float> (numBins));
+    std::vector<const float*> channels;
+
+    for (std::vector<float>& channel : magnitudes)
+    {
+        for (float& m : channel)
+            m = 1.0f + 100.0f * (0.5f + 0.5f * noise (random));
+
+        channels.push_back (channel.data());
+    }
+
+    GridLocalizer localizer;
+    localizer.setNumBins (numBins);
+
+    SourceTracker tracker;
+    tracker.prepare (numBins);
+
+    PanogramRasterizer rasterizer;
+    rasterizer.setSize (400, 400);
+    rasterizer.setNumBins (numBins);
+    std::vector<uint8_t> image (4 * 400 * 400);
+
+    const double displayNs = nanosPerCall ([&]
+    {
+        localizer.process (channels.data());
+        tracker.process (localizer.getFrame());
+
+        const LocalizationFrame frame = tracker.getFrame();
+        rasterizer.addFrame (frame.x, frame.y, frame.gain, frame.numBins);
+        rasterizer.render (image.data(), 4 * 400);
+    });
+
+    const double analysisOverhead = 4.0 * scopeNs / stftNs;
+    const double displayOverhead = 5.0 * scopeNs / displayNs;
+
+    std::printf ("%-10s %12s %8s %10s\n", "path", "us/frame", "scopes", "overhead");
+    std::printf ("%-10s %12.2f %8d %9.3f%%\n", "analysis", 1.0e-3 * stftNs, 4, 100.0 * analysisOverhead);
+    std::printf ("%-10s %12.2f %8d %9.3f%%\n", "display", 1.0e-3 * displayNs, 5, 100.0 * displayOverhead);
+
+    if (analysisOverhead > 0.01 || displayOverhead > 0.01)
+    {
+        std::printf ("profiling costs more than 1%%\n");
+        failures++;
+    }
+
+    if (failures > 0)
+        std::printf ("\n%d check(s) failed\n", failures);
+
+    return failures > 0 ? 1 : 0;
+}
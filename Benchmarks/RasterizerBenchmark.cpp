@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+ Benchmark for PanogramRasterizer.
+
+ Times addFrame() + render() per displayed frame at 80x80 up to 1024x1024,
+ with and without bilinear splatting, next to a straightforward version of
+ what PanogramComp used to do (hue computed per bin, one pixel written per
+ bin, every pixel faded and converted every frame). Reports the share of
+ one core needed for 60 fps.
+
+ The nearest-pixel mode is checked against that reference first; they must
+ agree to within one 8 bit step. So must a frame faded for 100 ms in 3
+ renders and in 6: the fade goes by time, not by renders.
+
+ build (no JUCE needed):
+   c++ -O2 -std=c++11 -I.. RasterizerBenchmark.cpp ../PanogramRasterizer.cpp ../DSPKernels.cpp -o RasterizerBenchmark
+
+  ==============================================================================
+*/
+
+#include "../PanogramRasterizer.h"
+#include "../DSPKernels.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+/* A few sources wandering around, most bins quiet, like a field recording. */
+
+struct SyntheticFrames
+{
+    SyntheticFrames (int numBinsToUse, int numFrames) : numBins (numBinsToUse)
+    {
+        std::srand (1);
+
+        for (int f = 0; f < numFrames; f++)
+        {
+            for (int i = 0; i < numBins; i++)
+            {
+                const int source = i % 3;
+                const float cx = 0.5f + 0.3f * std::sin (0.02f * f + 2.0f * source);
+                const float cy = 0.5f + 0.3f * std::cos (0.03f * f + 2.0f * source);
+                const float jitter = 0.05f * ((float) std::rand() / RAND_MAX - 0.5f);
+
+                x.push_back (cx + jitter);
+                y.push_back (cy - jitter);
+
+                // about a quarter of the bins above 0 dB
+                gain.push_back (((float) std::rand() / RAND_MAX) * 2.0f - 1.5f);
+            }
+        }
+    }
+
+    const float* getX (int f) const     { return &x[(size_t) f * numBins]; }
+    const float* getY (int f) const     { return &y[(size_t) f * numBins]; }
+    const float* getGain (int f) const  { return &gain[(size_t) f * numBins]; }
+
+    int numBins;
+    std::vector<float> x, y, gain;
+};
+
+//----------------------------------------------------------------------------//
+
+/* The old per-pixel approach, in plain loops. */
+
+class ReferenceRasterizer
+{
+public:
+    ReferenceRasterizer (int sizeToUse) : size (sizeToUse), pixels (4 * (size_t) size * size, 0.0f) {}
+
+    void addFrame (const float* x, const float* y, const float* gain, int numBins)
+    {
+        for (int i = 0; i < numBins; i++)
+        {
+            const float alpha = gain[i] / 0.5f;
+            if (! (alpha > 0.5f / 255.0f))
+                continue;
+
+            int px = (int) (x[i] * size);
+            int py = (int) (y[i] * size);
+            if (px < 0 || py < 0)
+                continue;
+
+            px = px < size ? px : size - 1;
+            py = py < size ? py : size - 1;
+
+            float bgra[4];
+            hueToBGRA ((float) i / numBins, bgra);
+
+            const float a = alpha < 1.0f ? alpha : 1.0f;
+            float* pixel = &pixels[4 * ((size_t) py * size + px)];
+
+            for (int c = 0; c < 4; c++)
+                pixel[c] += (bgra[c] - pixel[c]) * a;
+        }
+    }
+
+    void render (uint8_t* dst)
+    {
+        for (size_t i = 0; i < pixels.size(); i++)
+        {
+            const float v = pixels[i] > 0.0f ? (pixels[i] < 1.0f ? pixels[i] : 1.0f) : 0.0f;
+            dst[i] = (uint8_t) (int) (v * 255.0f + 0.5f);
+            pixels[i] *= 0.9f;
+        }
+    }
+
+private:
+    static void hueToBGRA (float hue, float* bgra)
+    {
+        const float h = 6.0f * hue;
+        const int sector = (int) h;
+        const float f = h - sector;
+
+        const float r[6] = { 1.0f, 1.0f - f, 0.0f, 0.0f, f, 1.0f };
+        const float g[6] = { f, 1.0f, 1.0f, 1.0f - f, 0.0f, 0.0f };
+        const float b[6] = { 0.0f, 0.0f, f, 1.0f, 1.0f, 1.0f - f };
+
+        const int s = sector < 6 ? sector : 5;
+        bgra[0] = b[s]; bgra[1] = g[s]; bgra[2] = r[s]; bgra[3] = 1.0f;
+    }
+
+    int size;
+    std::vector<float> pixels;
+};
+
+//----------------------------------------------------------------------------//
+
+static int checkAgainstReference (const SyntheticFrames& frames, int size, int numFrames)
+{
+    PanogramRasterizer rasterizer;
+    rasterizer.setSize (size, size);
+    rasterizer.setNumBins (frames.numBins);
+    rasterizer.setBilinear (false);
+
+    ReferenceRasterizer reference (size);
+
+    std::vector<uint8_t> out (4 * (size_t) size * size), expected (out.size());
+    int maxDiff = 0;
+
+    for (int f = 0; f < numFrames; f++)
+    {
+        rasterizer.addFrame (frames.getX (f), frames.getY (f), frames.getGain (f), frames.numBins);
+        rasterizer.render (out.data(), 4 * size);
+
+        reference.addFrame (frames.getX (f), frames.getY (f), frames.getGain (f), frames.numBins);
+        reference.render (expected.data());
+
+        for (size_t i = 0; i < out.size(); i++)
+        {
+            const int diff = std::abs ((int) out[i] - (int) expected[i]);
+            maxDiff = diff > maxDiff ? diff : maxDiff;
+        }
+    }
+
+    return maxDiff;
+}
+
+/* One frame faded for 100 ms, as 3 renders 33 ms apart and as 6 renders
+   17 ms apart: the trail has to look the same either way. */
+static int checkFadeByTime (const SyntheticFrames& frames, int size)
+{
+    std::vector<uint8_t> slow (4 * (size_t) size * size), fast (slow.size());
+    const int numRenders[2] = { 3, 6 };
+    uint8_t* const outs[2] = { slow.data(), fast.data() };
+
+    for (int run = 0; run < 2; run++)
+    {
+        PanogramRasterizer rasterizer;
+        rasterizer.setSize (size, size);
+        rasterizer.setNumBins (frames.numBins);
+        rasterizer.addFrame (frames.getX (0), frames.getY (0), frames.getGain (0), frames.numBins);
+
+        for (int r = 0; r < numRenders[run]; r++)
+            rasterizer.render (outs[run], 4 * size, 100.0 / numRenders[run]);
+
+        rasterizer.render (outs[run], 4 * size, 0.0);   // packs what is left after the fades
+    }
+
+    int maxDiff = 0;
+
+    for (size_t i = 0; i < slow.size(); i++)
+    {
+        const int diff = std::abs ((int) slow[i] - (int) fast[i]);
+        maxDiff = diff > maxDiff ? diff : maxDiff;
+    }
+
+    return maxDiff;
+}
+
+template <typename Rasterizer>
+static double millisPerFrame (Rasterizer& rasterizer, const SyntheticFrames& frames, int numFrames,
+                              std::vector<uint8_t>& out, int lineStride)
+{
+    const Clock::time_point start = Clock::now();
+
+    for (int f = 0; f < numFrames; f++)
+    {
+        rasterizer.addFrame (frames.getX (f), frames.getY (f), frames.getGain (f), frames.numBins);
+        rasterizer.render (out.data(), lineStride);
+    }
+
+    return std::chrono::duration<double, std::milli> (Clock::now() - start).count() / numFrames;
+}
+
+// ReferenceRasterizer::render has no stride, everything is packed
+struct StridedReference : ReferenceRasterizer
+{
+    StridedReference (int size) : ReferenceRasterizer (size) {}
+    void render (uint8_t* dst, int)     { ReferenceRasterizer::render (dst); }
+};
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    const int numBins = 512;
+    const int numFrames = 600;
+    const SyntheticFrames frames (numBins, numFrames);
+
+    const int maxDiff = checkAgainstReference (frames, 256, 200);
+    std::printf ("nearest mode vs reference at 256x256: max diff %d (of 255)\n\n", maxDiff);
+
+    if (maxDiff > 1)
+    {
+        std::printf ("rasterizer disagrees with the reference\n");
+        return 1;
+    }
+
+    const int fadeDiff = checkFadeByTime (frames, 256);
+    std::printf ("100 ms of fade as 3 or 6 renders: max diff %d (of 255)\n\n", fadeDiff);
+
+    if (fadeDiff > 1)
+    {
+        std::printf ("the fade depends on the render rate\n");
+        return 1;
+    }
+
+    std::printf ("kernels: %s, %d bins, 60 fps budget 16.7 ms\n\n", DSPKernels::get().name, numBins);
+    std::printf ("%-10s %-10s %12s %10s %12s %12s\n", "size", "mode", "ms/frame", "max fps", "core @60fps", "vs reference");
+
+    const int sizes[] = { 80, 256, 512, 1024 };
+
+    for (int size : sizes)
+    {
+        std::vector<uint8_t> out (4 * (size_t) size * size);
+
+        StridedReference reference (size);
+        const double referenceMs = millisPerFrame (reference, frames, numFrames, out, 4 * size);
+
+        std::printf ("%4dx%-5d %-10s %12.3f %10.0f %11.1f%% %12s\n", size, size, "reference",
+                     referenceMs, 1000.0 / referenceMs, referenceMs * 6.0, "");
+
+        for (int bilinear = 0; bilinear < 2; bilinear++)
+        {
+            PanogramRasterizer rasterizer;
+            rasterizer.setSize (size, size);
+            rasterizer.setNumBins (numBins);
+            rasterizer.setBilinear (bilinear != 0);
+
+            const double ms = millisPerFrame (rasterizer, frames, numFrames, out, 4 * size);
+
+            std::printf ("%4dx%-5d %-10s %12.3f %10.0f %11.1f%% %11.1fx\n", size, size, bilinear ? "bilinear" : "nearest",
+                         ms, 1000.0 / ms, ms * 6.0, referenceMs / ms);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+/*
+  ==============================================================================
+
+ Benchmark for the .pnlr localization recording format.
+
+ Localizes ten minutes of a synthetic 9 channel field (two drifting tones
+ over a noise floor) with OfflineAnalyser, records it, and reports:
+
+ - bytes per frame against raw float32, and what a day comes to at hop
+   1024 and hop 512
+ - write and sequential read speed, and the time to seek to random
+   timestamps
+ - the worst round-trip error over audible bins (quiet ones hold their
+   last position by design), which must stay within half a quantisation
+   step; and that a file missing its index (writer killed) is recovered up
+   to its last complete chunk
+
+ build (no JUCE needed):
+   c++ -O3 -std=c++11 -I.. RecordingFormatBenchmark.cpp ../LocalizationRecording.cpp ../OfflineAnalyser.cpp
+       ../QuadLocalizer.cpp ../GridLocalizer.cpp ../GeometryLocalizer.cpp ../TdoaLocalizer.cpp ../ArrayGeometry.cpp ../MultichannelSTFT.cpp ../DSPKernels.cpp -o RecordingFormatBenchmark
+
+  ==============================================================================
+*/
+
+#include "../LocalizationRecording.h"
+#include "../OfflineAnalyser.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+class FieldSource : public MultichannelSource
+{
+public:
+    FieldSource (int64_t lengthToUse) : length (lengthToUse) {}
+
+    int getNumChannels() const override             { return 9; }
+    int64_t getLengthInSamples() const override     { return length; }
+    double getSampleRate() const override           { return 44100.0; }
+
+    bool read (float* const* dest, int64_t startSample, int numSamples) override
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            const double t = (startSample + i) / 44100.0;
+            const double toneA = std::sin (6.2832 * 1500.0 * t);
+            const double toneB = std::sin (6.2832 * (4000.0 + 500.0 * std::sin (0.3 * t)) * t);
+            const double panA = 0.5 + 0.5 * std::sin (0.1 * t);     // drifts left to right
+
+            for (int ch = 0; ch < 9; ch++)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                const float noise = 0.02f * ((float) (seed >> 8) / 16777216.0f - 0.5f);
+                const double aGain = (ch == 3) ? panA : (ch == 1) ? 1.0 - panA : 0.3;
+                const double bGain = (ch == 5) ? 0.6 : 0.2;
+
+                dest[ch][i] = (float) (0.3 * aGain * toneA + 0.2 * bGain * toneB) + noise;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    int64_t length;
+    uint32_t seed = 1;
+};
+
+/* Records everything and keeps a float copy to compare against. */
+
+class RecordingSink : public LocalizationSink
+{
+public:
+    RecordingSink (LocalizationRecordingWriter& writerToUse) : writer (writerToUse) {}
+
+    void frameReady (int64_t frameIndex, const LocalizationFrame& frame) override
+    {
+        const Clock::time_point start = Clock::now();
+        writer.addFrame (frameIndex, frame);
+        writeSeconds += std::chrono::duration<double> (Clock::now() - start).count();
+
+        const float* streams[4] = { frame.x, frame.y, frame.gain, frame.gainY };
+        for (int s = 0; s < 4; s++)
+            original[s].insert (original[s].end(), streams[s], streams[s] + frame.numBins);
+    }
+
+    LocalizationRecordingWriter& writer;
+    std::vector<float> original[4];
+    double writeSeconds = 0.0;
+};
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    const char* path = "RecordingFormatBenchmark.pnlr";
+    const double audioSeconds = 600.0;
+
+    AnalysisSettings settings;
+    settings.fftOrder = 10;
+    settings.hopSize = 1024;
+
+    FieldSource source ((int64_t) (audioSeconds * 44100.0));
+    OfflineAnalyser analyser (settings, source.getNumChannels());
+
+    LocalizationRecordingInfo info;
+    info.numBins = analyser.getNumBins();
+    info.fftSize = 1 << settings.fftOrder;
+    info.hopSize = settings.hopSize;
+    info.sampleRate = source.getSampleRate();
+
+    LocalizationRecordingWriter writer;
+    if (! writer.open (path, info))
+    {
+        std::printf ("can't write %s\n", path);
+        return 1;
+    }
+
+    RecordingSink sink (writer);
+    const int64_t numFrames = analyser.analyse (source, sink);
+
+    Clock::time_point start = Clock::now();
+    writer.close();
+    sink.writeSeconds += std::chrono::duration<double> (Clock::now() - start).count();
+
+    const double bytesPerFrame = (double) writer.getBytesWritten() / numFrames;
+    const double rawBytesPerFrame = 4.0 * sizeof (float) * info.numBins;
+    const double framesPerDay1024 = 86400.0 * 44100.0 / 1024.0;
+
+    std::printf ("%lld frames of %d bins, %.0f s of audio\n\n", (long long) numFrames, info.numBins, audioSeconds);
+    std::printf ("bytes per frame     %8.0f  (float32: %.0f, %.1fx smaller)\n", bytesPerFrame, rawBytesPerFrame, rawBytesPerFrame / bytesPerFrame);
+    std::printf ("one day, hop 1024   %8.2f GB (float32: %.1f GB)\n", bytesPerFrame * framesPerDay1024 / 1.0e9, rawBytesPerFrame * framesPerDay1024 / 1.0e9);
+    std::printf ("one day, hop 512    %8.2f GB\n", 2.0 * bytesPerFrame * framesPerDay1024 / 1.0e9);
+    std::printf ("write               %8.0f frames/s\n", numFrames / sink.writeSeconds);
+
+    // read everything back in order and check the quantisation error
+    LocalizationRecordingReader reader;
+    if (! reader.open (path) || reader.getNumFrames() != numFrames)
+    {
+        std::printf ("can't read it back\n");
+        return 1;
+    }
+
+    float worst[4] = {};
+    start = Clock::now();
+
+    for (int64_t f = 0; f < numFrames; f++)
+    {
+        LocalizationFrame frame;
+        if (! reader.readFrame (f, frame))
+        {
+            std::printf ("frame %lld missing\n", (long long) f);
+            return 1;
+        }
+
+        const float* streams[4] = { frame.x, frame.y, frame.gain, frame.gainY };
+
+        for (int s = 0; s < 4; s++)
+        {
+            const float* expected = sink.original[s].data() + (size_t) f * info.numBins;
+
+            for (int b = 0; b < info.numBins; b++)
+            {
+                // the stored (quantised) gain decides which positions were kept
+                if (s < 2 && frame.gain[b] <= info.quietGainDb + 1.0e-4f)
+                    continue;
+
+                float e = expected[b];
+                if (s < 2)
+                    e = e >= 0.0f ? (e <= 1.0f ? e : 1.0f) : 0.0f;
+                else if (e < info.gainMinDb)
+                    e = info.gainMinDb;
+
+                worst[s] = std::fmax (worst[s], std::fabs (streams[s][b] - e));
+            }
+        }
+    }
+
+    const double readSeconds = std::chrono::duration<double> (Clock::now() - start).count();
+    std::printf ("sequential read     %8.0f frames/s\n", numFrames / readSeconds);
+
+    // random timestamps: one index search and one chunk decode each
+    const int numSeeks = 200;
+    start = Clock::now();
+
+    for (int i = 0; i < numSeeks; i++)
+    {
+        LocalizationFrame frame;
+        const double t = audioSeconds * (std::rand() / (double) RAND_MAX);
+        reader.readFrame (reader.getFrameAtTime (t), frame);
+    }
+
+    const double seekMs = std::chrono::duration<double, std::milli> (Clock::now() - start).count() / numSeeks;
+    std::printf ("random seek         %8.2f ms\n\n", seekMs);
+
+    const float positionTolerance = 0.5f / ((1 << info.positionBits) - 1) + 1.0e-6f;
+    const float gainTolerance = 0.5f * info.gainStepDb + 1.0e-4f;
+
+    std::printf ("worst error  x %.5f  y %.5f  gain %.3f dB  gainY %.3f dB\n", worst[0], worst[1], worst[2], worst[3]);
+
+    bool ok = worst[0] <= positionTolerance && worst[1] <= positionTolerance
+           && worst[2] <= gainTolerance && worst[3] <= gainTolerance;
+
+    // chop the index off, as if the writer had been killed
+    reader.close();
+    {
+        FILE* f = std::fopen (path, "rb");
+        std::vector<char> bytes;
+        for (int c; (c = std::fgetc (f)) != EOF;)
+            bytes.push_back ((char) c);
+        std::fclose (f);
+
+        const size_t indexBytes = 8 + 20 * (size_t) ((numFrames + info.framesPerChunk - 1) / info.framesPerChunk) + 12;
+        f = std::fopen (path, "wb");
+        std::fwrite (bytes.data(), 1, bytes.size() - indexBytes - 100, f);   // and the end of the last chunk
+        std::fclose (f);
+    }
+
+    const int64_t completeFrames = (numFrames - 1) / info.framesPerChunk * info.framesPerChunk;
+    const bool recovered = reader.open (path) && reader.wasRecovered() && reader.getNumFrames() == completeFrames;
+    std::printf ("recovered without index: %s (%lld frames)\n", recovered ? "yes" : "NO", (long long) reader.getNumFrames());
+
+    reader.close();
+    std::remove (path);
+
+    return ok && recovered ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+/*
+  ==============================================================================
+
+ Benchmark for SourceTracker.
+
+ Synthetic localizer output: two sources circling slowly, each owning 200
+ bins scattered around it, plus 112 bins of quiet noise anywhere. Every
+ frame gets new scatter and new gains, as a real localizer's would.
+
+ Reports microseconds per frame, how far the bins are from their source
+ before and after smoothing, how far the tracks are from the sources and
+ whether they keep their ids. Checks that process() doesn't allocate.
+
+ build (no JUCE needed):
+   c++ -O3 -std=c++11 -I.. SourceTrackerBenchmark.cpp ../SourceTracker.cpp -o SourceTrackerBenchmark
+
+  ==============================================================================
+*/
+
+#include "../SourceTracker.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+static long numAllocations = 0;
+
+void* operator new (std::size_t size)
+{
+    numAllocations++;
+
+    if (void* p = std::malloc (size > 0 ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete (void* p) noexcept
+{
+    std::free (p);
+}
+
+//----------------------------------------------------------------------------//
+
+struct SyntheticScene
+{
+    enum { numBins = 512, binsPerSource = 200, numSources = 2 };
+
+    SyntheticScene() : random (7), x (numBins), y (numBins), gain (numBins)
+    {
+    }
+
+    void sourcePosition (int source, int frameIndex, float& px, float& py) const
+    {
+        // a quarter turn every ~400 frames, the two on opposite sides
+        const float angle = 0.004f * frameIndex + 3.14159265f * source;
+        px = 0.5f + 0.3f * std::cos (angle);
+        py = 0.5f + 0.3f * std::sin (angle);
+    }
+
+    LocalizationFrame next (int frameIndex)
+    {
+        std::normal_distribution<float> scatter (0.0f, 0.06f);
+        std::uniform_real_distribution<float> anywhere (0.0f, 1.0f);
+        std::uniform_real_distribution<float> loud (5.0f, 30.0f);
+        std::uniform_real_distribution<float> quiet (-20.0f, 4.0f);
+
+        for (int i = 0; i < numBins; i++)
+        {
+            const int source = i / binsPerSource;
+
+            if (source < numSources)
+            {
+                float px, py;
+                sourcePosition (source, frameIndex, px, py);
+
+                x[i] = px + scatter (random);
+                y[i] = py + scatter (random);
+                gain[i] = loud (random);
+            }
+            else
+            {
+                x[i] = anywhere (random);
+                y[i] = anywhere (random);
+                gain[i] = quiet (random);
+            }
+        }
+
+        LocalizationFrame frame = { numBins, x.data(), y.data(), gain.data(), gain.data() };
+        return frame;
+    }
+
+    /* rms distance of the source bins from their source */
+    float binError (const LocalizationFrame& frame, int frameIndex) const
+    {
+        double sum = 0.0;
+
+        for (int i = 0; i < numSources * binsPerSource; i++)
+        {
+            float px, py;
+            sourcePosition (i / binsPerSource, frameIndex, px, py);
+
+            const float dx = frame.x[i] - px, dy = frame.y[i] - py;
+            sum += dx * dx + dy * dy;
+        }
+
+        return (float) std::sqrt (sum / (numSources * binsPerSource));
+    }
+
+    std::mt19937 random;
+    std::vector<float> x, y, gain;
+};
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    int failures = 0;
+
+    SyntheticScene scene;
+    SourceTracker tracker;
+    tracker.prepare (SyntheticScene::numBins);
+
+    const int warmUp = 100;
+    const int numFrames = 2000;
+
+    double rawError = 0.0, smoothedError = 0.0, trackError = 0.0, confidence = 0.0;
+    int framesWithBothTracked = 0, idChanges = 0;
+    int lastIds[SyntheticScene::numSources] = { 0, 0 };
+    long allocations = 0;
+    double us = 0.0;
+
+    for (int n = 0; n < numFrames; n++)
+    {
+        const LocalizationFrame frame = scene.next (n);
+
+        const long allocationsBefore = numAllocations;
+        const Clock::time_point start = Clock::now();
+
+        tracker.process (frame);
+
+        us += std::chrono::duration<double, std::micro> (Clock::now() - start).count();
+        allocations += numAllocations - allocationsBefore;
+
+        if (n < warmUp)
+            continue;
+
+        rawError += scene.binError (frame, n);
+        smoothedError += scene.binError (tracker.getFrame(), n);
+
+        // the nearest track to each source
+        int found = 0;
+
+        for (int s = 0; s < SyntheticScene::numSources; s++)
+        {
+            float px, py;
+            scene.sourcePosition (s, n, px, py);
+
+            int nearest = -1;
+            float nearestDistance = 0.0f;
+
+            for (int k = 0; k < SourceTracker::maxSources; k++)
+            {
+                const TrackedSource& source = tracker.getSource (k);
+                const float distance = std::hypot (source.x - px, source.y - py);
+
+                if (source.id != 0 && (nearest < 0 || distance < nearestDistance))
+                {
+                    nearest = k;
+                    nearestDistance = distance;
+                }
+            }
+
+            if (nearest < 0 || nearestDistance > 0.1f)
+                continue;
+
+            found++;
+            trackError += nearestDistance;
+            confidence += tracker.getSource (nearest).confidence;
+
+            const int id = tracker.getSource (nearest).id;
+            if (lastIds[s] != 0 && lastIds[s] != id)
+                idChanges++;
+
+            lastIds[s] = id;
+        }
+
+        if (found == SyntheticScene::numSources && tracker.getNumActiveSources() == SyntheticScene::numSources)
+            framesWithBothTracked++;
+    }
+
+    const int measured = numFrames - warmUp;
+    rawError /= measured;
+    smoothedError /= measured;
+    trackError /= (double) measured * SyntheticScene::numSources;
+    confidence /= (double) measured * SyntheticScene::numSources;
+
+    std::printf ("%d bins, %d frames\n\n", (int) SyntheticScene::numBins, numFrames);
+    std::printf ("us/frame                        %8.2f\n", us / numFrames);
+    std::printf ("bin error, raw (rms)            %8.4f\n", rawError);
+    std::printf ("bin error, smoothed (rms)       %8.4f\n", smoothedError);
+    std::printf ("track error (mean)              %8.4f\n", trackError);
+    std::printf ("track confidence (mean)         %8.3f\n", confidence);
+    std::printf ("frames with exactly 2 tracks    %7.1f%%\n", 100.0 * framesWithBothTracked / measured);
+    std::printf ("track id changes                %8d\n", idChanges);
+    std::printf ("allocations in process()        %8ld\n", allocations);
+
+    if (smoothedError > 0.6 * rawError)
+    {
+        std::printf ("smoothing didn't reduce the jitter enough\n");
+        failures++;
+    }
+
+    if (trackError > 0.03 || framesWithBothTracked < 0.95 * measured || idChanges > 0)
+    {
+        std::printf ("the sources weren't tracked\n");
+        failures++;
+    }
+
+    if (allocations > 0)
+    {
+        std::printf ("process() allocated\n");
+        failures++;
+    }
+
+    if (failures > 0)
+        std::printf ("\n%d check(s) failed\n", failures);
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,371 @@
+/*
+  ==============================================================================
+
+ Benchmark for TdoaLocalizer (GCC-PHAT) against the level-ratio grid.
+
+ Test signals: white noise from a point source 2 m or 0.3 m from the
+ middle of the 3x3 array (10 cm spacing), in random directions in front of
+ it. Each mic gets the source with its own fractional delay (windowed sinc)
+ and 1 / distance level, plus its own noise 40 dB down. Both localizers see
+ the same 44.1 kHz, fft 1024 STFT frames. Position error is measured
+ against where the source's direction maps on the panogram, per bin,
+ averaged over low (< 500 Hz), mid and high (> 4 kHz) bins.
+
+ Cost: microseconds per frame of the STFT with and without the complex
+ spectrum kept, of GridLocalizer and of TdoaLocalizer, and how much of a
+ frame's real time (hop 1024) the whole TDOA path takes.
+
+ Also checks the batched inverse FFT against a direct inverse DFT of every
+ pair's whitened cross spectrum (same peak), and the per-bin angles against
+ std::atan2.
+
+ build (no JUCE needed; -fno-math-errno is clang's default, GCC needs it to
+ vectorise the square roots):
+   c++ -O3 -std=c++11 -fno-math-errno -I.. TdoaLocalizerBenchmark.cpp ../TdoaLocalizer.cpp ../ArrayGeometry.cpp
+       ../GridLocalizer.cpp ../MultichannelSTFT.cpp ../DSPKernels.cpp -o TdoaLocalizerBenchmark
+
+  ==============================================================================
+*/
+
+#include "../TdoaLocalizer.h"
+#include "../GridLocalizer.h"
+#include "../MultichannelSTFT.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//----------------------------------------------------------------------------//
+
+static const double sampleRate = 44100.0;
+static const double speedOfSound = 343.0;
+static const double pi = 3.141592653589793;
+
+/* One frame of every mic hearing a noise source from direction (ux, uy). */
+
+struct SyntheticScene
+{
+    SyntheticScene (const ArrayGeometry& geometry, int fftSize, double distance, double ux, double uy, unsigned seed)
+        : numChannels (geometry.getNumChannelsNeeded()), frame ((size_t) fftSize * numChannels)
+    {
+        const int taps = 32;
+        const int margin = 512;
+        std::vector<float> source (fftSize + 2 * margin);
+
+        std::srand (seed);
+        for (float& s : source)
+            s = 2.0f * std::rand() / RAND_MAX - 1.0f;
+
+        // 3d source position, array in the z = 0 plane around its middle
+        const double uz = std::sqrt (std::fmax (0.0, 1.0 - ux * ux - uy * uy));
+        const double sx = distance * ux, sy = distance * uy, sz = distance * uz;
+
+        for (const ArrayMic& mic : geometry.mics)
+        {
+            const double mx = (mic.x - 1.0) * geometry.unitMetres;
+            const double my = (mic.y - 1.0) * geometry.unitMetres;
+            const double r = std::sqrt ((sx - mx) * (sx - mx) + (sy - my) * (sy - my) + sz * sz);
+            const double delay = (r - distance) / speedOfSound * sampleRate;   // relative to the middle
+            const double gain = distance / r;
+
+            for (int n = 0; n < fftSize; n++)
+            {
+                // windowed sinc read of source at n - delay
+                const double t = n + margin - delay;
+                const int base = (int) std::floor (t);
+                double sum = 0.0;
+
+                for (int j = -taps + 1; j <= taps; j++)
+                {
+                    const double offset = t - (base + j);
+                    const double sinc = std::fabs (offset) < 1.0e-9 ? 1.0 : std::sin (pi * offset) / (pi * offset);
+                    const double window = 0.5 + 0.5 * std::cos (pi * offset / taps);
+                    sum += source[base + j] * sinc * window;
+                }
+
+                const double noise = 0.01 * (2.0 * std::rand() / RAND_MAX - 1.0);
+                frame[(size_t) n * numChannels + mic.channel] = (float) (gain * sum + noise);
+            }
+        }
+
+        truthX = (float) (0.5 + 0.5 * ux);
+        truthY = (float) (0.5 + 0.5 * uy);
+    }
+
+    int numChannels;
+    std::vector<float> frame;      // interleaved
+    float truthX, truthY;
+};
+
+struct BandErrors
+{
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    int count[3] = { 0, 0, 0 };
+
+    void add (const LocalizationFrame& frame, float truthX, float truthY)
+    {
+        for (int k = 1; k < frame.numBins; k++)
+        {
+            const double hz = k * sampleRate / (2.0 * frame.numBins);
+            const int band = hz < 500.0 ? 0 : (hz < 4000.0 ? 1 : 2);
+            const double dx = frame.x[k] - truthX, dy = frame.y[k] - truthY;
+
+            sum[band] += std::sqrt (dx * dx + dy * dy);
+            count[band]++;
+        }
+    }
+
+    double get (int band) const     { return sum[band] / count[band]; }
+};
+
+template <typename Function>
+static double microsPerFrame (Function process)
+{
+    int iterations = 10;
+    for (;;)
+    {
+        const Clock::time_point start = Clock::now();
+
+        for (int i = 0; i < iterations; i++)
+            process();
+
+        const double us = std::chrono::duration<double, std::micro> (Clock::now() - start).count();
+
+        if (us > 5.0e4)
+            return us / iterations;
+
+        iterations *= 4;
+    }
+}
+
+//----------------------------------------------------------------------------//
+
+/* Peak lag of every pair from a direct inverse DFT, compared with the
+   localizer's delays; and each bin's x from std::atan2. */
+static void checkAgainstReference (const TdoaLocalizer& tdoa, const ArrayGeometry& geometry,
+                                   const MultichannelSTFT& stft, int& lagMismatches, double& maxBinDiff)
+{
+    const int numBins = stft.getNumBins();
+    const int fftSize = stft.getFFTSize();
+    const int numMics = (int) geometry.mics.size();
+    const double samplesPerUnit = geometry.unitMetres * sampleRate / speedOfSound;
+
+    std::vector<double> ax, ay, delays;
+    std::vector<std::vector<double>> phases;
+
+    for (int i = 0, p = 0; i < numMics; i++)
+    {
+        for (int j = i + 1; j < numMics; j++, p++)
+        {
+            const int a = geometry.mics[i].channel, b = geometry.mics[j].channel;
+            std::vector<double> gr (numBins), gi (numBins);
+            phases.push_back (std::vector<double> (numBins));
+
+            for (int k = 1; k < numBins; k++)
+            {
+                const double re = (double) stft.getReal (a)[k] * stft.getReal (b)[k] + (double) stft.getImag (a)[k] * stft.getImag (b)[k];
+                const double im = (double) stft.getImag (a)[k] * stft.getReal (b)[k] - (double) stft.getReal (a)[k] * stft.getImag (b)[k];
+                const double mag = std::sqrt (re * re + im * im) + 1.0e-300;
+                gr[k] = re / mag;
+                gi[k] = im / mag;
+                phases[p][k] = std::atan2 (im, re);
+            }
+
+            const int maxLag = 40;
+            double best = -1.0e300;
+            int bestLag = 0;
+
+            for (int lag = -maxLag; lag <= maxLag; lag++)
+            {
+                double r = 0.0;
+                for (int k = 1; k < numBins; k++)
+                    r += gr[k] * std::cos (2.0 * pi * k * lag / fftSize) - gi[k] * std::sin (2.0 * pi * k * lag / fftSize);
+
+                if (r > best)
+                {
+                    best = r;
+                    bestLag = lag;
+                }
+            }
+
+            if (std::fabs (tdoa.getPairDelay (p) - bestLag) > 0.501)
+                lagMismatches++;
+
+            ax.push_back ((geometry.mics[j].x - geometry.mics[i].x) * samplesPerUnit);
+            ay.push_back ((geometry.mics[j].y - geometry.mics[i].y) * samplesPerUnit);
+            delays.push_back (tdoa.getPairDelay (p));
+        }
+    }
+
+    // the same least squares, per bin, in double with exact angles
+    double sxx = 0.0, sxy = 0.0, syy = 0.0;
+    for (size_t p = 0; p < ax.size(); p++)
+    {
+        sxx += ax[p] * ax[p];
+        sxy += ax[p] * ay[p];
+        syy += ay[p] * ay[p];
+    }
+
+    const double ridge = 1.0e-6 * (sxx + syy) + 1.0e-30;
+    sxx += ridge;
+    syy += ridge;
+    const double det = sxx * syy - sxy * sxy;
+    const LocalizationFrame frame = tdoa.getFrame();
+
+    maxBinDiff = 0.0;
+
+    for (int k = 8; k < numBins; k++)
+    {
+        const double omega = 2.0 * pi * k / fftSize;
+        double sumX = 0.0, sumY = 0.0;
+
+        for (size_t p = 0; p < ax.size(); p++)
+        {
+            const double d = std::remainder (phases[p][k] + omega * delays[p], 2.0 * pi);
+            const double tau = delays[p] - d / omega;
+            sumX += (syy * ax[p] - sxy * ay[p]) / det * tau;
+            sumY += (sxx * ay[p] - sxy * ax[p]) / det * tau;
+        }
+
+        const double x = 0.5 + 0.5 * std::fmax (-1.0, std::fmin (1.0, sumX));
+        const double y = 0.5 + 0.5 * std::fmax (-1.0, std::fmin (1.0, sumY));
+
+        // an angle right at +-pi may wrap either way in float; that's not an error
+        const double diff = std::fmax (std::fabs (frame.x[k] - x), std::fabs (frame.y[k] - y));
+        if (diff < 0.1)
+            maxBinDiff = std::fmax (maxBinDiff, diff);
+    }
+}
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+    const int fftOrder = 10;
+    const int fftSize = 1 << fftOrder;
+    const int numDirections = 40;
+
+    const ArrayGeometry geometry = ArrayGeometry::makeDefault();
+    const int numChannels = geometry.getNumChannelsNeeded();
+
+    MultichannelSTFT stft;
+    stft.prepare (fftOrder, numChannels, MultichannelSTFT::getCOLAWindowScale (fftSize, fftSize), true);
+
+    MultichannelSTFT magnitudeOnly;
+    magnitudeOnly.prepare (fftOrder, numChannels, MultichannelSTFT::getCOLAWindowScale (fftSize, fftSize));
+
+    GridLocalizer grid;
+    grid.setNumBins (stft.getNumBins());
+
+    TdoaLocalizer tdoa;
+    tdoa.prepare (geometry, fftOrder, sampleRate);
+
+    std::vector<const float*> real, imag, magnitudes;
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        real.push_back (stft.getReal (ch));
+        imag.push_back (stft.getImag (ch));
+        magnitudes.push_back (stft.getMagnitudes (ch));
+    }
+
+    int failures = 0;
+    double lowGrid = 0.0, lowTdoa = 0.0, broadbandTdoa = 0.0;
+
+    std::printf ("%d mics, %d pairs, fft %d, %.0f cm spacing\n\n", (int) geometry.mics.size(), tdoa.getNumPairs(),
+                 fftSize, geometry.unitMetres * 100.0);
+    std::printf ("%-10s %-12s %10s %10s %10s %12s\n", "distance", "localizer", "< 500 Hz", "mid", "> 4 kHz", "broadband");
+
+    const double distances[] = { 2.0, 0.3 };
+
+    for (double distance : distances)
+    {
+        BandErrors gridErrors, tdoaErrors;
+        double broadbandError = 0.0;
+        int lagMismatches = 0;
+        double maxBinDiff = 0.0;
+
+        std::srand (11);
+
+        for (int d = 0; d < numDirections; d++)
+        {
+            // anywhere in front, not quite grazing
+            double ux, uy;
+            do
+            {
+                ux = 1.8 * std::rand() / RAND_MAX - 0.9;
+                uy = 1.8 * std::rand() / RAND_MAX - 0.9;
+            }
+            while (ux * ux + uy * uy > 0.81);
+
+            const unsigned seed = (unsigned) std::rand();
+            SyntheticScene scene (geometry, fftSize, distance, ux, uy, seed);
+
+            stft.processInterleaved (scene.frame.data(), numChannels);
+            grid.process (magnitudes.data());
+            tdoa.process (real.data(), imag.data(), magnitudes.data());
+
+            gridErrors.add (grid.getFrame(), scene.truthX, scene.truthY);
+            tdoaErrors.add (tdoa.getFrame(), scene.truthX, scene.truthY);
+
+            const double bx = 0.5 + 0.5 * tdoa.getDirectionX() - scene.truthX;
+            const double by = 0.5 + 0.5 * tdoa.getDirectionY() - scene.truthY;
+            broadbandError += std::sqrt (bx * bx + by * by);
+
+            if (d < 4)
+            {
+                double diff = 0.0;
+                checkAgainstReference (tdoa, geometry, stft, lagMismatches, diff);
+                maxBinDiff = std::fmax (maxBinDiff, diff);
+            }
+        }
+
+        broadbandError /= numDirections;
+
+        std::printf ("%-10.1f %-12s %10.3f %10.3f %10.3f %12s\n", distance, "level grid",
+                     gridErrors.get (0), gridErrors.get (1), gridErrors.get (2), "-");
+        std::printf ("%-10.1f %-12s %10.3f %10.3f %10.3f %12.3f   (lag mismatches %d, max bin diff from atan2 %.2g)\n",
+                     distance, "gcc-phat", tdoaErrors.get (0), tdoaErrors.get (1), tdoaErrors.get (2), broadbandError,
+                     lagMismatches, maxBinDiff);
+
+        if (lagMismatches > 0 || maxBinDiff > 2.0e-3)
+            failures++;
+
+        if (distance > 1.0)
+        {
+            lowGrid = gridErrors.get (0);
+            lowTdoa = tdoaErrors.get (0);
+            broadbandTdoa = broadbandError;
+        }
+    }
+
+    // the point of it: better low end than level ratios, and a sane direction
+    if (lowTdoa >= lowGrid || broadbandTdoa > 0.05)
+        failures++;
+
+    //==========================================================================
+
+    SyntheticScene scene (geometry, fftSize, 2.0, 0.3, -0.2, 5);
+
+    const double stftUs = microsPerFrame ([&] { magnitudeOnly.processInterleaved (scene.frame.data(), numChannels); });
+    const double complexUs = microsPerFrame ([&] { stft.processInterleaved (scene.frame.data(), numChannels); });
+    const double gridUs = microsPerFrame ([&] { grid.process (magnitudes.data()); });
+    const double tdoaUs = microsPerFrame ([&] { tdoa.process (real.data(), imag.data(), magnitudes.data()); });
+    const double frameUs = 1.0e6 * fftSize / sampleRate;
+
+    std::printf ("\n%-36s %10s\n", "us/frame", "");
+    std::printf ("%-36s %10.1f\n", "stft, magnitudes", stftUs);
+    std::printf ("%-36s %10.1f\n", "stft, magnitudes + complex", complexUs);
+    std::printf ("%-36s %10.1f\n", "level grid", gridUs);
+    std::printf ("%-36s %10.1f   (%d pairs, %.0f us per pair)\n", "gcc-phat", tdoaUs, tdoa.getNumPairs(), tdoaUs / tdoa.getNumPairs());
+    std::printf ("%-36s %10.1f   (%.1f%% of a %.1f ms hop)\n", "stft + gcc-phat", complexUs + tdoaUs,
+                 100.0 * (complexUs + tdoaUs) / frameUs, frameUs / 1000.0);
+
+    if (failures > 0)
+        std::printf ("gcc-phat disagrees with the reference or doesn't beat the level ratio at low frequencies\n");
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,696 @@
+#include "DSPKernels.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined (__x86_64__) || defined (_M_X64) || defined (__i386__) || defined (_M_IX86)
+ #define PANOGRAM_X86 1
+ #include <immintrin.h>
+ #if defined (_MSC_VER) && ! defined (__clang__)
+  #include <intrin.h>
+  #define PANOGRAM_TARGET_AVX2
+ #else
+  #define PANOGRAM_TARGET_AVX2 __attribute__((target ("avx2,fma")))
+ #endif
+#endif
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+ #define PANOGRAM_NEON 1
+ #include <arm_neon.h>
+#endif
+
+//----------------------------------------------------------------------------//
+
+/* Scalar reference. Everything else must match this. */
+
+namespace ScalarKernels
+{
+    static void add (const float* a, const float* b, float* dst, int n)
+    {
+        for (int i = 0; i < n; i++)
+            dst[i] = a[i] + b[i];
+    }
+
+    static void multiply (const float* a, const float* b, float* dst, int n)
+    {
+        for (int i = 0; i < n; i++)
+            dst[i] = a[i] * b[i];
+    }
+
+    static void divide (const float* num, const float* den, float* dst, int n)
+    {
+        for (int i = 0; i < n; i++)
+            dst[i] = num[i] / den[i];
+    }
+
+    static void addScalar (const float* src, float scalar, float* dst, int n)
+    {
+        for (int i = 0; i < n; i++)
+            dst[i] = src[i] + scalar;
+    }
+
+    static void multiplyScalar (const float* src, float scalar, float* dst, int n)
+    {
+        for (int i = 0; i < n; i++)
+            dst[i] = src[i] * scalar;
+    }
+
+    static void decibels (const float* src, float reference, float* dst, int n, bool amplitude)
+    {
+        const float factor = amplitude ? 20.0f : 10.0f;
+
+        for (int i = 0; i < n; i++)
+            dst[i] = factor * std::log10 (src[i] / reference);
+    }
+
+    static void intensity (const float* src, float floorDb, float rangeDb, float* dst, int n)
+    {
+        // the SIMD versions' multiply-add and clamp, NaN falls through to 0
+        const float scale = 1.0f / rangeDb;
+        const float offset = -floorDb * scale;
+
+        for (int i = 0; i < n; i++)
+        {
+            const float v = src[i] * scale + offset;
+            dst[i] = v > 0.0f ? (v < 1.0f ? v : 1.0f) : 0.0f;
+        }
+    }
+
+    static void packBytes (const float* src, unsigned char* dst, int n)
+    {
+        // same clamp, scale, +0.5 and truncate as the SIMD versions, so they match exactly
+        for (int i = 0; i < n; i++)
+        {
+            const float v = src[i] > 0.0f ? (src[i] < 1.0f ? src[i] : 1.0f) : 0.0f;
+            dst[i] = (unsigned char) (int) (v * 255.0f + 0.5f);
+        }
+    }
+}
+
+static const DSPKernelTable scalarTable =
+{
+    "scalar",
+    ScalarKernels::add,
+    ScalarKernels::multiply,
+    ScalarKernels::divide,
+    ScalarKernels::addScalar,
+    ScalarKernels::multiplyScalar,
+    ScalarKernels::decibels,
+    ScalarKernels::intensity,
+    ScalarKernels::packBytes
+};
+
+//----------------------------------------------------------------------------//
+
+ /* The vector log every SIMD table uses for decibels.
+
+    x = m * 2^e with m in [sqrt (0.5), sqrt (2)), taken apart with integer
+    ops on the float's bits. ln (m) = t - t^2 / 2 + t^3 * P (t), t = m - 1,
+    with Cephes' degree 8 minimax P for logf (relative error ~1e-7 over the
+    interval), and e * ln (2) added in two parts so big exponents don't lose
+    the low bits. Zero, negatives, denormals and NaN are first replaced by
+    the smallest normal float. */
+
+namespace LogApprox
+{
+    static const float coefficients[9] =
+    {
+        7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f,
+        -1.2420140846e-1f, 1.4249322787e-1f, -1.6668057665e-1f,
+        2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f
+    };
+
+    static const float ln2High = 0.693359375f;      // exact in 10 bits
+    static const float ln2Low = -2.12194440e-4f;
+    static const float sqrt2 = 1.41421356f;
+
+    /* factor * log10 (x / reference) = ln (x) * scale + offset */
+    static inline void decibelScale (float reference, bool amplitude, float& scale, float& offset)
+    {
+        const double factor = amplitude ? 20.0 : 10.0;
+
+        scale = (float) (factor / std::log (10.0));
+        offset = (float) (-factor * std::log10 ((double) reference));
+    }
+}
+
+//----------------------------------------------------------------------------//
+
+/* SSE, 4 lanes. Baseline on every x86-64 CPU. */
+
+#if PANOGRAM_X86 && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PANOGRAM_HAS_SSE 1
+
+namespace SSEKernels
+{
+    static void add (const float* a, const float* b, float* dst, int n)
+    {
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps (dst + i, _mm_add_ps (_mm_loadu_ps (a + i), _mm_loadu_ps (b + i)));
+
+        ScalarKernels::add (a + i, b + i, dst + i, n - i);
+    }
+
+    static void multiply (const float* a, const float* b, float* dst, int n)
+    {
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps (dst + i, _mm_mul_ps (_mm_loadu_ps (a + i), _mm_loadu_ps (b + i)));
+
+        ScalarKernels::multiply (a + i, b + i, dst + i, n - i);
+    }
+
+    static void divide (const float* num, const float* den, float* dst, int n)
+    {
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps (dst + i, _mm_div_ps (_mm_loadu_ps (num + i), _mm_loadu_ps (den + i)));
+
+        ScalarKernels::divide (num + i, den + i, dst + i, n - i);
+    }
+
+    static void addScalar (const float* src, float scalar, float* dst, int n)
+    {
+        const __m128 s = _mm_set1_ps (scalar);
+
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps (dst + i, _mm_add_ps (_mm_loadu_ps (src + i), s));
+
+        ScalarKernels::addScalar (src + i, scalar, dst + i, n - i);
+    }
+
+    static void multiplyScalar (const float* src, float scalar, float* dst, int n)
+    {
+        const __m128 s = _mm_set1_ps (scalar);
+
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps (dst + i, _mm_mul_ps (_mm_loadu_ps (src + i), s));
+
+        ScalarKernels::multiplyScalar (src + i, scalar, dst + i, n - i);
+    }
+
+    static inline __m128 logApprox (__m128 x)
+    {
+        // max_ps gives its second operand when either is NaN, so NaN goes too
+        x = _mm_max_ps (x, _mm_set1_ps (FLT_MIN));
+
+        const __m128i bits = _mm_castps_si128 (x);
+        __m128i e = _mm_sub_epi32 (_mm_srli_epi32 (bits, 23), _mm_set1_epi32 (127));
+        __m128 m = _mm_or_ps (_mm_and_ps (x, _mm_castsi128_ps (_mm_set1_epi32 (0x007fffff))), _mm_set1_ps (1.0f));
+
+        // [sqrt (2), 2) down to [sqrt (0.5), 1), one more in the exponent (the mask is -1)
+        const __m128 high = _mm_cmpge_ps (m, _mm_set1_ps (LogApprox::sqrt2));
+        m = _mm_or_ps (_mm_and_ps (high, _mm_mul_ps (m, _mm_set1_ps (0.5f))), _mm_andnot_ps (high, m));
+        e = _mm_sub_epi32 (e, _mm_castps_si128 (high));
+
+        const __m128 t = _mm_sub_ps (m, _mm_set1_ps (1.0f));
+        const __m128 z = _mm_mul_ps (t, t);
+        const __m128 fe = _mm_cvtepi32_ps (e);
+
+        __m128 p = _mm_set1_ps (LogApprox::coefficients[0]);
+        for (int k = 1; k < 9; k++)
+            p = _mm_add_ps (_mm_mul_ps (p, t), _mm_set1_ps (LogApprox::coefficients[k]));
+
+        __m128 y = _mm_mul_ps (_mm_mul_ps (p, t), z);
+        y = _mm_add_ps (y, _mm_mul_ps (fe, _mm_set1_ps (LogApprox::ln2Low)));
+        y = _mm_sub_ps (y, _mm_mul_ps (z, _mm_set1_ps (0.5f)));
+
+        return _mm_add_ps (_mm_add_ps (t, y), _mm_mul_ps (fe, _mm_set1_ps (LogApprox::ln2High)));
+    }
+
+    static void decibels (const float* src, float reference, float* dst, int n, bool amplitude)
+    {
+        float scale, offset;
+        LogApprox::decibelScale (reference, amplitude, scale, offset);
+
+        const __m128 s = _mm_set1_ps (scale), o = _mm_set1_ps (offset);
+
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps (dst + i, _mm_add_ps (_mm_mul_ps (logApprox (_mm_loadu_ps (src + i)), s), o));
+
+        // the tail through one padded vector, so a value comes out the same in any lane
+        if (i < n)
+        {
+            float tail[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            std::memcpy (tail, src + i, (size_t) (n - i) * sizeof (float));
+            _mm_storeu_ps (tail, _mm_add_ps (_mm_mul_ps (logApprox (_mm_loadu_ps (tail)), s), o));
+            std::memcpy (dst + i, tail, (size_t) (n - i) * sizeof (float));
+        }
+    }
+
+    static void intensity (const float* src, float floorDb, float rangeDb, float* dst, int n)
+    {
+        const float scale = 1.0f / rangeDb;
+        const __m128 s = _mm_set1_ps (scale), o = _mm_set1_ps (-floorDb * scale);
+
+        // max first: max_ps (NaN, 0) is 0, min_ps (NaN, 1) would be 1
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            const __m128 v = _mm_add_ps (_mm_mul_ps (_mm_loadu_ps (src + i), s), o);
+            _mm_storeu_ps (dst + i, _mm_min_ps (_mm_max_ps (v, _mm_setzero_ps()), _mm_set1_ps (1.0f)));
+        }
+
+        ScalarKernels::intensity (src + i, floorDb, rangeDb, dst + i, n - i);
+    }
+
+    static inline __m128i toInts (const float* src)
+    {
+        const __m128 v = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (src), _mm_setzero_ps()), _mm_set1_ps (1.0f));
+        return _mm_cvttps_epi32 (_mm_add_ps (_mm_mul_ps (v, _mm_set1_ps (255.0f)), _mm_set1_ps (0.5f)));
+    }
+
+    static void packBytes (const float* src, unsigned char* dst, int n)
+    {
+        int i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m128i lo = _mm_packs_epi32 (toInts (src + i), toInts (src + i + 4));
+            const __m128i hi = _mm_packs_epi32 (toInts (src + i + 8), toInts (src + i + 12));
+            _mm_storeu_si128 ((__m128i*) (dst + i), _mm_packus_epi16 (lo, hi));
+        }
+
+        ScalarKernels::packBytes (src + i, dst + i, n - i);
+    }
+}
+
+static const DSPKernelTable sseTable =
+{
+    "sse",
+    SSEKernels::add,
+    SSEKernels::multiply,
+    SSEKernels::divide,
+    SSEKernels::addScalar,
+    SSEKernels::multiplyScalar,
+    SSEKernels::decibels,
+    SSEKernels::intensity,
+    SSEKernels::packBytes
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
+
+/* AVX2, 8 lanes. Compiled with a per-function target so the rest of the file
+   stays baseline; only used when the CPU reports support. */
+
+#if PANOGRAM_X86
+#define PANOGRAM_HAS_AVX2 1
+
+namespace AVX2Kernels
+{
+    PANOGRAM_TARGET_AVX2 static void add (const float* a, const float* b, float* dst, int n)
+    {
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps (dst + i, _mm256_add_ps (_mm256_loadu_ps (a + i), _mm256_loadu_ps (b + i)));
+
+        ScalarKernels::add (a + i, b + i, dst + i, n - i);
+    }
+
+    PANOGRAM_TARGET_AVX2 static void multiply (const float* a, const float* b, float* dst, int n)
+    {
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps (dst + i, _mm256_mul_ps (_mm256_loadu_ps (a + i), _mm256_loadu_ps (b + i)));
+
+        ScalarKernels::multiply (a + i, b + i, dst + i, n - i);
+    }
+
+    PANOGRAM_TARGET_AVX2 static void divide (const float* num, const float* den, float* dst, int n)
+    {
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps (dst + i, _mm256_div_ps (_mm256_loadu_ps (num + i), _mm256_loadu_ps (den + i)));
+
+        ScalarKernels::divide (num + i, den + i, dst + i, n - i);
+    }
+
+    PANOGRAM_TARGET_AVX2 static void addScalar (const float* src, float scalar, float* dst, int n)
+    {
+        const __m256 s = _mm256_set1_ps (scalar);
+
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps (dst + i, _mm256_add_ps (_mm256_loadu_ps (src + i), s));
+
+        ScalarKernels::addScalar (src + i, scalar, dst + i, n - i);
+    }
+
+    PANOGRAM_TARGET_AVX2 static void multiplyScalar (const float* src, float scalar, float* dst, int n)
+    {
+        const __m256 s = _mm256_set1_ps (scalar);
+
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps (dst + i, _mm256_mul_ps (_mm256_loadu_ps (src + i), s));
+
+        ScalarKernels::multiplyScalar (src + i, scalar, dst + i, n - i);
+    }
+
+    PANOGRAM_TARGET_AVX2 static inline __m256 logApprox (__m256 x)
+    {
+        // as SSEKernels::logApprox, with fma
+        x = _mm256_max_ps (x, _mm256_set1_ps (FLT_MIN));
+
+        const __m256i bits = _mm256_castps_si256 (x);
+        __m256i e = _mm256_sub_epi32 (_mm256_srli_epi32 (bits, 23), _mm256_set1_epi32 (127));
+        __m256 m = _mm256_or_ps (_mm256_and_ps (x, _mm256_castsi256_ps (_mm256_set1_epi32 (0x007fffff))), _mm256_set1_ps (1.0f));
+
+        const __m256 high = _mm256_cmp_ps (m, _mm256_set1_ps (LogApprox::sqrt2), _CMP_GE_OQ);
+        m = _mm256_blendv_ps (m, _mm256_mul_ps (m, _mm256_set1_ps (0.5f)), high);
+        e = _mm256_sub_epi32 (e, _mm256_castps_si256 (high));
+
+        const __m256 t = _mm256_sub_ps (m, _mm256_set1_ps (1.0f));
+        const __m256 z = _mm256_mul_ps (t, t);
+        const __m256 fe = _mm256_cvtepi32_ps (e);
+
+        __m256 p = _mm256_set1_ps (LogApprox::coefficients[0]);
+        for (int k = 1; k < 9; k++)
+            p = _mm256_fmadd_ps (p, t, _mm256_set1_ps (LogApprox::coefficients[k]));
+
+        __m256 y = _mm256_mul_ps (_mm256_mul_ps (p, t), z);
+        y = _mm256_fmadd_ps (fe, _mm256_set1_ps (LogApprox::ln2Low), y);
+        y = _mm256_fnmadd_ps (z, _mm256_set1_ps (0.5f), y);
+
+        return _mm256_fmadd_ps (fe, _mm256_set1_ps (LogApprox::ln2High), _mm256_add_ps (t, y));
+    }
+
+    PANOGRAM_TARGET_AVX2 static void decibels (const float* src, float reference, float* dst, int n, bool amplitude)
+    {
+        float scale, offset;
+        LogApprox::decibelScale (reference, amplitude, scale, offset);
+
+        const __m256 s = _mm256_set1_ps (scale), o = _mm256_set1_ps (offset);
+
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps (dst + i, _mm256_fmadd_ps (logApprox (_mm256_loadu_ps (src + i)), s, o));
+
+        if (i < n)
+        {
+            float tail[8] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+            std::memcpy (tail, src + i, (size_t) (n - i) * sizeof (float));
+            _mm256_storeu_ps (tail, _mm256_fmadd_ps (logApprox (_mm256_loadu_ps (tail)), s, o));
+            std::memcpy (dst + i, tail, (size_t) (n - i) * sizeof (float));
+        }
+    }
+
+    PANOGRAM_TARGET_AVX2 static void intensity (const float* src, float floorDb, float rangeDb, float* dst, int n)
+    {
+        const float scale = 1.0f / rangeDb;
+        const __m256 s = _mm256_set1_ps (scale), o = _mm256_set1_ps (-floorDb * scale);
+
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            const __m256 v = _mm256_fmadd_ps (_mm256_loadu_ps (src + i), s, o);
+            _mm256_storeu_ps (dst + i, _mm256_min_ps (_mm256_max_ps (v, _mm256_setzero_ps()), _mm256_set1_ps (1.0f)));
+        }
+
+        ScalarKernels::intensity (src + i, floorDb, rangeDb, dst + i, n - i);
+    }
+
+    PANOGRAM_TARGET_AVX2 static inline __m256i toInts (const float* src)
+    {
+        // mul and add kept separate (no fma) to round like the scalar version
+        const __m256 v = _mm256_min_ps (_mm256_max_ps (_mm256_loadu_ps (src), _mm256_setzero_ps()), _mm256_set1_ps (1.0f));
+        const __m256 scaled = _mm256_mul_ps (v, _mm256_set1_ps (255.0f));
+        return _mm256_cvttps_epi32 (_mm256_add_ps (scaled, _mm256_set1_ps (0.5f)));
+    }
+
+    PANOGRAM_TARGET_AVX2 static void packBytes (const float* src, unsigned char* dst, int n)
+    {
+        // the packs work per 128 bit lane, the permute puts the 4 byte groups back in order
+        const __m256i order = _mm256_setr_epi32 (0, 4, 1, 5, 2, 6, 3, 7);
+
+        int i = 0;
+        for (; i + 32 <= n; i += 32)
+        {
+            const __m256i ab = _mm256_packs_epi32 (toInts (src + i), toInts (src + i + 8));
+            const __m256i cd = _mm256_packs_epi32 (toInts (src + i + 16), toInts (src + i + 24));
+            const __m256i bytes = _mm256_permutevar8x32_epi32 (_mm256_packus_epi16 (ab, cd), order);
+            _mm256_storeu_si256 ((__m256i*) (dst + i), bytes);
+        }
+
+        ScalarKernels::packBytes (src + i, dst + i, n - i);
+    }
+}
+
+static const DSPKernelTable avx2Table =
+{
+    "avx2",
+    AVX2Kernels::add,
+    AVX2Kernels::multiply,
+    AVX2Kernels::divide,
+    AVX2Kernels::addScalar,
+    AVX2Kernels::multiplyScalar,
+    AVX2Kernels::decibels,
+    AVX2Kernels::intensity,
+    AVX2Kernels::packBytes
+};
+
+static bool cpuHasAVX2()
+{
+   #if defined (_MSC_VER) && ! defined (__clang__)
+    int info[4];
+    __cpuid (info, 0);
+    if (info[0] < 7)
+        return false;
+
+    __cpuidex (info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+    __cpuid (info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    return avx2 && osxsave && (_xgetbv (0) & 6) == 6;
+   #else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+   #endif
+}
+
+#endif
+
+//----------------------------------------------------------------------------//
+
+/* NEON, 4 lanes. Always present on arm64. */
+
+#if PANOGRAM_NEON
+#define PANOGRAM_HAS_NEON 1
+
+namespace NEONKernels
+{
+    static void add (const float* a, const float* b, float* dst, int n)
+    {
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32 (dst + i, vaddq_f32 (vld1q_f32 (a + i), vld1q_f32 (b + i)));
+
+        ScalarKernels::add (a + i, b + i, dst + i, n - i);
+    }
+
+    static void multiply (const float* a, const float* b, float* dst, int n)
+    {
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32 (dst + i, vmulq_f32 (vld1q_f32 (a + i), vld1q_f32 (b + i)));
+
+        ScalarKernels::multiply (a + i, b + i, dst + i, n - i);
+    }
+
+    static void divide (const float* num, const float* den, float* dst, int n)
+    {
+        int i = 0;
+       #if defined (__aarch64__) || defined (_M_ARM64)
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32 (dst + i, vdivq_f32 (vld1q_f32 (num + i), vld1q_f32 (den + i)));
+       #endif
+
+        ScalarKernels::divide (num + i, den + i, dst + i, n - i);
+    }
+
+    static void addScalar (const float* src, float scalar, float* dst, int n)
+    {
+        const float32x4_t s = vdupq_n_f32 (scalar);
+
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32 (dst + i, vaddq_f32 (vld1q_f32 (src + i), s));
+
+        ScalarKernels::addScalar (src + i, scalar, dst + i, n - i);
+    }
+
+    static void multiplyScalar (const float* src, float scalar, float* dst, int n)
+    {
+        const float32x4_t s = vdupq_n_f32 (scalar);
+
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32 (dst + i, vmulq_f32 (vld1q_f32 (src + i), s));
+
+        ScalarKernels::multiplyScalar (src + i, scalar, dst + i, n - i);
+    }
+
+    static inline float32x4_t logApprox (float32x4_t x)
+    {
+        // as SSEKernels::logApprox; vmaxq would keep NaN, a compare doesn't
+        x = vbslq_f32 (vcgtq_f32 (x, vdupq_n_f32 (FLT_MIN)), x, vdupq_n_f32 (FLT_MIN));
+
+        const uint32x4_t bits = vreinterpretq_u32_f32 (x);
+        int32x4_t e = vsubq_s32 (vreinterpretq_s32_u32 (vshrq_n_u32 (bits, 23)), vdupq_n_s32 (127));
+        float32x4_t m = vreinterpretq_f32_u32 (vorrq_u32 (vandq_u32 (bits, vdupq_n_u32 (0x007fffff)), vdupq_n_u32 (0x3f800000)));
+
+        const uint32x4_t high = vcgeq_f32 (m, vdupq_n_f32 (LogApprox::sqrt2));
+        m = vbslq_f32 (high, vmulq_f32 (m, vdupq_n_f32 (0.5f)), m);
+        e = vsubq_s32 (e, vreinterpretq_s32_u32 (high));
+
+        const float32x4_t t = vsubq_f32 (m, vdupq_n_f32 (1.0f));
+        const float32x4_t z = vmulq_f32 (t, t);
+        const float32x4_t fe = vcvtq_f32_s32 (e);
+
+        float32x4_t p = vdupq_n_f32 (LogApprox::coefficients[0]);
+        for (int k = 1; k < 9; k++)
+            p = vmlaq_f32 (vdupq_n_f32 (LogApprox::coefficients[k]), p, t);
+
+        float32x4_t y = vmulq_f32 (vmulq_f32 (p, t), z);
+        y = vmlaq_f32 (y, fe, vdupq_n_f32 (LogApprox::ln2Low));
+        y = vmlsq_f32 (y, z, vdupq_n_f32 (0.5f));
+
+        return vmlaq_f32 (vaddq_f32 (t, y), fe, vdupq_n_f32 (LogApprox::ln2High));
+    }
+
+    static void decibels (const float* src, float reference, float* dst, int n, bool amplitude)
+    {
+        float scale, offset;
+        LogApprox::decibelScale (reference, amplitude, scale, offset);
+
+        const float32x4_t s = vdupq_n_f32 (scale), o = vdupq_n_f32 (offset);
+
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32 (dst + i, vmlaq_f32 (o, logApprox (vld1q_f32 (src + i)), s));
+
+        if (i < n)
+        {
+            float tail[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            std::memcpy (tail, src + i, (size_t) (n - i) * sizeof (float));
+            vst1q_f32 (tail, vmlaq_f32 (o, logApprox (vld1q_f32 (tail)), s));
+            std::memcpy (dst + i, tail, (size_t) (n - i) * sizeof (float));
+        }
+    }
+
+    static void intensity (const float* src, float floorDb, float rangeDb, float* dst, int n)
+    {
+        const float scale = 1.0f / rangeDb;
+        const float32x4_t s = vdupq_n_f32 (scale), o = vdupq_n_f32 (-floorDb * scale);
+        const float32x4_t zero = vdupq_n_f32 (0.0f);
+
+        // vmaxq keeps NaN, so the low clamp is a compare: NaN isn't > 0
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            const float32x4_t v = vmlaq_f32 (o, vld1q_f32 (src + i), s);
+            vst1q_f32 (dst + i, vminq_f32 (vbslq_f32 (vcgtq_f32 (v, zero), v, zero), vdupq_n_f32 (1.0f)));
+        }
+
+        ScalarKernels::intensity (src + i, floorDb, rangeDb, dst + i, n - i);
+    }
+
+    static inline uint16x4_t toShorts (const float* src)
+    {
+        const float32x4_t v = vminq_f32 (vmaxq_f32 (vld1q_f32 (src), vdupq_n_f32 (0.0f)), vdupq_n_f32 (1.0f));
+        const float32x4_t scaled = vmulq_f32 (v, vdupq_n_f32 (255.0f));
+        return vmovn_u32 (vcvtq_u32_f32 (vaddq_f32 (scaled, vdupq_n_f32 (0.5f))));
+    }
+
+    static void packBytes (const float* src, unsigned char* dst, int n)
+    {
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            vst1_u8 (dst + i, vmovn_u16 (vcombine_u16 (toShorts (src + i), toShorts (src + i + 4))));
+
+        ScalarKernels::packBytes (src + i, dst + i, n - i);
+    }
+}
+
+static const DSPKernelTable neonTable =
+{
+    "neon",
+    NEONKernels::add,
+    NEONKernels::multiply,
+    NEONKernels::divide,
+    NEONKernels::addScalar,
+    NEONKernels::multiplyScalar,
+    NEONKernels::decibels,
+    NEONKernels::intensity,
+    NEONKernels::packBytes
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
+
+namespace DSPKernels
+{
+    static const DSPKernelTable& chooseBest()
+    {
+       #if PANOGRAM_HAS_AVX2
+        if (cpuHasAVX2())
+            return avx2Table;
+       #endif
+
+       #if PANOGRAM_HAS_SSE
+        return sseTable;
+       #elif PANOGRAM_HAS_NEON
+        return neonTable;
+       #else
+        return scalarTable;
+       #endif
+    }
+
+    const DSPKernelTable& get()
+    {
+        static const DSPKernelTable& best = chooseBest();
+        return best;
+    }
+
+    const DSPKernelTable& scalar()
+    {
+        return scalarTable;
+    }
+
+    std::vector<const DSPKernelTable*> getAvailable()
+    {
+        std::vector<const DSPKernelTable*> tables;
+        tables.push_back (&scalarTable);
+
+       #if PANOGRAM_HAS_SSE
+        tables.push_back (&sseTable);
+       #endif
+
+       #if PANOGRAM_HAS_AVX2
+        if (cpuHasAVX2())
+            tables.push_back (&avx2Table);
+       #endif
+
+       #if PANOGRAM_HAS_NEON
+        tables.push_back (&neonTable);
+       #endif
+
+        return tables;
+    }
+
+    void hannWindow (float* dst, int n)
+    {
+        const double twoPi = 6.283185307179586;
+
+        for (int i = 0; i < n; i++)
+            dst[i] = (float) (0.5 * (1.0 - std::cos (twoPi * i / n)));
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef DSPKERNELS_H_INCLUDED
+#define DSPKERNELS_H_INCLUDED
+
+/*
+  ==============================================================================
+
+ Portable replacements for the handful of vDSP ops the panogram uses.
+
+ Every op has a scalar reference version plus SSE / AVX2 (x86) or NEON (ARM)
+ versions. The fastest one the CPU supports is picked once at startup, so the
+ same binary runs on the Mac, on the Linux capture nodes and on old boxes.
+
+ Plain C++ on purpose (no JUCE) so the headless tools and benchmarks can link
+ against it too.
+
+ note:
+ - argument order is (inputs..., output, count), NOT vDSP's (B, A) order
+ - all ops work in place (dst may alias a source)
+ - no alignment requirements
+ - the SIMD decibels use a polynomial log instead of std::log10, within
+   3e-5 dB of it up to +-200 dB and 2e-7 relative beyond (see the
+   benchmark); zero, negatives, denormals and NaN come out as the smallest
+   normal float (about -760 dB) instead of -inf or NaN
+
+  ==============================================================================
+*/
+
+#include <vector>
+
+//----------------------------------------------------------------------------//
+
+/* One implementation of every kernel, for one instruction set. */
+
+struct DSPKernelTable
+{
+    const char* name;
+
+    // dst = a + b
+    void (*add) (const float* a, const float* b, float* dst, int n);
+
+    // dst = a * b
+    void (*multiply) (const float* a, const float* b, float* dst, int n);
+
+    // dst = num / den
+    void (*divide) (const float* num, const float* den, float* dst, int n);
+
+    // dst = src + scalar
+    void (*addScalar) (const float* src, float scalar, float* dst, int n);
+
+    // dst = src * scalar
+    void (*multiplyScalar) (const float* src, float scalar, float* dst, int n);
+
+    // dst = 20 * log10 (src / reference), or 10 * log10 for power (vDSP_vdbcon)
+    void (*decibels) (const float* src, float reference, float* dst, int n, bool amplitude);
+
+    // dst = (src - floorDb) / rangeDb clamped to [0, 1] (dB to display intensity), NaN to 0
+    void (*intensity) (const float* src, float floorDb, float rangeDb, float* dst, int n);
+
+    // dst = src clamped to [0, 1] and scaled to 0..255, rounded (float pixels to 8 bit)
+    void (*packBytes) (const float* src, unsigned char* dst, int n);
+};
+
+//----------------------------------------------------------------------------//
+
+namespace DSPKernels
+{
+    /* Best table for this CPU, chosen on first call. */
+    const DSPKernelTable& get();
+
+    /* Reference implementation, always available. */
+    const DSPKernelTable& scalar();
+
+    /* Every table this CPU can run, scalar first (used by the benchmark). */
+    std::vector<const DSPKernelTable*> getAvailable();
+
+    /* Periodic hann window, peak 1.0 (same as vDSP_hann_window with vDSP_HANN_DENORM). */
+    void hannWindow (float* dst, int n);
+
+    //==========================================================================
+
+    inline void add (const float* a, const float* b, float* dst, int n)                { get().add (a, b, dst, n); }
+    inline void multiply (const float* a, const float* b, float* dst, int n)           { get().multiply (a, b, dst, n); }
+    inline void divide (const float* num, const float* den, float* dst, int n)         { get().divide (num, den, dst, n); }
+    inline void addScalar (const float* src, float scalar, float* dst, int n)          { get().addScalar (src, scalar, dst, n); }
+    inline void multiplyScalar (const float* src, float scalar, float* dst, int n)     { get().multiplyScalar (src, scalar, dst, n); }
+
+    inline void decibels (const float* src, float reference, float* dst, int n, bool amplitude = true)
+    {
+        get().decibels (src, reference, dst, n, amplitude);
+    }
+
+    inline void intensity (const float* src, float floorDb, float rangeDb, float* dst, int n)
+    {
+        get().intensity (src, floorDb, rangeDb, dst, n);
+    }
+
+    inline void packBytes (const float* src, unsigned char* dst, int n)               { get().packBytes (src, dst, n); }
+}
+
+#endif  // DSPKERNELS_H_INCLUDED
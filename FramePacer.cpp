@@ -0,0 +1,41 @@
+#include "FramePacer.h"
+
+//----------------------------------------------------------------------------//
+
+void FramePacer::reset()
+{
+    lastStartMs = -1.0e9;
+    averageCost = 0.0;
+    interval = refreshMs;
+    numRenders = 0;
+    rendersSinceChange = 0;
+    divisor = 1;
+}
+
+void FramePacer::addRender (double startMs, double costMs)
+{
+    // a quarter of each new cost, so one slow paint doesn't halve the rate
+    averageCost = numRenders == 0 ? costMs : averageCost + 0.25 * (costMs - averageCost);
+    lastStartMs = startMs;
+    numRenders++;
+    rendersSinceChange++;
+
+    const double wanted = averageCost / budget;
+    interval = wanted > refreshMs ? wanted : refreshMs;
+
+    if (rendersSinceChange < settleRenders)
+        return;
+
+    // the rate has given all it can: fewer pixels
+    if (interval > minimumMs && divisor < maxDivisor)
+    {
+        divisor *= 2;
+        rendersSinceChange = 0;
+    }
+    // even 4x the cost (4x the pixels, if it were all pixels) would leave room: more
+    else if (divisor > 1 && 4.0 * wanted < 0.75 * minimumMs && rendersSinceChange >= 4 * settleRenders)
+    {
+        divisor /= 2;
+        rendersSinceChange = 0;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef FRAMEPACER_H_INCLUDED
+#define FRAMEPACER_H_INCLUDED
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Decides when the display may draw its next frame, and at what resolution,
+  from what the last ones cost. The clock and the drawing are the caller's
+  (RenderScheduler in the app, a simulation in the benchmark), so this is
+  plain arithmetic on milliseconds.
+
+  The display gets budget (a share of the message thread, 0.5 by default)
+  for drawing. Each render's cost (localize, track, rasterize and paint)
+  goes into a running average, and renders are spaced
+      interval = max (1 / refresh rate, average cost / budget)
+  apart, so a cheap frame is drawn at the display's refresh rate and an
+  expensive one less often. Frames that arrive sooner are folded into the
+  next render by the caller.
+
+  Once that would mean fewer than minimumRate renders a second, the
+  resolution divisor doubles (a quarter of the pixels), up to maxDivisor.
+  It halves again once the average cost is low enough that 4 times as much
+  would still leave the rate a third above minimumRate. Each change waits
+  for settleRenders renders at the new resolution first (4 times that to
+  go back up), so it doesn't flap.
+
+ */
+
+class FramePacer
+{
+public:
+    enum
+    {
+        maxDivisor = 4,
+        settleRenders = 8
+    };
+
+    FramePacer() {}
+
+    void setRefreshRate (double hz)         { refreshMs = 1000.0 / hz; }
+    void setBudget (double share)           { budget = share; }
+    void setMinimumRate (double hz)         { minimumMs = 1000.0 / hz; }
+
+    /* Forgets the costs and goes back to full resolution. */
+    void reset();
+
+    /* A render that started at startMs took costMs. */
+    void addRender (double startMs, double costMs);
+
+    /* Earliest the next render may start. */
+    double getNextRenderMs() const          { return lastStartMs + interval; }
+
+    double getInterval() const              { return interval; }
+    double getAverageCost() const           { return averageCost; }
+
+    /* Draw at 1 / divisor of the full width and height. */
+    int getResolutionDivisor() const        { return divisor; }
+
+private:
+    double refreshMs = 1000.0 / 60.0;
+    double minimumMs = 1000.0 / 15.0;
+    double budget = 0.5;
+
+    double lastStartMs = -1.0e9;
+    double averageCost = 0.0;
+    double interval = 1000.0 / 60.0;
+    int numRenders = 0;
+    int rendersSinceChange = 0;
+    int divisor = 1;
+
+    FramePacer (const FramePacer&);
+    FramePacer& operator= (const FramePacer&);
+};
+
+#endif  // FRAMEPACER_H_INCLUDED
@@ -0,0 +1,162 @@
+#include "GeometryLocalizer.h"
+#include "DSPKernels.h"
+
+#include <cmath>
+
+//----------------------------------------------------------------------------//
+
+/* Adds one mic's row products for a block of bins. The sharpness is a
+   template parameter so the squarings unroll and the loop vectorises. */
+
+template <int numSquarings>
+static void accumulateMic (const float* __restrict magnitudes,
+                           const float* __restrict levelWeights, const float* __restrict denWeights,
+                           const float* __restrict xWeights, const float* __restrict yWeights,
+                           float* __restrict level, float* __restrict den,
+                           float* __restrict xSum, float* __restrict ySum, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const float m = magnitudes[i];
+
+        float f = m;
+        for (int s = 0; s < numSquarings; s++)
+            f *= f;
+
+        level[i] += levelWeights[i] * m;
+        den[i] += denWeights[i] * f;
+        xSum[i] += xWeights[i] * f;
+        ySum[i] += yWeights[i] * f;
+    }
+}
+
+static void divideBlock (const float* __restrict xSum, const float* __restrict ySum, const float* __restrict den,
+                         float* __restrict x, float* __restrict y, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const float inv = 1.0f / (den[i] + 1.0e-30f);
+        x[i] = xSum[i] * inv;
+        y[i] = ySum[i] * inv;
+    }
+}
+
+//----------------------------------------------------------------------------//
+
+void GeometryLocalizer::prepare (const ArrayGeometry& geometryToUse, int newNumBins, double newSampleRate,
+                                 const float* binHz)
+{
+    arrayGeometry = geometryToUse;
+    numBins = newNumBins;
+    sampleRate = newSampleRate;
+    numMics = (int) arrayGeometry.mics.size();
+
+    if (binHz == nullptr)
+        binFrequencies.clear();
+    else if (binHz != binFrequencies.data())
+        binFrequencies.assign (binHz, binHz + numBins);
+
+    xData.allocate (numBins);
+    yData.allocate (numBins);
+    gainData.allocate (numBins);
+
+    channels.clear();
+    weights.allocate ((size_t) numMics * numRows * numBins);
+
+    // bounding box of the mics -> 0..1 both ways (the middle if it's flat)
+    float minX = 1.0e30f, maxX = -1.0e30f, minY = 1.0e30f, maxY = -1.0e30f;
+
+    for (const ArrayMic& mic : arrayGeometry.mics)
+    {
+        minX = std::fmin (minX, mic.x); maxX = std::fmax (maxX, mic.x);
+        minY = std::fmin (minY, mic.y); maxY = std::fmax (maxY, mic.y);
+    }
+
+    const float p = (float) arrayGeometry.sharpness;
+    const float levelScale = 2.0f / numMics;
+
+    for (int c = 0; c < numMics; c++)
+    {
+        const ArrayMic& mic = arrayGeometry.mics[c];
+        // only a geometry built in code can get here with one out of range; parse() refuses it
+        channels.push_back (mic.channel >= 0 && mic.channel < maxChannels ? mic.channel : -1);
+
+        const float x = (maxX > minX) ? (mic.x - minX) / (maxX - minX) : 0.5f;
+        const float y = (maxY > minY) ? (mic.y - minY) / (maxY - minY) : 0.5f;
+
+        float* levelRow = weights + ((size_t) c * numRows) * numBins;
+        float* denRow = levelRow + numBins;
+        float* xRow = denRow + numBins;
+        float* yRow = xRow + numBins;
+
+        for (int bin = 0; bin < numBins; bin++)
+        {
+            const float hz = binFrequencies.empty() ? (float) (bin * sampleRate / (2.0 * numBins)) : binFrequencies[bin];
+            const float gain = std::pow (10.0f, arrayGeometry.getGainDb (mic, hz) / 20.0f);
+            const float sharpened = std::pow (gain, p);
+
+            levelRow[bin] = gain * levelScale;
+            denRow[bin] = sharpened;
+            xRow[bin] = sharpened * x;
+            yRow[bin] = sharpened * y;
+        }
+    }
+}
+
+void GeometryLocalizer::process (const SpectrumFrame& frame)
+{
+    if (frame.numBins != numBins)
+        prepare (arrayGeometry, frame.numBins, sampleRate);
+
+    // channels the frame doesn't have stay nullptr, and their mics are skipped
+    const float* pointers[maxChannels] = {};
+    const int numChannels = frame.numChannels < maxChannels ? frame.numChannels : maxChannels;
+
+    for (int ch = 0; ch < numChannels; ch++)
+        pointers[ch] = frame.getChannel (ch);
+
+    process (pointers);
+}
+
+void GeometryLocalizer::process (const float* const* channelMagnitudes)
+{
+    float level[blockSize], den[blockSize], xSum[blockSize], ySum[blockSize];
+
+    for (int start = 0; start < numBins; start += blockSize)
+    {
+        const int n = (numBins - start) < blockSize ? (numBins - start) : blockSize;
+
+        for (int i = 0; i < n; i++)
+            level[i] = den[i] = xSum[i] = ySum[i] = 0.0f;
+
+        for (int c = 0; c < numMics; c++)
+        {
+            if (channels[c] < 0 || channelMagnitudes[channels[c]] == nullptr)
+                continue;
+
+            const float* magnitudes = channelMagnitudes[channels[c]] + start;
+            const float* levelRow = weights + ((size_t) c * numRows) * numBins + start;
+            const float* denRow = levelRow + numBins;
+            const float* xRow = denRow + numBins;
+            const float* yRow = xRow + numBins;
+
+            switch (arrayGeometry.sharpness)
+            {
+                case 1:  accumulateMic<0> (magnitudes, levelRow, denRow, xRow, yRow, level, den, xSum, ySum, n); break;
+                case 2:  accumulateMic<1> (magnitudes, levelRow, denRow, xRow, yRow, level, den, xSum, ySum, n); break;
+                case 8:  accumulateMic<3> (magnitudes, levelRow, denRow, xRow, yRow, level, den, xSum, ySum, n); break;
+                default: accumulateMic<2> (magnitudes, levelRow, denRow, xRow, yRow, level, den, xSum, ySum, n); break;
+            }
+        }
+
+        divideBlock (xSum, ySum, den, xData + start, yData + start, n);
+
+        for (int i = 0; i < n; i++)
+            gainData[start + i] = level[i];
+    }
+
+    // dbscale, as QuadLocalizer does
+    const float offset = 1.0000000001f;
+    DSPKernels::addScalar (gainData, offset, gainData, numBins);
+    DSPKernels::decibels (gainData, zeroReference, gainData, numBins);
+}
@@ -0,0 +1,101 @@
+#ifndef GEOMETRYLOCALIZER_H_INCLUDED
+#define GEOMETRYLOCALIZER_H_INCLUDED
+
+#include "AlignedBuffer.h"
+#include "ArrayGeometry.h"
+#include "QuadLocalizer.h"
+#include "SpectrumFrame.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Localization for any array described by an ArrayGeometry.
+
+  Per bin, the position is the centroid of the mic positions weighted by
+  each mic's corrected level raised to the geometry's sharpness:
+      x = sum (w_c * x_c * m_c^p) / sum (w_c * m_c^p),   w_c = gain_c^p
+  and y the same. With p = 1 and two mics that is exactly R / (L + R);
+  higher p pulls the estimate towards the loudest mic, which on the 3x3
+  array beats the one-quad UDLR estimate by about 2x for p = 4 (see
+  Benchmarks/GeometryLocalizerBenchmark.cpp). gain is the dB level of all
+  mics, scaled to two mics' worth like GridLocalizer.
+
+  prepare() compiles the geometry once into per-bin weight rows (level,
+  denominator, x, y for every mic and bin, gain and eq folded in), so a
+  frame is a matrix-vector product per bin and nothing else: no geometry
+  lookups, no branches, no pow(). The product runs a block of bins at a
+  time with every mic accumulated into the same few L1-resident sums,
+  each inner loop a straight vectorisable pass over contiguous bins.
+
+  note:
+  - bins are assumed to be the first half of an fft of 2 * numBins, for
+    the eq frequencies, unless prepare() is given their frequencies
+  - mode number 3, next to QuadLocalizer's 0, 1 and GridLocalizer's 2
+
+ */
+
+class GeometryLocalizer
+{
+public:
+    enum
+    {
+        geometry = 3,
+        maxChannels = ArrayGeometry::maxChannels    // for process (SpectrumFrame)
+    };
+
+    GeometryLocalizer() {}
+
+    /* Compiles the weight tables. Allocates. binHz gives each bin's frequency
+       for the eq when the bins aren't fft bins (bands, see BandAggregator). */
+    void prepare (const ArrayGeometry& geometryToUse, int numBins, double sampleRate,
+                  const float* binHz = nullptr);
+
+    int getNumBins() const                      { return numBins; }
+    double getSampleRate() const                { return sampleRate; }
+    const ArrayGeometry& getGeometry() const    { return arrayGeometry; }
+
+    /* channelMagnitudes[c] is channel c's spectrum, getNumBins() long, for
+       every channel the geometry uses; mics whose channel is nullptr are
+       left out. */
+    void process (const float* const* channelMagnitudes);
+
+    /* Re-prepares with the same geometry, over fft bins, if the frame's size
+       changed. Mics on channels the frame doesn't have are left out. */
+    void process (const SpectrumFrame& frame);
+
+    LocalizationFrame getFrame() const
+    {
+        LocalizationFrame frame = { numBins, xData, yData, gainData, gainData };
+        return frame;
+    }
+
+    float zeroReference = 1.1f;     // same as QuadLocalizer
+
+private:
+    enum
+    {
+        blockSize = 128,    // bins per pass over the mics
+        numRows = 4         // level, denominator, x, y
+    };
+
+    ArrayGeometry arrayGeometry;
+    int numBins = 0;
+    double sampleRate = 44100.0;
+    int numMics = 0;
+
+    std::vector<int> channels;      // per mic, -1 if above maxChannels
+    std::vector<float> binFrequencies;  // empty for fft bins
+    AlignedBuffer<float> weights;   // [mic][row][bin]
+
+    AlignedBuffer<float> xData;
+    AlignedBuffer<float> yData;
+    AlignedBuffer<float> gainData;
+
+    GeometryLocalizer (const GeometryLocalizer&);
+    GeometryLocalizer& operator= (const GeometryLocalizer&);
+};
+
+#endif  // GEOMETRYLOCALIZER_H_INCLUDED
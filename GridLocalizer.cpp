@@ -0,0 +1,105 @@
+#include "GridLocalizer.h"
+#include "DSPKernels.h"
+
+//----------------------------------------------------------------------------//
+
+const int GridLocalizer::layout[3][3] =
+{
+    { 2, 5, 6 },
+    { 1, 4, 7 },
+    { 0, 3, 8 }
+};
+
+/* s^15 */
+static inline float power15 (float s)
+{
+    const float s2 = s * s, s4 = s2 * s2, s8 = s4 * s4;
+    return s8 * s4 * s2 * s;
+}
+
+/* Every quad and the fusion in one pass. Restrict parameters (not locals)
+   so the compiler knows nothing aliases and vectorises the loop. */
+
+static void localizeGrid (const float* __restrict m00, const float* __restrict m01, const float* __restrict m02,
+                          const float* __restrict m10, const float* __restrict m11, const float* __restrict m12,
+                          const float* __restrict m20, const float* __restrict m21, const float* __restrict m22,
+                          float* __restrict x, float* __restrict y, float* __restrict level, int n)
+{
+    const float twoOfNine = 2.0f / 9.0f;
+
+    for (int i = 0; i < n; i++)
+    {
+        // row pairs: rowN[c] spans columns c, c + 1 of row N
+        const float row00 = m00[i] + m01[i], row01 = m01[i] + m02[i];
+        const float row10 = m10[i] + m11[i], row11 = m11[i] + m12[i];
+        const float row20 = m20[i] + m21[i], row21 = m21[i] + m22[i];
+
+        // column pairs: colN[r] spans rows r, r + 1 of column N (column 0 is
+        // only ever a left side, and x only needs the right ones)
+        const float col10 = m01[i] + m11[i], col11 = m11[i] + m21[i];
+        const float col20 = m02[i] + m12[i], col21 = m12[i] + m22[i];
+
+        // quad totals, upper left / upper right / lower left / lower right
+        const float tUL = row00 + row10, tUR = row01 + row11;
+        const float tLL = row10 + row20, tLR = row11 + row21;
+
+        // everything as a share of the four totals, so the weights can't overflow
+        const float inv = 1.0f / (tUL + tUR + tLL + tLR + 1.0e-30f);
+        const float sUL = tUL * inv, sUR = tUR * inv, sLL = tLL * inv, sLR = tLR * inv;
+
+        // weight w = (s + 0.01)^15 * s, which is s^16 near enough but doesn't go
+        // denormal for a merely quiet quad. Global x = (column + right / t) / 2,
+        // and s / t = 1 / T, so w * x = (column * w + (s + 0.01)^15 * right / T) / 2:
+        // no divide per quad
+        const float pUL = power15 (sUL + 0.01f), pUR = power15 (sUR + 0.01f);
+        const float pLL = power15 (sLL + 0.01f), pLR = power15 (sLR + 0.01f);
+        const float wUL = pUL * sUL, wUR = pUR * sUR, wLL = pLL * sLL, wLR = pLR * sLR;
+
+        const float sumX = pUL * col10 + pUR * col20 + pLL * col11 + pLR * col21;
+        const float sumY = pUL * row10 + pUR * row11 + pLL * row20 + pLR * row21;
+
+        const float scale = 0.5f / (wUL + wUR + wLL + wLR + 1.0e-30f);
+        x[i] = ((wUR + wLR) + sumX * inv) * scale;
+        y[i] = ((wLL + wLR) + sumY * inv) * scale;
+
+        level[i] = (row00 + row10 + row20 + m02[i] + m12[i] + m22[i]) * twoOfNine;
+    }
+}
+
+//----------------------------------------------------------------------------//
+
+void GridLocalizer::setNumBins (int newNumBins)
+{
+    numBins = newNumBins;
+
+    xData.allocate (numBins);
+    yData.allocate (numBins);
+    gainData.allocate (numBins);
+}
+
+void GridLocalizer::process (const SpectrumFrame& frame)
+{
+    if (frame.numBins != numBins)
+        setNumBins (frame.numBins);
+
+    const float* channels[9];
+    for (int ch = 0; ch < 9; ch++)
+        channels[ch] = frame.getChannel (ch);
+
+    process (channels);
+}
+
+void GridLocalizer::process (const float* const* channelMagnitudes)
+{
+    const float* const* m = channelMagnitudes;
+
+    localizeGrid (m[layout[0][0]], m[layout[0][1]], m[layout[0][2]],
+                  m[layout[1][0]], m[layout[1][1]], m[layout[1][2]],
+                  m[layout[2][0]], m[layout[2][1]], m[layout[2][2]],
+                  xData, yData, gainData, numBins);
+
+    // dbscale, as QuadLocalizer does
+    const float offset = 1.0000000001f;
+    DSPKernels::addScalar (gainData, offset, gainData, numBins);
+    DSPKernels::decibels (gainData, zeroReference, gainData, numBins);
+}
@@ -0,0 +1,80 @@
+#ifndef GRIDLOCALIZER_H_INCLUDED
+#define GRIDLOCALIZER_H_INCLUDED
+
+#include "AlignedBuffer.h"
+#include "QuadLocalizer.h"
+#include "SpectrumFrame.h"
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Localization over the whole 3x3 array instead of one 4-mic quad.
+
+  The array holds four overlapping 2x2 sub-quads (upper left, upper right,
+  lower left, lower right). Each one localizes the bin inside its own
+  square the way CORNERS mode does: x = right column / total,
+  y = lower row / total. The four positions are then mapped onto the full
+  array and averaged, each weighted by the 16th power of its quad's share
+  of the level, so the quad nearest the source all but decides, while the
+  handover between quads stays smooth. (Lower powers pull everything
+  towards the middle of the array; a hard pick of the loudest quad jumps at
+  the seams. See Benchmarks/GridLocalizerBenchmark.cpp.) The result covers
+  the whole array at twice the linear resolution of a single quad, and all
+  9 mics count.
+
+  Every magnitude spectrum is read once per frame. The row and column pair
+  sums are shared between the quads that use them (10 adds feed all 4
+  quads), and the fusion needs two divides per bin, none per quad. It all
+  runs in one straight loop over the bins that the compiler vectorises, so
+  the grid costs about as much as one quad, not four.
+
+  layout, 1-based mic numbers as they sit in the array (row 0 at the top):
+      3  6  7
+      2  5  8
+      1  4  9
+  which is what UDLR (6,4,2,8) and CORNERS (3,7,1,9) already assume.
+
+  gain and gainY are both the dB level of all 9 mics, scaled to two mics'
+  worth so the panogram's quiet threshold means the same as with UDLR.
+
+ */
+
+class GridLocalizer
+{
+public:
+    enum { grid = 2 };      // mode number, next to QuadLocalizer::udlr and ::corners
+
+    GridLocalizer() {}
+
+    /* Allocates for numBins. process (SpectrumFrame) calls this when the size changes. */
+    void setNumBins (int numBins);
+    int getNumBins() const                  { return numBins; }
+
+    /* channelMagnitudes[c] is channel c's spectrum, at least 9 channels. */
+    void process (const float* const* channelMagnitudes);
+    void process (const SpectrumFrame& frame);
+
+    LocalizationFrame getFrame() const
+    {
+        LocalizationFrame frame = { numBins, xData, yData, gainData, gainData };
+        return frame;
+    }
+
+    /* 0-based channel of each mic, [row][column]. */
+    static const int layout[3][3];
+
+    float zeroReference = 1.1f;     // same as QuadLocalizer
+
+private:
+    int numBins = 0;
+
+    AlignedBuffer<float> xData;
+    AlignedBuffer<float> yData;
+    AlignedBuffer<float> gainData;
+
+    GridLocalizer (const GridLocalizer&);
+    GridLocalizer& operator= (const GridLocalizer&);
+};
+
+#endif  // GRIDLOCALIZER_H_INCLUDED
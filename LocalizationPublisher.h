@@ -0,0 +1,196 @@
+#ifndef LOCALIZATIONPUBLISHER_H_INCLUDED
+#define LOCALIZATIONPUBLISHER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LocalizationSnapshot.h"
+#include "LocalizationStream.h"
+#include "SourceTracker.h"
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Sends the live localization to remote viewers over UDP, see
+  LocalizationStream.h for the packets.
+
+  The analysis thread hands every localized frame to addFrame(), which
+  folds it into a triple buffer (peak hold, see LocalizationSnapshot) and
+  wakes this thread: no sockets and no waiting on the analysis side. This
+  thread takes the newest snapshot, runs it through its own SourceTracker,
+  encodes it and sends every packet to every destination from one socket.
+  If the network is slow, frames are folded together instead of queued.
+
+  Destinations come from a text file, one per line:
+
+    # host port
+    192.168.1.20 9000
+    localhost 9001
+
+  note:
+  - prepare() stops the sender while it reallocates, so it goes with the
+    analysis thread's setParameters(), from the message thread
+  - UDP: a lost packet costs its bins until their next keyframe, nothing more
+
+ */
+
+class LocalizationPublisher : public Thread
+{
+public:
+    LocalizationPublisher() : Thread ("Panogram stream") {}
+
+    ~LocalizationPublisher()
+    {
+        stopThread (1000);
+    }
+
+    /* Reads destinations from a file as above. False with getLastError() if
+       a line can't be read; the lines before it are kept. */
+    bool loadDestinations (const File& file)
+    {
+        const StringArray lines (StringArray::fromLines (file.loadFileAsString()));
+
+        for (int i = 0; i < lines.size(); i++)
+        {
+            const String line (lines[i].upToFirstOccurrenceOf ("#", false, false).trim());
+
+            if (line.isEmpty())
+                continue;
+
+            StringArray tokens;
+            tokens.addTokens (line, true);
+            tokens.removeEmptyStrings();
+
+            const int port = tokens.size() == 2 ? tokens[1].getIntValue() : 0;
+
+            if (port <= 0 || port > 65535)
+            {
+                lastError = "line " + String (i + 1) + ": expected host and port";
+                return false;
+            }
+
+            addDestination (tokens[0], port);
+        }
+
+        return true;
+    }
+
+    /* While stopped. */
+    void addDestination (const String& host, int port)
+    {
+        jassert (! isThreadRunning());
+        hosts.add (host);
+        ports.add (port);
+    }
+
+    int getNumDestinations() const                  { return hosts.size(); }
+    const String& getLastError() const              { return lastError; }
+
+    /* Allocates everything for frames of numBins and (re)starts sending.
+       Message thread only. */
+    bool prepare (int numBins, const LocalizationStreamSettings& settings = LocalizationStreamSettings())
+    {
+        stopThread (1000);
+
+        if (! socketBound)
+        {
+            socketBound = socket.bindToPort (0);
+
+            if (! socketBound)
+            {
+                lastError = "can't open a UDP socket";
+                return false;
+            }
+        }
+
+        frames.allocate (numBins);
+        tracker.prepare (numBins);
+        encoder.prepare (numBins, settings);
+
+        startThread (5);
+        return true;
+    }
+
+    //==========================================================================
+
+    /* Analysis thread only. Never blocks on the network; frames with another
+       bin count than prepare() was given are ignored. */
+    void addFrame (const LocalizationFrame& frame)
+    {
+        LocalizationSnapshot& snapshot = frames.getWriteBuffer();
+
+        if (frame.numBins != snapshot.numBins)
+            return;
+
+        snapshot.add (frame);
+
+        // keep folding frames in until the sender has had the last lot
+        if (frames.isPublishedUnread())
+            return;
+
+        snapshot.sequence = ++lastSequence;
+        frames.publish();
+        frames.getWriteBuffer().clear();
+        notify();
+    }
+
+    int getNumFramesSent() const                    { return numFramesSent.get(); }
+    int64 getNumBytesSent() const                   { return numBytesSent.get(); }
+    int getNumSendErrors() const                    { return numSendErrors.get(); }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            if (! frames.acquireLatest())
+            {
+                wait (100);
+                continue;
+            }
+
+            tracker.process (frames.getReadBuffer().getFrame());
+
+            TrackedSource sources[SourceTracker::maxSources];
+            for (int k = 0; k < SourceTracker::maxSources; k++)
+                sources[k] = tracker.getSource (k);
+
+            encoder.encodeFrame (tracker.getFrame(), sources, SourceTracker::maxSources);
+
+            for (int d = 0; d < hosts.size(); d++)
+            {
+                for (int i = 0; i < encoder.getNumPackets(); i++)
+                {
+                    const int size = encoder.getPacketSize (i);
+
+                    if (socket.write (hosts[d], ports[d], encoder.getPacket (i), size) == size)
+                        numBytesSent += size;
+                    else
+                        ++numSendErrors;
+                }
+            }
+
+            ++numFramesSent;
+        }
+    }
+
+    StringArray hosts;
+    Array<int> ports;
+    String lastError;
+
+    DatagramSocket socket;
+    bool socketBound = false;
+
+    LocalizationTripleBuffer frames;
+    uint64 lastSequence = 0;
+
+    SourceTracker tracker;
+    LocalizationStreamEncoder encoder;
+
+    Atomic<int> numFramesSent;
+    Atomic<int64> numBytesSent;
+    Atomic<int> numSendErrors;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LocalizationPublisher)
+};
+
+#endif  // LOCALIZATIONPUBLISHER_H_INCLUDED
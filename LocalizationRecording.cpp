@@ -0,0 +1,804 @@
+#include "LocalizationRecording.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//----------------------------------------------------------------------------//
+
+namespace
+{
+    enum
+    {
+        formatVersion = 1,
+        headerBytes = 56,
+        chunkHeaderBytes = 20,
+        indexEntryBytes = 20,
+        footerBytes = 12,
+
+        numStreams = 4,         // x, y, gain, gainY
+        riceBlockSize = 64,
+        riceEscape = 24         // this many ones in a row: a raw 32-bit value follows
+    };
+
+    // gains go first: the reader needs them to know which positions were stored
+    const int streamOrder[numStreams] = { 2, 3, 0, 1 };
+
+    enum Predictor
+    {
+        noPrediction = 0,
+        previousFrame,
+        previousBin,
+        numPredictors
+    };
+
+    //==========================================================================
+
+    void putU32 (std::vector<uint8_t>& out, uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+            out.push_back ((uint8_t) (v >> (8 * i)));
+    }
+
+    void putU64 (std::vector<uint8_t>& out, uint64_t v)
+    {
+        putU32 (out, (uint32_t) v);
+        putU32 (out, (uint32_t) (v >> 32));
+    }
+
+    void putTag (std::vector<uint8_t>& out, const char* tag)
+    {
+        out.insert (out.end(), (const uint8_t*) tag, (const uint8_t*) tag + 4);
+    }
+
+    void putFloat (std::vector<uint8_t>& out, float v)      { uint32_t bits; std::memcpy (&bits, &v, 4); putU32 (out, bits); }
+    void putDouble (std::vector<uint8_t>& out, double v)    { uint64_t bits; std::memcpy (&bits, &v, 8); putU64 (out, bits); }
+
+    uint32_t getU32 (const uint8_t* p)      { return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24); }
+    uint64_t getU64 (const uint8_t* p)      { return (uint64_t) getU32 (p) | ((uint64_t) getU32 (p + 4) << 32); }
+    float getFloat (const uint8_t* p)       { const uint32_t bits = getU32 (p); float v; std::memcpy (&v, &bits, 4); return v; }
+    double getDouble (const uint8_t* p)     { const uint64_t bits = getU64 (p); double v; std::memcpy (&v, &bits, 8); return v; }
+
+    int seekTo (FILE* f, uint64_t pos)
+    {
+       #if defined (_WIN32)
+        return _fseeki64 (f, (__int64) pos, SEEK_SET);
+       #else
+        return fseeko (f, (off_t) pos, SEEK_SET);
+       #endif
+    }
+
+    uint64_t getFileSize (FILE* f)
+    {
+       #if defined (_WIN32)
+        _fseeki64 (f, 0, SEEK_END);
+        return (uint64_t) _ftelli64 (f);
+       #else
+        fseeko (f, 0, SEEK_END);
+        return (uint64_t) ftello (f);
+       #endif
+    }
+
+    bool readBytes (FILE* f, uint64_t pos, uint8_t* dest, size_t numBytes)
+    {
+        return seekTo (f, pos) == 0 && std::fread (dest, 1, numBytes, f) == numBytes;
+    }
+
+    //==========================================================================
+
+    uint32_t zigzag (int32_t v)     { return ((uint32_t) v << 1) ^ (uint32_t) (v >> 31); }
+    int32_t unzigzag (uint32_t v)   { return (int32_t) (v >> 1) ^ -(int32_t) (v & 1); }
+
+    /* A bin is quiet when its quantised L + R gain is at or below this. Both
+       ends work it out from the header, so it doesn't need storing. */
+    int getQuietSteps (const LocalizationRecordingInfo& info)
+    {
+        return (int) std::floor ((info.quietGainDb - info.gainMinDb) / info.gainStepDb + 0.5f);
+    }
+
+    int guessValue (const uint16_t* row, const uint16_t* previousRow, int b, int predictor)
+    {
+        if (predictor == previousFrame)
+            return previousRow != nullptr ? previousRow[b] : (b > 0 ? row[b - 1] : 0);
+
+        if (predictor == previousBin)
+            return b > 0 ? row[b - 1] : (previousRow != nullptr ? previousRow[0] : 0);
+
+        return 0;
+    }
+
+    /* Residuals of one stream under one predictor. With a gate (the quantised
+       gain stream), quiet bins are skipped: they only hold, so the reader can
+       fill them in. Returns how many residuals were written. */
+    size_t predict (const uint16_t* values, int numFrames, int numBins, int predictor,
+                    const uint16_t* gate, int quietSteps, uint32_t* residuals)
+    {
+        size_t n = 0;
+
+        for (int f = 0; f < numFrames; f++)
+        {
+            const uint16_t* row = values + (size_t) f * numBins;
+            const uint16_t* previousRow = f > 0 ? row - numBins : nullptr;
+            const uint16_t* gateRow = gate != nullptr ? gate + (size_t) f * numBins : nullptr;
+
+            for (int b = 0; b < numBins; b++)
+                if (gateRow == nullptr || gateRow[b] > quietSteps)
+                    residuals[n++] = zigzag ((int32_t) row[b] - guessValue (row, previousRow, b, predictor));
+        }
+
+        return n;
+    }
+
+    /* The inverse of predict(). Quiet bins take the previous frame's value, or
+       'holdStart' in the first frame. */
+    void reconstruct (const uint32_t* residuals, int numFrames, int numBins, int predictor,
+                      const uint16_t* gate, int quietSteps, uint16_t holdStart, uint16_t* values)
+    {
+        size_t n = 0;
+
+        for (int f = 0; f < numFrames; f++)
+        {
+            uint16_t* row = values + (size_t) f * numBins;
+            const uint16_t* previousRow = f > 0 ? row - numBins : nullptr;
+            const uint16_t* gateRow = gate != nullptr ? gate + (size_t) f * numBins : nullptr;
+
+            for (int b = 0; b < numBins; b++)
+            {
+                if (gateRow == nullptr || gateRow[b] > quietSteps)
+                    row[b] = (uint16_t) (guessValue (row, previousRow, b, predictor) + unzigzag (residuals[n++]));
+                else
+                    row[b] = previousRow != nullptr ? previousRow[b] : holdStart;
+            }
+        }
+    }
+
+    size_t countLoud (const uint16_t* gate, size_t numValues, int quietSteps)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < numValues; i++)
+            n += gate[i] > quietSteps ? 1 : 0;
+
+        return n;
+    }
+
+    //==========================================================================
+
+    /* LSB-first bit packer. */
+    struct BitWriter
+    {
+        BitWriter (std::vector<uint8_t>& outToUse) : out (outToUse) {}
+
+        void write (uint32_t value, int numBits)
+        {
+            accumulator |= (uint64_t) value << count;
+            count += numBits;
+
+            while (count >= 8)
+            {
+                out.push_back ((uint8_t) accumulator);
+                accumulator >>= 8;
+                count -= 8;
+            }
+        }
+
+        void flush()
+        {
+            if (count > 0)
+                out.push_back ((uint8_t) accumulator);
+
+            accumulator = 0;
+            count = 0;
+        }
+
+        std::vector<uint8_t>& out;
+        uint64_t accumulator = 0;
+        int count = 0;
+    };
+
+    struct BitReader
+    {
+        BitReader (const uint8_t* dataToUse, size_t sizeToUse) : data (dataToUse), size (sizeToUse) {}
+
+        /* Past the end it reads zeros; see getBitsConsumed(). */
+        void refill()
+        {
+            while (count <= 56)
+            {
+                if (position < size)
+                    accumulator |= (uint64_t) data[position] << count;
+
+                ++position;
+                count += 8;
+            }
+        }
+
+        uint32_t read (int numBits)
+        {
+            if (count < numBits)
+                refill();
+
+            const uint32_t value = (uint32_t) (accumulator & (((uint64_t) 1 << numBits) - 1));
+            accumulator >>= numBits;
+            count -= numBits;
+            return value;
+        }
+
+        /* Ones before the next zero, up to riceEscape. */
+        int readUnary()
+        {
+            if (count < riceEscape + 1)
+                refill();
+
+            int ones = 0;
+            while (ones < riceEscape && (accumulator & 1) != 0)
+            {
+                accumulator >>= 1;
+                ++ones;
+            }
+
+            // the terminating zero, unless this was an escape
+            accumulator >>= (ones < riceEscape ? 1 : 0);
+            count -= ones + (ones < riceEscape ? 1 : 0);
+            return ones;
+        }
+
+        uint64_t getBitsConsumed() const    { return (uint64_t) position * 8 - (uint64_t) count; }
+
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+        uint64_t accumulator = 0;
+        int count = 0;
+    };
+
+    int riceCost (const uint32_t* values, int n, int k)
+    {
+        int bits = 0;
+
+        for (int i = 0; i < n; i++)
+        {
+            const uint32_t q = values[i] >> k;
+            bits += q < (uint32_t) riceEscape ? (int) q + 1 + k : riceEscape + 32;
+        }
+
+        return bits;
+    }
+
+    /* Rice codes 'values' in blocks of riceBlockSize, each with its own 4-bit k. */
+    void riceEncode (const uint32_t* values, size_t numValues, std::vector<uint8_t>& out)
+    {
+        BitWriter writer (out);
+
+        for (size_t start = 0; start < numValues; start += riceBlockSize)
+        {
+            const int n = (int) std::min<size_t> (riceBlockSize, numValues - start);
+            const uint32_t* block = values + start;
+
+            // the mean residual is close to 2^k; check its neighbours
+            uint64_t sum = 0;
+            for (int i = 0; i < n; i++)
+                sum += block[i];
+
+            int guess = 0;
+            while (guess < 15 && ((uint64_t) 2 << guess) * n <= sum)
+                ++guess;
+
+            int k = guess;
+            int bestCost = riceCost (block, n, k);
+
+            for (int candidate = std::max (0, guess - 1); candidate <= std::min (15, guess + 1); candidate++)
+            {
+                const int cost = riceCost (block, n, candidate);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    k = candidate;
+                }
+            }
+
+            writer.write ((uint32_t) k, 4);
+
+            for (int i = 0; i < n; i++)
+            {
+                const uint32_t q = block[i] >> k;
+
+                if (q < (uint32_t) riceEscape)
+                {
+                    writer.write (((uint32_t) 1 << q) - 1, (int) q + 1);   // q ones and a zero
+                    if (k > 0)
+                        writer.write (block[i] & (((uint32_t) 1 << k) - 1), k);
+                }
+                else
+                {
+                    writer.write (((uint32_t) 1 << riceEscape) - 1, riceEscape);
+                    writer.write (block[i], 32);
+                }
+            }
+        }
+
+        writer.flush();
+    }
+
+    bool riceDecode (const uint8_t* data, size_t numBytes, uint32_t* values, size_t numValues)
+    {
+        BitReader reader (data, numBytes);
+
+        for (size_t start = 0; start < numValues; start += riceBlockSize)
+        {
+            const int n = (int) std::min<size_t> (riceBlockSize, numValues - start);
+            const int k = (int) reader.read (4);
+
+            for (int i = 0; i < n; i++)
+            {
+                const int q = reader.readUnary();
+
+                if (q < riceEscape)
+                    values[start + i] = ((uint32_t) q << k) | (k > 0 ? reader.read (k) : 0);
+                else
+                    values[start + i] = reader.read (32);
+            }
+        }
+
+        return reader.getBitsConsumed() <= (uint64_t) numBytes * 8;
+    }
+}
+
+//----------------------------------------------------------------------------//
+
+LocalizationRecordingWriter::~LocalizationRecordingWriter()
+{
+    close();
+}
+
+bool LocalizationRecordingWriter::open (const std::string& path, const LocalizationRecordingInfo& infoToUse)
+{
+    close();
+
+    info = infoToUse;
+    info.framesPerChunk = std::max (1, info.framesPerChunk);
+    info.positionBits = std::max (1, std::min (16, info.positionBits));
+
+    if (info.numBins < 1 || info.gainStepDb <= 0.0f)
+        return false;
+
+    file = std::fopen (path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    const size_t valuesPerChunk = (size_t) info.framesPerChunk * info.numBins;
+
+    for (int s = 0; s < numStreams; s++)
+        streams[s].assign (valuesPerChunk, 0);
+
+    residuals.assign (valuesPerChunk, 0);
+    payload.reserve (numStreams * valuesPerChunk);
+    candidate.reserve (valuesPerChunk);
+    best.reserve (valuesPerChunk);
+    chunkHeader.reserve (chunkHeaderBytes);
+    index.clear();
+
+    framesInChunk = 0;
+    numFramesWritten = 0;
+    ok = true;
+
+    std::vector<uint8_t> header;
+    putTag (header, "PNLR");
+    putU32 (header, formatVersion);
+    putU32 (header, (uint32_t) info.numBins);
+    putU32 (header, (uint32_t) info.fftSize);
+    putU32 (header, (uint32_t) info.hopSize);
+    putU32 (header, (uint32_t) info.framesPerChunk);
+    putDouble (header, info.sampleRate);
+    putU64 (header, (uint64_t) info.startTimeMs);
+    putU32 (header, (uint32_t) info.positionBits);
+    putFloat (header, info.gainStepDb);
+    putFloat (header, info.gainMinDb);
+    putFloat (header, info.quietGainDb);
+
+    ok = std::fwrite (header.data(), 1, header.size(), file) == header.size();
+    bytesWritten = header.size();
+    return ok;
+}
+
+void LocalizationRecordingWriter::addFrame (int64_t frameIndex, const LocalizationFrame& frame)
+{
+    if (file == nullptr || frame.numBins != info.numBins)
+        return;
+
+    // chunks hold consecutive frames only
+    if (framesInChunk > 0 && frameIndex != chunkFirstFrame + framesInChunk)
+        flushChunk();
+
+    if (framesInChunk == 0)
+        chunkFirstFrame = frameIndex;
+
+    const int numBins = info.numBins;
+    const size_t offset = (size_t) framesInChunk * numBins;
+    const float positionScale = (float) ((1 << info.positionBits) - 1);
+    const float gainScale = 1.0f / info.gainStepDb;
+
+    const float* positions[2] = { frame.x, frame.y };
+    const float* gains[2] = { frame.gain, frame.gainY };
+
+    for (int s = 0; s < 2; s++)
+    {
+        uint16_t* out = streams[2 + s].data() + offset;
+
+        if (gains[s] == nullptr)
+        {
+            std::fill (out, out + numBins, (uint16_t) 0);
+            continue;
+        }
+
+        for (int b = 0; b < numBins; b++)
+        {
+            const float steps = (gains[s][b] - info.gainMinDb) * gainScale + 0.5f;
+            out[b] = (uint16_t) (steps > 0.0f ? (steps < 65535.0f ? steps : 65535.0f) : 0.0f);
+        }
+    }
+
+    // the display draws a bin at (x, y) with the L + R gain; quiet ones hold
+    const uint16_t* gate = streams[2].data() + offset;
+    const int quietSteps = getQuietSteps (info);
+    const uint16_t holdStart = (uint16_t) ((1 << info.positionBits) / 2);
+
+    for (int s = 0; s < 2; s++)
+    {
+        uint16_t* out = streams[s].data() + offset;
+        const uint16_t* previous = framesInChunk > 0 ? out - numBins : nullptr;
+
+        for (int b = 0; b < numBins; b++)
+        {
+            if (gate[b] > quietSteps)
+            {
+                const float v = positions[s][b];
+                const float clamped = v >= 0.0f ? (v <= 1.0f ? v : 1.0f) : 0.0f;    // NaN (silent bin) -> 0
+                out[b] = (uint16_t) (clamped * positionScale + 0.5f);
+            }
+            else
+            {
+                out[b] = previous != nullptr ? previous[b] : holdStart;
+            }
+        }
+    }
+
+    ++framesInChunk;
+    ++numFramesWritten;
+
+    if (framesInChunk == info.framesPerChunk)
+        flushChunk();
+}
+
+bool LocalizationRecordingWriter::flushChunk()
+{
+    if (framesInChunk == 0)
+        return ok;
+
+    const int numBins = info.numBins;
+    const int quietSteps = getQuietSteps (info);
+    payload.clear();
+
+    for (int i = 0; i < numStreams; i++)
+    {
+        const int s = streamOrder[i];
+        const uint16_t* gate = s < 2 ? streams[2].data() : nullptr;
+        int bestPredictor = -1;
+
+        // try every predictor, keep the smallest
+        for (int predictor = 0; predictor < numPredictors; predictor++)
+        {
+            const size_t n = predict (streams[s].data(), framesInChunk, numBins, predictor, gate, quietSteps, residuals.data());
+
+            candidate.clear();
+            riceEncode (residuals.data(), n, candidate);
+
+            if (bestPredictor < 0 || candidate.size() < best.size())
+            {
+                best.swap (candidate);
+                bestPredictor = predictor;
+            }
+        }
+
+        payload.push_back ((uint8_t) bestPredictor);
+        putU32 (payload, (uint32_t) best.size());
+        payload.insert (payload.end(), best.begin(), best.end());
+    }
+
+    chunkHeader.clear();
+    putTag (chunkHeader, "CHNK");
+    putU32 (chunkHeader, (uint32_t) framesInChunk);
+    putU64 (chunkHeader, (uint64_t) chunkFirstFrame);
+    putU32 (chunkHeader, (uint32_t) payload.size());
+
+    IndexEntry entry = { chunkFirstFrame, (uint32_t) framesInChunk, bytesWritten };
+    index.push_back (entry);
+
+    ok = ok && std::fwrite (chunkHeader.data(), 1, chunkHeader.size(), file) == chunkHeader.size()
+            && std::fwrite (payload.data(), 1, payload.size(), file) == payload.size();
+
+    bytesWritten += chunkHeader.size() + payload.size();
+    framesInChunk = 0;
+    return ok;
+}
+
+bool LocalizationRecordingWriter::close()
+{
+    if (file == nullptr)
+        return false;
+
+    flushChunk();
+
+    std::vector<uint8_t> tail;
+    putTag (tail, "INDX");
+    putU32 (tail, (uint32_t) index.size());
+
+    for (size_t i = 0; i < index.size(); i++)
+    {
+        putU64 (tail, (uint64_t) index[i].firstFrame);
+        putU32 (tail, index[i].numFrames);
+        putU64 (tail, index[i].offset);
+    }
+
+    putU64 (tail, bytesWritten);
+    putTag (tail, "PNLE");
+
+    ok = ok && std::fwrite (tail.data(), 1, tail.size(), file) == tail.size();
+    bytesWritten += tail.size();
+
+    ok = (std::fclose (file) == 0) && ok;
+    file = nullptr;
+    return ok;
+}
+
+//----------------------------------------------------------------------------//
+
+LocalizationRecordingReader::~LocalizationRecordingReader()
+{
+    close();
+}
+
+void LocalizationRecordingReader::close()
+{
+    if (file != nullptr)
+        std::fclose (file);
+
+    file = nullptr;
+    index.clear();
+    numFrames = 0;
+    decodedChunk = (size_t) -1;
+    recovered = false;
+}
+
+bool LocalizationRecordingReader::open (const std::string& path)
+{
+    close();
+
+    file = std::fopen (path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    uint8_t header[headerBytes];
+
+    if (! readBytes (file, 0, header, headerBytes)
+         || std::memcmp (header, "PNLR", 4) != 0
+         || getU32 (header + 4) != formatVersion)
+    {
+        close();
+        return false;
+    }
+
+    info.numBins = (int) getU32 (header + 8);
+    info.fftSize = (int) getU32 (header + 12);
+    info.hopSize = (int) getU32 (header + 16);
+    info.framesPerChunk = (int) getU32 (header + 20);
+    info.sampleRate = getDouble (header + 24);
+    info.startTimeMs = (int64_t) getU64 (header + 32);
+    info.positionBits = (int) getU32 (header + 40);
+    info.gainStepDb = getFloat (header + 44);
+    info.gainMinDb = getFloat (header + 48);
+    info.quietGainDb = getFloat (header + 52);
+
+    if (info.numBins < 1 || info.hopSize < 1 || info.sampleRate <= 0.0
+         || info.positionBits < 1 || info.positionBits > 16)
+    {
+        close();
+        return false;
+    }
+
+    const uint64_t fileSize = getFileSize (file);
+
+    if (! readIndex (fileSize))
+    {
+        recovered = true;
+        scanChunks (fileSize);
+    }
+
+    for (size_t i = 0; i < index.size(); i++)
+        numFrames += index[i].numFrames;
+
+    return true;
+}
+
+bool LocalizationRecordingReader::readIndex (uint64_t fileSize)
+{
+    uint8_t footer[footerBytes];
+
+    if (fileSize < (uint64_t) headerBytes + 8 + footerBytes
+         || ! readBytes (file, fileSize - footerBytes, footer, footerBytes)
+         || std::memcmp (footer + 8, "PNLE", 4) != 0)
+        return false;
+
+    const uint64_t indexOffset = getU64 (footer);
+    uint8_t indexHeader[8];
+
+    if (indexOffset < headerBytes || indexOffset + 8 > fileSize - footerBytes
+         || ! readBytes (file, indexOffset, indexHeader, 8)
+         || std::memcmp (indexHeader, "INDX", 4) != 0)
+        return false;
+
+    const uint32_t numChunks = getU32 (indexHeader + 4);
+    if (indexOffset + 8 + (uint64_t) numChunks * indexEntryBytes != fileSize - footerBytes)
+        return false;
+
+    std::vector<uint8_t> entries ((size_t) numChunks * indexEntryBytes);
+    if (numChunks > 0 && std::fread (entries.data(), 1, entries.size(), file) != entries.size())
+        return false;
+
+    index.resize (numChunks);
+
+    for (uint32_t i = 0; i < numChunks; i++)
+    {
+        const uint8_t* e = entries.data() + (size_t) i * indexEntryBytes;
+        index[i].firstFrame = (int64_t) getU64 (e);
+        index[i].numFrames = getU32 (e + 8);
+        index[i].offset = getU64 (e + 12);
+    }
+
+    return true;
+}
+
+bool LocalizationRecordingReader::scanChunks (uint64_t fileSize)
+{
+    index.clear();
+
+    for (uint64_t pos = headerBytes; pos + chunkHeaderBytes <= fileSize;)
+    {
+        uint8_t chunkHeader[chunkHeaderBytes];
+
+        if (! readBytes (file, pos, chunkHeader, chunkHeaderBytes) || std::memcmp (chunkHeader, "CHNK", 4) != 0)
+            break;
+
+        const uint64_t payloadBytes = getU32 (chunkHeader + 16);
+        if (pos + chunkHeaderBytes + payloadBytes > fileSize)
+            break;      // cut off mid-write
+
+        IndexEntry entry = { (int64_t) getU64 (chunkHeader + 8), getU32 (chunkHeader + 4), pos };
+        index.push_back (entry);
+
+        pos += chunkHeaderBytes + payloadBytes;
+    }
+
+    return ! index.empty();
+}
+
+//----------------------------------------------------------------------------//
+
+int64_t LocalizationRecordingReader::getFirstFrame() const
+{
+    return index.empty() ? 0 : index.front().firstFrame;
+}
+
+int64_t LocalizationRecordingReader::getEndFrame() const
+{
+    return index.empty() ? 0 : index.back().firstFrame + index.back().numFrames;
+}
+
+int64_t LocalizationRecordingReader::getFrameAtTime (double seconds) const
+{
+    if (index.empty())
+        return 0;
+
+    const int64_t wanted = (int64_t) (seconds * info.sampleRate / info.hopSize);
+
+    if (wanted < getFirstFrame())
+        return getFirstFrame();
+
+    // last chunk starting at or before the frame; inside a gap, its last frame
+    IndexEntry key = { wanted, 0, 0 };
+    std::vector<IndexEntry>::const_iterator chunk =
+        std::upper_bound (index.begin(), index.end(), key,
+                          [] (const IndexEntry& a, const IndexEntry& b) { return a.firstFrame < b.firstFrame; }) - 1;
+
+    return std::min (wanted, chunk->firstFrame + (int64_t) chunk->numFrames - 1);
+}
+
+bool LocalizationRecordingReader::readFrame (int64_t frameIndex, LocalizationFrame& frame)
+{
+    if (index.empty() || frameIndex < getFirstFrame())
+        return false;
+
+    IndexEntry key = { frameIndex, 0, 0 };
+    const size_t chunk = (size_t) (std::upper_bound (index.begin(), index.end(), key,
+                                                     [] (const IndexEntry& a, const IndexEntry& b) { return a.firstFrame < b.firstFrame; })
+                                   - index.begin()) - 1;
+
+    const int64_t offsetInChunk = frameIndex - index[chunk].firstFrame;
+    if (offsetInChunk >= index[chunk].numFrames)
+        return false;
+
+    if (chunk != decodedChunk && ! decodeChunk (chunk))
+        return false;
+
+    const size_t offset = (size_t) offsetInChunk * info.numBins;
+
+    frame.numBins = info.numBins;
+    frame.x = decoded[0].data() + offset;
+    frame.y = decoded[1].data() + offset;
+    frame.gain = decoded[2].data() + offset;
+    frame.gainY = decoded[3].data() + offset;
+    return true;
+}
+
+bool LocalizationRecordingReader::decodeChunk (size_t chunk)
+{
+    decodedChunk = (size_t) -1;
+
+    uint8_t chunkHeader[chunkHeaderBytes];
+    if (! readBytes (file, index[chunk].offset, chunkHeader, chunkHeaderBytes) || std::memcmp (chunkHeader, "CHNK", 4) != 0)
+        return false;
+
+    const int chunkFrames = (int) getU32 (chunkHeader + 4);
+    const size_t payloadBytes = getU32 (chunkHeader + 16);
+    const size_t numValues = (size_t) chunkFrames * info.numBins;
+
+    payload.resize (payloadBytes);
+    if (payloadBytes > 0 && std::fread (payload.data(), 1, payloadBytes, file) != payloadBytes)
+        return false;
+
+    residuals.resize (numValues);
+    quantised.resize (numValues);
+    quantisedGain.resize (numValues);
+
+    const float positionStep = 1.0f / (float) ((1 << info.positionBits) - 1);
+    const int quietSteps = getQuietSteps (info);
+    const uint16_t holdStart = (uint16_t) ((1 << info.positionBits) / 2);
+    size_t pos = 0;
+
+    for (int i = 0; i < numStreams; i++)
+    {
+        const int s = streamOrder[i];
+
+        if (pos + 5 > payloadBytes)
+            return false;
+
+        const int predictor = payload[pos];
+        const size_t streamBytes = getU32 (payload.data() + pos + 1);
+        pos += 5;
+
+        // positions were only stored for audible bins, and the gain stream (already decoded) says which
+        const uint16_t* gate = s < 2 ? quantisedGain.data() : nullptr;
+        const size_t numStored = gate != nullptr ? countLoud (gate, numValues, quietSteps) : numValues;
+        uint16_t* values = s == 2 ? quantisedGain.data() : quantised.data();
+
+        if (predictor >= numPredictors || pos + streamBytes > payloadBytes
+             || ! riceDecode (payload.data() + pos, streamBytes, residuals.data(), numStored))
+            return false;
+
+        pos += streamBytes;
+
+        reconstruct (residuals.data(), chunkFrames, info.numBins, predictor, gate, quietSteps, holdStart, values);
+
+        decoded[s].resize (numValues);
+        float* out = decoded[s].data();
+
+        if (s < 2)
+            for (size_t v = 0; v < numValues; v++)
+                out[v] = values[v] * positionStep;
+        else
+            for (size_t v = 0; v < numValues; v++)
+                out[v] = info.gainMinDb + values[v] * info.gainStepDb;
+    }
+
+    decodedChunk = chunk;
+    return true;
+}
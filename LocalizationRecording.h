@@ -0,0 +1,173 @@
+#ifndef LOCALIZATIONRECORDING_H_INCLUDED
+#define LOCALIZATIONRECORDING_H_INCLUDED
+
+#include "QuadLocalizer.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Panogram recording (.pnlr): every bin of every localized frame, compact
+  enough to keep a day of it.
+
+  Per bin, x and y are quantised to positionBits (default 10, i.e. a 1024
+  pixel panogram) and both gains to gainStepDb steps above gainMinDb. Frames
+  are grouped into chunks of framesPerChunk. Inside a chunk each of the four
+  streams (x, y, gain, gainY) is predicted from the previous frame, the
+  previous bin or not at all, whichever is smallest for that chunk, and the
+  residuals are Rice coded in blocks of 64. Chunks decode on their own.
+
+  Positions are only stored for bins whose L + R gain is above quietGainDb
+  (default 0 dB, below which the panogram draws a bin fully transparent).
+  A quiet bin reads back with the position it had in the previous frame of
+  its chunk, or the centre at the start of one. Their noise-driven
+  positions would otherwise be most of the file. Gains are always stored.
+
+  An index of chunks is written at the end, so any frame or timestamp is a
+  binary search plus one chunk decode. A file whose writer died has no
+  index; the reader rebuilds it by walking the chunk headers instead, so at
+  most the last unflushed chunk is lost.
+
+  layout, all little endian:
+    header   char[4] "PNLR", uint32 version (1), uint32 numBins, uint32 fftSize,
+             uint32 hopSize, uint32 framesPerChunk, float64 sampleRate,
+             int64 startTimeMs, uint32 positionBits, float32 gainStepDb,
+             float32 gainMinDb, float32 quietGainDb
+    chunk    char[4] "CHNK", uint32 numFrames, int64 firstFrame, uint32 payloadBytes,
+             then per stream (gain, gainY, x, y): uint8 predictor, uint32 bytes,
+             Rice coded residuals (x and y: audible bins only)
+    index    char[4] "INDX", uint32 numChunks,
+             numChunks x (int64 firstFrame, uint32 numFrames, uint64 chunkOffset)
+    footer   uint64 indexOffset, char[4] "PNLE"
+
+  note:
+  - frames inside a chunk are consecutive; a gap in frame numbers starts a
+    new chunk
+  - frame f starts at f * hopSize / sampleRate seconds into the recording
+
+ */
+
+struct LocalizationRecordingInfo
+{
+    int numBins = 512;
+    int fftSize = 1024;
+    int hopSize = 1024;
+    double sampleRate = 44100.0;
+    int64_t startTimeMs = 0;        // wall clock time of frame 0, 0 if unknown
+
+    int framesPerChunk = 256;
+    int positionBits = 10;
+    float gainStepDb = 0.25f;
+    float gainMinDb = -20.0f;
+    float quietGainDb = 0.0f;       // positions of bins at or below this aren't kept
+};
+
+//----------------------------------------------------------------------------//
+
+/* Appends frames as they come. Buffers are allocated in open(); addFrame()
+   quantises into them and, once a chunk is full, encodes and writes it. */
+
+class LocalizationRecordingWriter
+{
+public:
+    LocalizationRecordingWriter() {}
+    ~LocalizationRecordingWriter();
+
+    bool open (const std::string& path, const LocalizationRecordingInfo& info);
+
+    /* Writes the last chunk and the index. */
+    bool close();
+
+    bool isOpen() const                 { return file != nullptr; }
+    int64_t getNumFrames() const        { return numFramesWritten; }
+    uint64_t getBytesWritten() const    { return bytesWritten; }
+
+    /* frame.numBins must match the info given to open(). */
+    void addFrame (int64_t frameIndex, const LocalizationFrame& frame);
+
+private:
+    bool flushChunk();
+
+    FILE* file = nullptr;
+    LocalizationRecordingInfo info;
+    bool ok = true;
+
+    std::vector<uint16_t> streams[4];   // [stream][frame * numBins + bin] of the current chunk
+    int framesInChunk = 0;
+    int64_t chunkFirstFrame = 0;
+
+    std::vector<uint8_t> payload, candidate, best, chunkHeader;
+    std::vector<uint32_t> residuals;
+
+    struct IndexEntry { int64_t firstFrame; uint32_t numFrames; uint64_t offset; };
+    std::vector<IndexEntry> index;
+
+    int64_t numFramesWritten = 0;
+    uint64_t bytesWritten = 0;
+
+    LocalizationRecordingWriter (const LocalizationRecordingWriter&);
+    LocalizationRecordingWriter& operator= (const LocalizationRecordingWriter&);
+};
+
+//----------------------------------------------------------------------------//
+
+/* Random access to a recording. Keeps the last decoded chunk, so reading
+   frames in order decodes each chunk once. */
+
+class LocalizationRecordingReader
+{
+public:
+    LocalizationRecordingReader() {}
+    ~LocalizationRecordingReader();
+
+    bool open (const std::string& path);
+    void close();
+
+    bool isOpen() const                                 { return file != nullptr; }
+    const LocalizationRecordingInfo& getInfo() const    { return info; }
+
+    /* True if the file had no index (its writer never closed it). */
+    bool wasRecovered() const                           { return recovered; }
+
+    int64_t getFirstFrame() const;
+    int64_t getEndFrame() const;                        // one past the last frame
+    int64_t getNumFrames() const                        { return numFrames; }
+
+    double getFrameTime (int64_t frameIndex) const      { return frameIndex * (double) info.hopSize / info.sampleRate; }
+
+    /* The last frame starting at or before 'seconds', clamped to the recording. */
+    int64_t getFrameAtTime (double seconds) const;
+
+    /* Decodes the frame into 'frame', which points into this reader until
+       the next call. False if the frame isn't in the recording. */
+    bool readFrame (int64_t frameIndex, LocalizationFrame& frame);
+
+private:
+    bool readIndex (uint64_t fileSize);
+    bool scanChunks (uint64_t fileSize);
+    bool decodeChunk (size_t chunk);
+
+    FILE* file = nullptr;
+    LocalizationRecordingInfo info;
+    bool recovered = false;
+
+    struct IndexEntry { int64_t firstFrame; uint32_t numFrames; uint64_t offset; };
+    std::vector<IndexEntry> index;
+    int64_t numFrames = 0;
+
+    size_t decodedChunk = (size_t) -1;
+    std::vector<uint8_t> payload;
+    std::vector<uint32_t> residuals;
+    std::vector<uint16_t> quantised, quantisedGain;
+    std::vector<float> decoded[4];      // [stream][frame * numBins + bin]
+
+    LocalizationRecordingReader (const LocalizationRecordingReader&);
+    LocalizationRecordingReader& operator= (const LocalizationRecordingReader&);
+};
+
+#endif  // LOCALIZATIONRECORDING_H_INCLUDED
@@ -0,0 +1,93 @@
+#ifndef LOCALIZATIONSNAPSHOT_H_INCLUDED
+#define LOCALIZATIONSNAPSHOT_H_INCLUDED
+
+#include "QuadLocalizer.h"
+#include "TripleBuffer.h"
+
+#include <cstdint>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Localized frames folded into one for display.
+
+  When frames come faster than the panogram repaints (replay at 50x), each
+  bin keeps the loudest of them: x, y and gain from the frame with the
+  highest L + R gain, gainY the highest U + D. A short loud event shows up
+  however many frames it shares a repaint with.
+
+ */
+
+struct LocalizationSnapshot
+{
+    void allocate (int numBinsToUse)
+    {
+        numBins = numBinsToUse;
+        x.allocate (numBins);
+        y.allocate (numBins);
+        gain.allocate (numBins);
+        gainY.allocate (numBins);
+        clear();
+    }
+
+    void clear()
+    {
+        numFramesAggregated = 0;
+        afterSeek = false;
+    }
+
+    /* Peak-holds one more frame. frame.numBins must match. */
+    void add (const LocalizationFrame& frame)
+    {
+        const bool first = numFramesAggregated == 0;
+
+        for (int i = 0; i < numBins; i++)
+        {
+            if (first || frame.gain[i] > gain[i])
+            {
+                x[i] = frame.x[i];
+                y[i] = frame.y[i];
+                gain[i] = frame.gain[i];
+            }
+
+            const float newGainY = frame.gainY != nullptr ? frame.gainY[i] : frame.gain[i];
+            if (first || newGainY > gainY[i])
+                gainY[i] = newGainY;
+        }
+
+        ++numFramesAggregated;
+    }
+
+    LocalizationFrame getFrame() const
+    {
+        LocalizationFrame frame = { numBins, x, y, gain, gainY };
+        return frame;
+    }
+
+    uint64_t sequence = 0;
+    int numFramesAggregated = 0;
+    bool afterSeek = false;         // the first frames since a seek: nothing before them carries on
+    double time = 0.0;              // seconds into the recording of the last frame added
+    int numBins = 0;
+
+    AlignedBuffer<float> x, y, gain, gainY;
+};
+
+//----------------------------------------------------------------------------//
+
+/* Replay -> display handoff. */
+
+class LocalizationTripleBuffer : public TripleBuffer<LocalizationSnapshot>
+{
+public:
+    void allocate (int numBins)
+    {
+        for (int i = 0; i < numBuffers; i++)
+            getBuffer (i).allocate (numBins);
+
+        reset();
+    }
+};
+
+#endif  // LOCALIZATIONSNAPSHOT_H_INCLUDED
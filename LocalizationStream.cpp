@@ -0,0 +1,509 @@
+#include "LocalizationStream.h"
+
+#include <cmath>
+#include <cstring>
+
+//----------------------------------------------------------------------------//
+
+namespace
+{
+    enum
+    {
+        formatVersion = 1,
+        keyframeFlag = 1,
+        blobHeaderBytes = 21,
+        streamHeaderBytes = 3,
+        numStreams = 3,         // gain, x, y
+
+        dense = 0,
+        sparse = 1
+    };
+
+    const char binsAddress[] = "/panogram/bins";
+    const char sourcesAddress[] = "/panogram/sources";
+
+    int padded (int bytes)                  { return (bytes + 3) & ~3; }
+
+    //==========================================================================
+
+    void putU16 (uint8_t* p, uint32_t v)    { p[0] = (uint8_t) v; p[1] = (uint8_t) (v >> 8); }
+    void putU32 (uint8_t* p, uint32_t v)    { putU16 (p, v); putU16 (p + 2, v >> 16); }
+    void putFloat (uint8_t* p, float v)     { uint32_t bits; std::memcpy (&bits, &v, 4); putU32 (p, bits); }
+
+    uint32_t getU16 (const uint8_t* p)      { return (uint32_t) p[0] | ((uint32_t) p[1] << 8); }
+    uint32_t getU32 (const uint8_t* p)      { return getU16 (p) | (getU16 (p + 2) << 16); }
+    float getFloat (const uint8_t* p)       { const uint32_t bits = getU32 (p); float v; std::memcpy (&v, &bits, 4); return v; }
+
+    // OSC arguments are big endian
+    void putOscU32 (uint8_t* p, uint32_t v)     { p[0] = (uint8_t) (v >> 24); p[1] = (uint8_t) (v >> 16); p[2] = (uint8_t) (v >> 8); p[3] = (uint8_t) v; }
+    void putOscFloat (uint8_t* p, float v)      { uint32_t bits; std::memcpy (&bits, &v, 4); putOscU32 (p, bits); }
+    uint32_t getOscU32 (const uint8_t* p)       { return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3]; }
+    float getOscFloat (const uint8_t* p)        { const uint32_t bits = getOscU32 (p); float v; std::memcpy (&v, &bits, 4); return v; }
+
+    /* A null-terminated string padded to 4 bytes, the way OSC wants it. */
+    int putOscString (uint8_t* p, const char* s)
+    {
+        const int length = (int) std::strlen (s);
+        const int bytes = padded (length + 1);
+
+        std::memcpy (p, s, length);
+        std::memset (p + length, 0, bytes - length);
+        return bytes;
+    }
+
+    /* Length with padding, or -1 if there's no terminator in size bytes. */
+    int getOscStringBytes (const uint8_t* p, size_t size)
+    {
+        const void* end = std::memchr (p, 0, size);
+        if (end == nullptr)
+            return -1;
+
+        const int bytes = padded ((int) ((const uint8_t*) end - p) + 1);
+        return (size_t) bytes <= size ? bytes : -1;
+    }
+
+    //==========================================================================
+
+    // NaN fails every comparison, so the tests are written to send it to 0, as the recording does
+    uint8_t quantisePosition (float v)
+    {
+        const float clamped = ! (v > 0.0f) ? 0.0f : (v > 1.0f ? 1.0f : v);
+        return (uint8_t) (int) (clamped * 255.0f + 0.5f);
+    }
+
+    uint8_t quantiseGain (float db, float minDb, float stepDb)
+    {
+        const float steps = (db - minDb) / stepDb + 0.5f;
+        return (uint8_t) (! (steps > 0.0f) ? 0 : (steps >= 255.0f ? 255 : (int) steps));
+    }
+
+    /* One stream's differences, dense or sparse, whichever is smaller. Returns
+       the bytes written, header included. */
+    int writeStream (uint8_t* p, const uint8_t* values, int count)
+    {
+        // sparse: (zeros skipped, value) pairs, a run over 255 as (255, 0); trailing zeros left out
+        int sparseBytes = 0;
+        int run = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (values[i] == 0 && run < 255)
+            {
+                run++;
+                continue;
+            }
+
+            sparseBytes += 2;
+            run = 0;
+        }
+
+        uint8_t* data = p + streamHeaderBytes;
+
+        if (sparseBytes < count)
+        {
+            p[0] = sparse;
+            run = 0;
+            int n = 0;
+
+            for (int i = 0; i < count; i++)
+            {
+                if (values[i] == 0 && run < 255)
+                {
+                    run++;
+                    continue;
+                }
+
+                data[n++] = (uint8_t) run;
+                data[n++] = values[i];
+                run = 0;
+            }
+
+            putU16 (p + 1, (uint32_t) n);
+            return streamHeaderBytes + n;
+        }
+
+        p[0] = dense;
+        putU16 (p + 1, (uint32_t) count);
+        std::memcpy (data, values, count);
+        return streamHeaderBytes + count;
+    }
+
+    /* Reads a stream's count differences into deltas. Returns the bytes
+       read, or -1 if the stream is malformed. */
+    int readStream (const uint8_t* p, const uint8_t* end, uint8_t* deltas, int count)
+    {
+        if (end - p < streamHeaderBytes)
+            return -1;
+
+        const int coding = p[0];
+        const int bytes = (int) getU16 (p + 1);
+        const uint8_t* data = p + streamHeaderBytes;
+
+        if (end - data < bytes)
+            return -1;
+
+        if (coding == dense)
+        {
+            if (bytes != count)
+                return -1;
+
+            std::memcpy (deltas, data, count);
+        }
+        else if (coding == sparse)
+        {
+            if ((bytes & 1) != 0)
+                return -1;
+
+            std::memset (deltas, 0, count);
+            int position = 0;
+
+            for (int n = 0; n < bytes; n += 2)
+            {
+                position += data[n];
+
+                if (position >= count)
+                    return -1;
+
+                deltas[position++] = data[n + 1];
+            }
+        }
+        else
+        {
+            return -1;
+        }
+
+        return streamHeaderBytes + bytes;
+    }
+}
+
+//----------------------------------------------------------------------------//
+
+void LocalizationStreamEncoder::prepare (int newNumBins, const LocalizationStreamSettings& newSettings)
+{
+    settings = newSettings;
+    numBins = newNumBins;
+
+    const int binsPerPacket = settings.binsPerPacket;
+    const int binsBytes = padded ((int) sizeof (binsAddress)) + 4 + 4
+                            + padded (blobHeaderBytes + numStreams * (streamHeaderBytes + binsPerPacket));
+    const int sourcesBytes = padded ((int) sizeof (sourcesAddress)) + padded (2 + 4 * SourceTracker::maxSources + 1)
+                               + 4 + 16 * SourceTracker::maxSources;
+
+    maxPacketSize = binsBytes > sourcesBytes ? binsBytes : sourcesBytes;
+
+    const int maxPackets = 1 + (numBins + binsPerPacket - 1) / binsPerPacket;
+    packets.allocate ((size_t) maxPackets * maxPacketSize);
+    packetSizes.allocate (maxPackets);
+    numPackets = 0;
+
+    sentGain.allocate (numBins);
+    sentX.allocate (numBins);
+    sentY.allocate (numBins);
+    deltas.allocate ((size_t) numStreams * binsPerPacket);
+
+    framesSinceKeyframe = -1;
+}
+
+void LocalizationStreamEncoder::encodeFrame (const LocalizationFrame& frame, const TrackedSource* sources, int numSources)
+{
+    if (frame.numBins != numBins)
+        prepare (frame.numBins, settings);
+
+    ++sequence;
+
+    const bool keyframe = framesSinceKeyframe < 0 || ++framesSinceKeyframe >= settings.keyframeInterval;
+    if (keyframe)
+        framesSinceKeyframe = 0;
+
+    numPackets = 0;
+
+    packetSizes[numPackets] = encodeSources (packets, sources, numSources);
+    ++numPackets;
+
+    for (int first = 0; first < numBins; first += settings.binsPerPacket)
+    {
+        const int count = numBins - first < settings.binsPerPacket ? numBins - first : settings.binsPerPacket;
+        uint8_t* packet = packets + (size_t) numPackets * maxPacketSize;
+
+        packetSizes[numPackets] = encodeBins (packet, frame, first, count, keyframe);
+        ++numPackets;
+    }
+}
+
+int LocalizationStreamEncoder::encodeBins (uint8_t* packet, const LocalizationFrame& frame, int firstBin, int count, bool keyframe)
+{
+    uint8_t* p = packet;
+    p += putOscString (p, binsAddress);
+    p += putOscString (p, ",b");
+
+    uint8_t* blobSize = p;
+    uint8_t* blob = p + 4;
+
+    blob[0] = formatVersion;
+    blob[1] = keyframe ? keyframeFlag : 0;
+    putU16 (blob + 2, (uint32_t) numBins);
+    putU32 (blob + 4, sequence);
+    putU16 (blob + 8, (uint32_t) firstBin);
+    putU16 (blob + 10, (uint32_t) count);
+    putFloat (blob + 12, settings.gainMinDb);
+    putFloat (blob + 16, settings.gainStepDb);
+
+    const uint8_t quietStep = quantiseGain (settings.quietGainDb, settings.gainMinDb, settings.gainStepDb);
+    blob[20] = quietStep;
+
+    // differences from what the receivers have, quantised straight out of the frame
+    uint8_t* gainDeltas = deltas;
+    uint8_t* xDeltas = deltas + settings.binsPerPacket;
+    uint8_t* yDeltas = deltas + 2 * settings.binsPerPacket;
+    int numPositions = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const int b = firstBin + i;
+        const uint8_t g = quantiseGain (frame.gain[b], settings.gainMinDb, settings.gainStepDb);
+
+        gainDeltas[i] = (uint8_t) (g - (keyframe ? 0 : sentGain[b]));
+        sentGain[b] = g;
+
+        // a keyframe sends every position, so a receiver starting from it has them all
+        if (keyframe || g > quietStep)
+        {
+            const uint8_t qx = quantisePosition (frame.x[b]);
+            const uint8_t qy = quantisePosition (frame.y[b]);
+
+            xDeltas[numPositions] = (uint8_t) (qx - (keyframe ? 0 : sentX[b]));
+            yDeltas[numPositions] = (uint8_t) (qy - (keyframe ? 0 : sentY[b]));
+            sentX[b] = qx;
+            sentY[b] = qy;
+            numPositions++;
+        }
+    }
+
+    uint8_t* s = blob + blobHeaderBytes;
+    s += writeStream (s, gainDeltas, count);
+    s += writeStream (s, xDeltas, numPositions);
+    s += writeStream (s, yDeltas, numPositions);
+
+    const int blobBytes = (int) (s - blob);
+    const int paddedBytes = padded (blobBytes);
+    std::memset (s, 0, paddedBytes - blobBytes);
+    putOscU32 (blobSize, (uint32_t) blobBytes);
+
+    return (int) (blob - packet) + paddedBytes;
+}
+
+int LocalizationStreamEncoder::encodeSources (uint8_t* packet, const TrackedSource* sources, int numSources)
+{
+    int numActive = 0;
+    for (int k = 0; k < numSources && k < SourceTracker::maxSources; k++)
+        if (sources[k].id != 0)
+            numActive++;
+
+    char typeTags[2 + 4 * SourceTracker::maxSources + 1] = ",i";
+    for (int k = 0; k < numActive; k++)
+        std::memcpy (typeTags + 2 + 4 * k, "ifff", 4);
+    typeTags[2 + 4 * numActive] = 0;
+
+    uint8_t* p = packet;
+    p += putOscString (p, sourcesAddress);
+    p += putOscString (p, typeTags);
+
+    putOscU32 (p, sequence);
+    p += 4;
+
+    for (int k = 0; k < numSources && k < SourceTracker::maxSources; k++)
+    {
+        if (sources[k].id == 0)
+            continue;
+
+        putOscU32 (p, (uint32_t) sources[k].id);
+        putOscFloat (p + 4, sources[k].x);
+        putOscFloat (p + 8, sources[k].y);
+        putOscFloat (p + 12, sources[k].confidence);
+        p += 16;
+    }
+
+    return (int) (p - packet);
+}
+
+//----------------------------------------------------------------------------//
+
+void LocalizationStreamDecoder::prepare (int newNumBins)
+{
+    numBins = newNumBins;
+
+    quantisedGain.allocate (numBins);
+    quantisedX.allocate (numBins);
+    quantisedY.allocate (numBins);
+    binSequence.allocate (numBins);
+    binValid.allocate (numBins);
+    x.allocate (numBins);
+    y.allocate (numBins);
+    gain.allocate (numBins);
+    deltas.allocate ((size_t) 3 * numBins);
+
+    for (int i = 0; i < numBins; i++)
+        x[i] = y[i] = 0.5f;
+}
+
+int LocalizationStreamDecoder::getNumStaleBins() const
+{
+    int stale = 0;
+
+    for (int i = 0; i < numBins; i++)
+        if (binValid[i] == 0)
+            stale++;
+
+    return stale;
+}
+
+bool LocalizationStreamDecoder::receive (const void* data, size_t size)
+{
+    const uint8_t* p = (const uint8_t*) data;
+
+    const int addressBytes = getOscStringBytes (p, size);
+    const int tagBytes = addressBytes > 0 ? getOscStringBytes (p + addressBytes, size - addressBytes) : -1;
+
+    bool ok = false;
+
+    if (tagBytes > 0 && p[addressBytes] == ',')
+    {
+        const char* address = (const char*) p;
+        const char* typeTags = (const char*) p + addressBytes;
+        const uint8_t* args = p + addressBytes + tagBytes;
+        const size_t argBytes = size - addressBytes - tagBytes;
+
+        if (std::strcmp (address, binsAddress) == 0 && std::strcmp (typeTags, ",b") == 0 && argBytes >= 4)
+        {
+            const size_t blobBytes = getOscU32 (args);
+            ok = padded ((int) blobBytes) <= (int) argBytes - 4 && receiveBins (args + 4, blobBytes);
+        }
+        else if (std::strcmp (address, sourcesAddress) == 0)
+        {
+            ok = receiveSources (args, argBytes, typeTags);
+        }
+    }
+
+    if (ok)
+        ++numPacketsReceived;
+    else
+        ++numPacketsRejected;
+
+    return ok;
+}
+
+bool LocalizationStreamDecoder::receiveBins (const uint8_t* blob, size_t size)
+{
+    if (size < (size_t) blobHeaderBytes || blob[0] != formatVersion)
+        return false;
+
+    const bool keyframe = (blob[1] & keyframeFlag) != 0;
+    const int totalBins = (int) getU16 (blob + 2);
+    const uint32_t sequence = getU32 (blob + 4);
+    const int firstBin = (int) getU16 (blob + 8);
+    const int count = (int) getU16 (blob + 10);
+    const float gainMinDb = getFloat (blob + 12);
+    const float gainStepDb = getFloat (blob + 16);
+    const uint8_t quietStep = blob[20];
+
+    if (totalBins == 0 || count == 0 || firstBin + count > totalBins)
+        return false;
+
+    if (totalBins != numBins)
+        prepare (totalBins);
+
+    // a delta only applies on top of the packet just before it
+    if (! keyframe)
+    {
+        for (int b = firstBin; b < firstBin + count; b++)
+        {
+            if (binValid[b] == 0 || binSequence[b] + 1 != sequence)
+            {
+                std::memset (binValid + firstBin, 0, count);
+                return true;
+            }
+        }
+    }
+
+    // read everything before touching the bins, so a malformed packet leaves them as they were
+    const uint8_t* end = blob + size;
+    const uint8_t* s = blob + blobHeaderBytes;
+
+    uint8_t* gainDeltas = deltas;
+    uint8_t* xDeltas = deltas + numBins;
+    uint8_t* yDeltas = deltas + 2 * numBins;
+
+    int bytes = readStream (s, end, gainDeltas, count);
+    if (bytes < 0)
+        return false;
+    s += bytes;
+
+    // the sender gates positions on the new gain, so count them the same way
+    int numPositions = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        gainDeltas[i] = (uint8_t) (gainDeltas[i] + (keyframe ? 0 : quantisedGain[firstBin + i]));
+
+        if (keyframe || gainDeltas[i] > quietStep)
+            numPositions++;
+    }
+
+    bytes = readStream (s, end, xDeltas, numPositions);
+    if (bytes < 0 || readStream (s + bytes, end, yDeltas, numPositions) < 0)
+        return false;
+
+    numPositions = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const int b = firstBin + i;
+
+        quantisedGain[b] = gainDeltas[i];
+        gain[b] = gainMinDb + gainDeltas[i] * gainStepDb;
+
+        if (keyframe || gainDeltas[i] > quietStep)
+        {
+            quantisedX[b] = (uint8_t) (xDeltas[numPositions] + (keyframe ? 0 : quantisedX[b]));
+            quantisedY[b] = (uint8_t) (yDeltas[numPositions] + (keyframe ? 0 : quantisedY[b]));
+            x[b] = quantisedX[b] * (1.0f / 255.0f);
+            y[b] = quantisedY[b] * (1.0f / 255.0f);
+            numPositions++;
+        }
+
+        binSequence[b] = sequence;
+        binValid[b] = 1;
+    }
+
+    lastBinSequence = sequence;
+    return true;
+}
+
+bool LocalizationStreamDecoder::receiveSources (const uint8_t* args, size_t size, const char* typeTags)
+{
+    const int numTags = (int) std::strlen (typeTags) - 1;
+
+    if (numTags < 1 || typeTags[1] != 'i' || (numTags - 1) % 4 != 0 || (numTags - 1) / 4 > SourceTracker::maxSources
+         || size < (size_t) (4 * numTags))
+        return false;
+
+    for (int k = 0; k < (numTags - 1) / 4; k++)
+        if (std::memcmp (typeTags + 2 + 4 * k, "ifff", 4) != 0)
+            return false;
+
+    lastSourceSequence = getOscU32 (args);
+    numSources = (numTags - 1) / 4;
+
+    for (int k = 0; k < numSources; k++)
+    {
+        const uint8_t* p = args + 4 + 16 * k;
+
+        sources[k] = TrackedSource();
+        sources[k].id = (int) getOscU32 (p);
+        sources[k].x = getOscFloat (p + 4);
+        sources[k].y = getOscFloat (p + 8);
+        sources[k].confidence = getOscFloat (p + 12);
+    }
+
+    return true;
+}
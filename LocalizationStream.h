@@ -0,0 +1,165 @@
+#ifndef LOCALIZATIONSTREAM_H_INCLUDED
+#define LOCALIZATIONSTREAM_H_INCLUDED
+
+#include "AlignedBuffer.h"
+#include "QuadLocalizer.h"
+#include "SourceTracker.h"
+
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Localized frames as UDP datagrams, for viewers on other machines.
+
+  Every packet is a plain OSC message, so anything that speaks OSC can
+  route it. A frame is one "/panogram/sources" message and one
+  "/panogram/bins" message per binsPerPacket bins, all built together and
+  sent together:
+
+    /panogram/sources  ,i + ifff per source: sequence, then id, x, y,
+                       confidence of every tracked source (readable as is)
+    /panogram/bins     ,b with the blob below
+
+  blob, little endian:
+    uint8 version (1), uint8 flags (1 = keyframe), uint16 numBins,
+    uint32 sequence, uint16 firstBin, uint16 count, float32 gainMinDb,
+    float32 gainStepDb, uint8 quietStep,
+    then per stream (gain, x, y): uint8 coding, uint16 bytes, data
+
+  Per bin, gain is quantised to gainStepDb steps above gainMinDb and x, y
+  to 8 bits, one byte each. Every byte is sent as its difference from
+  what the receiver already has (mod 256). A keyframe is the difference
+  from 0, so it decodes on its own. Like the recording format, positions
+  only go out for bins whose gain is above quietStep; the others keep the
+  last one sent. A stream's data is either those differences as they are
+  ("dense") or (zeros skipped, difference) byte pairs ("sparse"), whichever
+  is smaller for that packet. Smoothed frames from the SourceTracker
+  change little from one frame to the next, so sparse usually wins.
+
+  A receiver that misses a delta packet can't apply the next one for those
+  bins. It marks them stale and waits for their next keyframe, which comes
+  every keyframeInterval frames. A viewer joining late waits the same way,
+  so any number of viewers can share one stream.
+
+  note:
+  - a packet is at most getMaxPacketSize() bytes, 824 at the default 256
+    bins per packet, under any Ethernet MTU
+  - the encoder quantises straight out of the frame it is handed into its
+    packet buffer; prepare() allocates, encodeFrame() never does
+  - the decoder re-prepares itself when the bin count changes
+
+ */
+
+struct LocalizationStreamSettings
+{
+    int binsPerPacket = 256;
+    int keyframeInterval = 32;      // frames
+    float gainMinDb = -20.0f;
+    float gainStepDb = 0.25f;
+    float quietGainDb = 0.0f;       // positions of bins at or below this aren't sent
+};
+
+//----------------------------------------------------------------------------//
+
+class LocalizationStreamEncoder
+{
+public:
+    LocalizationStreamEncoder() {}
+
+    /* Allocates the packet buffer and the receivers' reference. */
+    void prepare (int numBins, const LocalizationStreamSettings& settings = LocalizationStreamSettings());
+    int getNumBins() const                      { return numBins; }
+
+    /* Builds every packet of one frame. Sources with id 0 are left out. */
+    void encodeFrame (const LocalizationFrame& frame, const TrackedSource* sources, int numSources);
+
+    /* The next frame is a keyframe, e.g. for a viewer that just joined. */
+    void forceKeyframe()                        { framesSinceKeyframe = -1; }
+
+    int getNumPackets() const                   { return numPackets; }
+    const uint8_t* getPacket (int index) const  { return packets + (size_t) index * maxPacketSize; }
+    int getPacketSize (int index) const         { return packetSizes[index]; }
+
+    int getMaxPacketSize() const                { return maxPacketSize; }
+    uint32_t getSequence() const                { return sequence; }
+
+private:
+    int encodeBins (uint8_t* packet, const LocalizationFrame& frame, int firstBin, int count, bool keyframe);
+    int encodeSources (uint8_t* packet, const TrackedSource* sources, int numSources);
+
+    LocalizationStreamSettings settings;
+    int numBins = 0;
+    int maxPacketSize = 0;
+
+    AlignedBuffer<uint8_t> packets;         // [packet][maxPacketSize], the sources first
+    AlignedBuffer<int> packetSizes;
+    int numPackets = 0;
+
+    AlignedBuffer<uint8_t> sentGain;        // [bin], what the receivers have
+    AlignedBuffer<uint8_t> sentX, sentY;
+    AlignedBuffer<uint8_t> deltas;          // [3][binsPerPacket], one packet's streams
+
+    uint32_t sequence = 0;
+    int framesSinceKeyframe = -1;
+
+    LocalizationStreamEncoder (const LocalizationStreamEncoder&);
+    LocalizationStreamEncoder& operator= (const LocalizationStreamEncoder&);
+};
+
+//----------------------------------------------------------------------------//
+
+class LocalizationStreamDecoder
+{
+public:
+    LocalizationStreamDecoder() {}
+
+    /* Applies one packet. False if it isn't one of ours or is malformed;
+       a delta that can't be applied still returns true (see getNumStaleBins). */
+    bool receive (const void* data, size_t size);
+
+    /* The bins as of the newest packets; stale bins keep their last value. */
+    LocalizationFrame getFrame() const
+    {
+        LocalizationFrame frame = { numBins, x, y, gain, gain };
+        return frame;
+    }
+
+    int getNumBins() const                      { return numBins; }
+    int getNumStaleBins() const;
+    uint32_t getBinSequence() const             { return lastBinSequence; }
+
+    int getNumSources() const                   { return numSources; }
+    const TrackedSource& getSource (int index) const    { return sources[index]; }
+    uint32_t getSourceSequence() const          { return lastSourceSequence; }
+
+    int64_t getNumPackets() const               { return numPacketsReceived; }
+    int64_t getNumRejected() const              { return numPacketsRejected; }
+
+private:
+    bool receiveBins (const uint8_t* blob, size_t size);
+    bool receiveSources (const uint8_t* args, size_t size, const char* typeTags);
+    void prepare (int numBins);
+
+    int numBins = 0;
+    AlignedBuffer<uint8_t> quantisedGain, quantisedX, quantisedY;
+    AlignedBuffer<uint32_t> binSequence;    // [bin], sequence of the last packet applied
+    AlignedBuffer<uint8_t> binValid;
+    AlignedBuffer<float> x, y, gain;
+    AlignedBuffer<uint8_t> deltas;          // [3][bin], one packet's streams before they're applied
+    uint32_t lastBinSequence = 0;
+
+    TrackedSource sources[SourceTracker::maxSources];
+    int numSources = 0;
+    uint32_t lastSourceSequence = 0;
+
+    int64_t numPacketsReceived = 0;
+    int64_t numPacketsRejected = 0;
+
+    LocalizationStreamDecoder (const LocalizationStreamDecoder&);
+    LocalizationStreamDecoder& operator= (const LocalizationStreamDecoder&);
+};
+
+#endif  // LOCALIZATIONSTREAM_H_INCLUDED
@@ -15,13 +15,8 @@
  - dk, 2016
  
  todo:
- -> dynamic memory management
- -> variable fft size (will break lots of initializations)
  -> UI display paramaeters for gain scaling and display range
  -> UI select which audio channels output (currently output is 2-channel)
- -> newFFTData flag so don't redraw old data
- -> JUCE cross-platform equivalents for accelerate?
- -> numBins so not fft/2 all the time
  -> quad audio output
  
   ==============================================================================
@@ -2,46 +2,19 @@
 #define MAINCOMPONENT_H_INCLUDED
 
 #include "../JuceLibraryCode/JuceHeader.h"
-#include <Accelerate/Accelerate.h>
-
-//----------------------------------------------------------------------------//
-
-/* Ring Buffer to store audio data for STFT processing. */
-
-class RingFifo
-{
-public:
-    RingFifo() : abstractFifo (2048) // --> make at least 2x fft
-    {
-    }
-    
-    void addToFifo (const float* someData, int numItems)
-    {
-        int start1, size1, start2, size2;
-        abstractFifo.prepareToWrite (numItems, start1, size1, start2, size2);
-        if (size1 > 0)
-            memcpy (myBuffer + start1, someData, size1 * sizeof(float));
-        if (size2 > 0)
-            memcpy (myBuffer + start2, someData + size1, size2 * sizeof(float));
-        abstractFifo.finishedWrite (size1 + size2);
-    }
-    
-    void readFromFifo (float* someData, int numItems)
-    {
-        int start1, size1, start2, size2;
-        abstractFifo.prepareToRead (numItems, start1, size1, start2, size2);
-        if (size1 > 0)
-            memcpy (someData, myBuffer + start1, size1 * sizeof(float));
-        if (size2 > 0)
-            memcpy (someData + size1, myBuffer + start2, size2 * sizeof(float));
-        abstractFifo.finishedRead (size1 + size2);
-    }
-    
-    AbstractFifo abstractFifo;
-    
-private:
-    float myBuffer[2048];
-};
+#include "AnalysisThread.h"
+#include "AudioCallbackMonitor.h"
+#include "BandAggregator.h"
+#include "GeometryLocalizer.h"
+#include "GridLocalizer.h"
+#include "LocalizationPublisher.h"
+#include "PanogramRasterizer.h"
+#include "PipelineProfiler.h"
+#include "QuadLocalizer.h"
+#include "RenderScheduler.h"
+#include "ReplayThread.h"
+#include "SourceTracker.h"
+#include "TdoaLocalizer.h"
 
 //----------------------------------------------------------------------------//
 
@@ -49,128 +22,335 @@ private:
  
   4-channel localization using UDLR or CORNERS mic configuration.
   
+  mode 2 (GridLocalizer::grid) ignores the channels and uses all 9 mics,
+  mode 3 (GeometryLocalizer::geometry) whatever array setGeometry() gave,
+  mode 4 (TdoaLocalizer::tdoa, see setTdoa) time differences instead of levels.
+
   note:
   - CORNERS mode is TBD
-  - size of image determines downsampling resolution
+  - the image is as big as the component, up to maxResolution square;
+    drawing it is PanogramRasterizer's job
+  - every frame goes through a SourceTracker first: the image shows the
+    smoothed bins, and a ring is drawn over each tracked source, as
+    opaque as the tracker is confident
+  - setBands() folds the bins into bands over a frequency range before the
+    level modes localize them (BandAggregator), one point and hue per band
+  - setLevels() moves 0 dB (the localizers' reference) and the dB range
+    that fades from transparent to opaque
+  - setResolutionDivisor() draws into a smaller image when the scheduler
+    says drawing costs too much; paint() stretches it over the component
   
   features to make variable:
-  - db reference & colormap scaling
   - decay beta factor
  
  */
 
-class PanogramComp : public Component,
-                     private Timer
+class PanogramComp : public Component
 {
     
 public:
-    PanogramComp (float* fftDataToUse1, float* fftDataToUse2,
-                  float* fftDataToUse3, float* fftDataToUse4,
-                  float fftSizeToUse)
+    enum { maxResolution = 1024 };
+    
+    PanogramComp (int channelToUse1, int channelToUse2,
+                  int channelToUse3, int channelToUse4,
+                  int modeToUse)
     :
-    fftData1 (fftDataToUse1),  //  0 = Up    , 1 = UpperLeft
-    fftData2 (fftDataToUse2),  //  0 = Down  , 1 = UpperRight
-    fftData3 (fftDataToUse3),  //  0 = Left  , 1 = LowerLeft
-    fftData4 (fftDataToUse4),  //  0 = Right , 1 = LowerRight
-    fftSize (fftSizeToUse),
-    panogramImage (Image::RGB, 80, 80, true)
+    localizer (channelToUse1, channelToUse2, channelToUse3, channelToUse4, modeToUse),
+    mode (modeToUse),
+    levelMode (modeToUse),
+    panogramImage (Image::ARGB, 80, 80, true)
     {
-        startTimerHz (30);
+        rasterizer.setSize (80, 80);
+        rasterizer.setBilinear (true);
+        
+        // nothing here draws U + D, so the quad can skip its dB
+        localizer.setGainYUsed (false);
     }
     
-    void paint (Graphics& g) override
+    /* Draws a new analysis frame into the image. Reads the frame in place, and
+       does nothing if this frame has already been drawn. */
+    void newFrame (const SpectrumFrame& frame)
     {
-        // mode 0 UDLR
-        if (mode == 0) {
-            memcpy(fftDataU, fftData1, fftSize/2 * sizeof(float));
-            memcpy(fftDataD, fftData2, fftSize/2 * sizeof(float));
-            memcpy(fftDataL, fftData3, fftSize/2 * sizeof(float));
-            memcpy(fftDataR, fftData4, fftSize/2 * sizeof(float));
-        }
+        if (frame.sequence == 0 || frame.sequence == lastSequence)
+            return;
         
-        // mode 1 CORNERS
-        if (mode == 1) {
-            vDSP_vadd(fftData1, 1, fftData2, 1, fftDataU, 1, fftSize/2);
-            vDSP_vadd(fftData3, 1, fftData4, 1, fftDataD, 1, fftSize/2);
-            vDSP_vadd(fftData1, 1, fftData3, 1, fftDataL, 1, fftSize/2);
-            vDSP_vadd(fftData2, 1, fftData4, 1, fftDataR, 1, fftSize/2);
-        }
+        lastSequence = frame.sequence;
         
-        // compute crossover, gains
-        computeCrossoverGains(fftDataL, fftDataR, gainDataX1, xoverDataX1);
-        computeCrossoverGains(fftDataU, fftDataD, gainDataY1, xoverDataY1);
+        // compute crossover, db gains
+        LocalizationFrame localized;
+        {
+            PANOGRAM_PROFILE_SCOPE (PipelineProfiler::localize);
+            
+            // the level modes can work on bands instead; TDOA needs every bin's phase
+            const bool bands = usesBands() && mode != TdoaLocalizer::tdoa;
+            const SpectrumFrame& input = bands ? getBands (frame) : frame;
+            
+            // bands and bins are other points, whatever their number
+            if (bands != trackingBands)
+            {
+                trackingBands = bands;
+                tracker.reset();
+            }
+            
+            if (mode == TdoaLocalizer::tdoa)
+            {
+                tdoaLocalizer.process (frame);
+                localized = tdoaLocalizer.getFrame();
+            }
+            else if (mode == GeometryLocalizer::geometry)
+            {
+                geometryLocalizer.process (input);
+                localized = geometryLocalizer.getFrame();
+            }
+            else if (mode == GridLocalizer::grid)
+            {
+                gridLocalizer.process (input);
+                localized = gridLocalizer.getFrame();
+            }
+            else
+            {
+                localizer.process (input);
+                localized = localizer.getFrame();
+            }
+        }
         
-        // dbscale gains
-        Float32 kZeroReference = 1.1; // <- make param
-        Float32 offset = 1.0000000001;
-        vDSP_vsadd(gainDataX1, 1, &offset, gainDataX1, 1, fftSize/2);
-        vDSP_vdbcon(gainDataX1, 1, &kZeroReference, gainDataX1, 1, fftSize/2, 1);
-        vDSP_vsadd(gainDataY1, 1, &offset, gainDataY1, 1, fftSize/2);
-        vDSP_vdbcon(gainDataY1, 1, &kZeroReference, gainDataY1, 1, fftSize/2, 1);
+        drawFrame (localized);
+    }
+    
+    /* Localizes over this array from now on, whatever the constructor said;
+       again when the sample rate changes. Allocates. */
+    void setGeometry (const ArrayGeometry& geometry, double sampleRate)
+    {
+        geometryLocalizer.prepare (geometry, geometryLocalizer.getNumBins(), sampleRate);
+        bandsChanged = true;    // the eq wants the band frequencies back
         
-        // fade image
-        panogramImage.multiplyAllAlphas(0.9); // <- make param
+        if (levelMode != GeometryLocalizer::geometry)
+        {
+            levelMode = GeometryLocalizer::geometry;
+            setMode (mode == TdoaLocalizer::tdoa ? mode : levelMode);
+        }
+    }
+    
+    /* Switches between the level ratio mode and TDOA over this array. Prepares
+       TDOA the first time and when the sample rate changes. Allocates. */
+    void setTdoa (bool useTdoa, const ArrayGeometry& geometry, double sampleRate)
+    {
+        const double rate = sampleRate > 0.0 ? sampleRate : 44100.0;
         
-        // fill image
-        for (int i = 0; i < 512; i++)
+        if (useTdoa && (tdoaLocalizer.getNumBins() == 0 || tdoaLocalizer.getSampleRate() != rate))
         {
-            int xPix = xoverDataX1[i] * panogramImage.getWidth();
-            int yPix = xoverDataY1[i] * panogramImage.getHeight();
-            Colour color = Colour::fromHSV ((float)i/(fftSize/2.0f), 1.0f, 1.0f, gainDataX1[i]/0.5); // <- make param
+            // fft 1024 to start with; TdoaLocalizer::process re-prepares if the frames are another size
+            int fftOrder = 10;
+            while (tdoaLocalizer.getNumBins() > 0 && (1 << fftOrder) < 2 * tdoaLocalizer.getNumBins())
+                fftOrder++;
             
-            panogramImage.setPixelAt (xPix, yPix, color);
+            tdoaLocalizer.prepare (geometry, fftOrder, rate);
         }
         
-        // blackout
-        g.fillAll(Colours::transparentBlack);
+        setMode (useTdoa ? (int) TdoaLocalizer::tdoa : levelMode);
+    }
+    
+    /* Localizes per band instead of per fft bin, and only over minHz..maxHz
+       (see BandAggregator). BandAggregator::bins over the whole range is the
+       plain fft. The level modes only; TDOA stays per bin. Allocates on the
+       next frame. */
+    void setBands (BandAggregator::Scale scale, float newMinHz, float newMaxHz, double sampleRate)
+    {
+        const double rate = sampleRate > 0.0 ? sampleRate : 44100.0;
+        
+        if (scale == bandScale && newMinHz == minHz && newMaxHz == maxHz && rate == bandSampleRate)
+            return;
+        
+        bandScale = scale;
+        minHz = newMinHz;
+        maxHz = newMaxHz;
+        bandSampleRate = rate;
+        bandsChanged = true;    // the tracker starts again if the bands come out different
+    }
+    
+    bool usesBands() const
+    {
+        return bandScale != BandAggregator::bins || minHz > 0.0f || maxHz < 0.5 * bandSampleRate;
+    }
+    
+    /* zeroReference is the magnitude every localizer calls 0 dB (1.1 by
+       default, the tracker only weighs bins above it); floorDb and below
+       draws nothing, floorDb + rangeDb and above fully opaque. From the next
+       frame on. */
+    void setLevels (float zeroReference, float floorDb, float rangeDb)
+    {
+        localizer.zeroReference = zeroReference;
+        gridLocalizer.zeroReference = zeroReference;
+        geometryLocalizer.zeroReference = zeroReference;
+        tdoaLocalizer.zeroReference = zeroReference;
         
-        // draw image direct to bounding rectangle UDLR mode
-        if (mode == 0) {
-            g.drawImageWithin (panogramImage, 0, 0, getWidth(), getHeight(), RectanglePlacement::stretchToFit);
+        rasterizer.setLevelRange (floorDb, rangeDb);
+    }
+    
+    /* Forgets the sources being followed, e.g. when a replay jumps. */
+    void resetTracking()
+    {
+        tracker.reset();
+    }
+    
+    /* Draws an already localized frame, live or replayed. */
+    void drawFrame (const LocalizationFrame& localizedFrame)
+    {
+        // smooth the bins and follow the sources; allocates only when the fft size changes
+        {
+            PANOGRAM_PROFILE_SCOPE (PipelineProfiler::tracking);
+            tracker.process (localizedFrame);
         }
-        if (mode == 1) {
-            g.drawImageWithin (panogramImage, 0, 0, getWidth(), getHeight(), RectanglePlacement::stretchToFit);
+        
+        PANOGRAM_PROFILE_SCOPE (PipelineProfiler::rasterize);
+        const LocalizationFrame frame = tracker.getFrame();
+        
+        // hue per bin is a table, rebuilt only when the fft size changes
+        if (frame.numBins != rasterizer.getNumBins())
+            rasterizer.setNumBins (frame.numBins);
+        
+        rasterizer.addFrame (frame.x, frame.y, frame.gain, frame.numBins);
+        
+        // renders follow the frames and the pacer, so the fade goes by the time between them
+        const double now = Time::getMillisecondCounterHiRes();
+        const double elapsedMs = lastRenderMs > 0.0 ? now - lastRenderMs : 1000.0 / PanogramRasterizer::decayRate;
+        lastRenderMs = now;
+        
+        // straight into the image's pixels, then fade for next time
+        {
+            Image::BitmapData bitmap (panogramImage, Image::BitmapData::writeOnly);
+            jassert (bitmap.pixelStride == 4);
+            
+            rasterizer.render (bitmap.data, bitmap.lineStride, elapsedMs);
         }
+        
+        repaint();
     }
     
-    void computeCrossoverGains(float* fftDataL, float* fftDataR,
-                               float* gainData, float* xoverData)
+    /* 1 / divisor of the component's width and height from now on. Allocates. */
+    void setResolutionDivisor (int divisor)
     {
-        // gain = l + r
-        vDSP_vadd(fftDataL, 1, fftDataR, 1, gainData, 1, fftSize/2);
-        
-        // xover = r / gain
-        vDSP_vdiv(gainData, 1, fftDataR, 1, xoverData, 1, fftSize/2);
+        resolutionDivisor = jmax (1, divisor);
+        resized();
     }
     
+    /* What paint() has cost since the last call, in ms. */
+    double takePaintMs()
+    {
+        const double ms = paintMs;
+        paintMs = 0.0;
+        return ms;
+    }
     
-    int mode = 0; // microphone spatial configuration: 0 is Up/Down/Left/Right, 1 is corners
+    void resized() override
+    {
+        // one image pixel per screen pixel unless the scheduler backs off, so nothing gets stretched
+        const int width = jlimit (1, (int) maxResolution, getWidth() / resolutionDivisor);
+        const int height = jlimit (1, (int) maxResolution, getHeight() / resolutionDivisor);
+        
+        if (width != rasterizer.getWidth() || height != rasterizer.getHeight())
+        {
+            panogramImage = Image (Image::ARGB, width, height, true);
+            rasterizer.setSize (width, height);
+        }
+    }
+    
+    void paint (Graphics& g) override
+    {
+        PANOGRAM_PROFILE_SCOPE (PipelineProfiler::paint);
+        const double start = Time::getMillisecondCounterHiRes();
+        
+        // blackout
+        g.fillAll(Colours::transparentBlack);
+        
+        // draw image direct to bounding rectangle, the same in every mode
+        g.drawImageWithin (panogramImage, 0, 0, getWidth(), getHeight(), RectanglePlacement::stretchToFit);
+        
+        // a ring per tracked source, as wide as its bins are spread
+        for (int k = 0; k < SourceTracker::maxSources; k++)
+        {
+            const TrackedSource& source = tracker.getSource (k);
+            if (source.id == 0)
+                continue;
+            
+            const float w = (float) getWidth(), h = (float) getHeight();
+            const float radius = jmax (0.03f, source.spread);
+            
+            g.setColour (Colours::white.withAlpha (jlimit (0.0f, 1.0f, source.confidence)));
+            g.drawEllipse ((source.x - radius) * w, (source.y - radius) * h,
+                           2.0f * radius * w, 2.0f * radius * h, 2.0f);
+        }
+        
+        paintMs += Time::getMillisecondCounterHiRes() - start;
+    }
     
 private:
     
-    void timerCallback() override
+    /* The old positions mean nothing in another mode. */
+    void setMode (int newMode)
     {
-        repaint();
+        if (newMode != mode)
+        {
+            mode = newMode;
+            tracker.reset();
+        }
+    }
+    
+    /* The frame folded into bands, re-laid out when the settings or the fft
+       size change. */
+    const SpectrumFrame& getBands (const SpectrumFrame& frame)
+    {
+        if (bandsChanged || frame.numBins != bandAggregator.getNumBins())
+        {
+            bandAggregator.prepare (bandScale, frame.numBins, bandSampleRate, minHz, maxHz);
+            
+            // a range moved by less than a band keeps the same points, and the sources on them
+            const float* centres = bandAggregator.getCentreHz();
+            const int numBands = bandAggregator.getNumBands();
+            
+            if (numBands != (int) bandCentres.size() || ! std::equal (centres, centres + numBands, bandCentres.begin()))
+            {
+                bandCentres.assign (centres, centres + numBands);
+                tracker.reset();
+            }
+            
+            // the geometry's eq at the bands' frequencies
+            if (levelMode == GeometryLocalizer::geometry)
+                geometryLocalizer.prepare (geometryLocalizer.getGeometry(), bandAggregator.getNumBands(),
+                                           geometryLocalizer.getSampleRate(), bandAggregator.getCentreHz());
+            
+            bandsChanged = false;
+        }
+        
+        bandAggregator.process (frame);
+        return bandAggregator.getFrame();
     }
     
-    float* fftData1;
-    float* fftData2;
-    float* fftData3;
-    float* fftData4;
+    QuadLocalizer localizer;
+    GridLocalizer gridLocalizer;
+    GeometryLocalizer geometryLocalizer;
+    TdoaLocalizer tdoaLocalizer;
+    SourceTracker tracker;
+    PanogramRasterizer rasterizer;
     
-    float gainDataX1[512];
-    float xoverDataX1[512];
-    float gainDataY1[512];
-    float xoverDataY1[512];
+    BandAggregator bandAggregator;
+    BandAggregator::Scale bandScale = BandAggregator::bins;
+    float minHz = 0.0f;
+    float maxHz = 1.0e6f;
+    double bandSampleRate = 44100.0;
+    bool bandsChanged = true;
+    std::vector<float> bandCentres;     // the bands the tracker follows
+    bool trackingBands = false;
     
-    float fftDataU [512];
-    float fftDataD [512];
-    float fftDataL [512];
-    float fftDataR [512];
+    int mode; // microphone spatial configuration: 0 is Up/Down/Left/Right, 1 is corners, 2 is the full grid, 3 is a geometry, 4 is TDOA
+    int levelMode; // what mode goes back to when TDOA is switched off
     
-    int fftSize;
+    uint64 lastSequence = 0;
     
     Image panogramImage;
+    int resolutionDivisor = 1;
+    double paintMs = 0.0;
+    double lastRenderMs = 0.0;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PanogramComp)
 };
@@ -182,35 +362,39 @@ private:
 
  Divides all 9-channels into overlapping panograms.
  
+ Owns the display side of the spectrum handoff: its RenderScheduler is
+ triggered whenever a frame is published and, paced to what drawing costs,
+ hands the newest frame to the panograms. Nothing new, nothing drawn.
+ While a replay is set, its frames are drawn instead of the live ones.
+ 
  note:
- - currently only using ONE panogram: channels 6,4,2,8 in UPLR mode
+ - panogram1 localizes over the whole 3x3 grid; panogram2 (CORNERS) is
+   built but not shown
  
  */
 
 class DualPanogramComp : public Component,
-                         private Timer
+                         private RenderScheduler::Client
 {
 public:
-    DualPanogramComp (float* fftDataToUse1, float* fftDataToUse2, float* fftDataToUse3,
-                      float* fftDataToUse4, float* fftDataToUse5, float* fftDataToUse6,
-                      float* fftDataToUse7, float* fftDataToUse8, float* fftDataToUse9,
-                      float fftSizeToUse)
+    DualPanogramComp (SpectrumTripleBuffer& spectraToUse)
     :
-    panogram1 (fftDataToUse6, fftDataToUse4, fftDataToUse2, fftDataToUse8, fftSizeToUse), // UDLR
-    panogram2 (fftDataToUse3, fftDataToUse7, fftDataToUse1, fftDataToUse9, fftSizeToUse)  // CORNERS
+    spectra (spectraToUse),
+    scheduler (*this),
+    panogram1 (5, 3, 1, 7, GridLocalizer::grid),    // all 9 mics, channels unused
+    panogram2 (2, 6, 0, 8, QuadLocalizer::corners)  // mics 3,7,1,9
     {
         addAndMakeVisible (&panogram1);
         // addAndMakeVisible (&panogram2);
         
-        // set modes
-        panogram1.mode = 0;  // UDLR
-        panogram2.mode = 1;  // corners
-        
         // FERP map image
         FERPMap = ImageCache::getFromFile(File("/Users/davidkant/Develop/JUCE Projects/MultiLocalizer-Release/img/FERP plot locations inverted.jpg"));
         FERPMap.multiplyAllAlphas(0.55);
     }
     
+    /* Give this to whatever publishes frames, to trigger once per frame. */
+    RenderScheduler& getScheduler()         { return scheduler; }
+    
     void resized() override
     {
         // main display region
@@ -226,13 +410,86 @@ public:
         g.drawImageWithin (FERPMap, 0, 0, getWidth(), getHeight(), RectanglePlacement::stretchToFit);
     }
     
+    /* Main panogram localizes over this array instead of the 3x3 grid. */
+    void setGeometry (const ArrayGeometry& geometry, double sampleRate)
+    {
+        panogram1.setGeometry (geometry, sampleRate);
+    }
+    
+    /* Main panogram folds bins into bands over a frequency range. */
+    void setBands (BandAggregator::Scale scale, float minHz, float maxHz, double sampleRate)
+    {
+        panogram1.setBands (scale, minHz, maxHz, sampleRate);
+    }
+    
+    /* Main panogram's 0 dB and fade range, see PanogramComp::setLevels(). */
+    void setLevels (float zeroReference, float floorDb, float rangeDb)
+    {
+        panogram1.setLevels (zeroReference, floorDb, rangeDb);
+    }
+    
+    /* Main panogram localizes from time differences instead of levels. */
+    void setTdoa (bool useTdoa, const ArrayGeometry& geometry, double sampleRate)
+    {
+        panogram1.setTdoa (useTdoa, geometry, sampleRate);
+    }
+    
+    /* Draws replayed frames instead of live ones; nullptr goes back to live. */
+    void setReplay (LocalizationTripleBuffer* replayToUse)
+    {
+        replay = replayToUse;
+        
+        // whatever is waiting in the other source
+        scheduler.triggerAsyncUpdate();
+    }
+    
 private:
     
-    void timerCallback() override
+    bool renderNewFrame() override
     {
-        repaint();
+        // the last frame's paint belongs to its render
+        scheduler.addPaintCost (panogram1.takePaintMs() + panogram2.takePaintMs());
+        
+        if (replay != nullptr)
+        {
+            // already localized, and folded together if faster than the scheduler
+            if (! replay->acquireLatest())
+                return false;
+            
+            const LocalizationSnapshot& snapshot = replay->getReadBuffer();
+            
+            // the sources being followed were somewhere else in the recording
+            if (snapshot.afterSeek)
+                panogram1.resetTracking();
+            
+            panogram1.drawFrame (snapshot.getFrame());
+            return true;
+        }
+        
+        // nothing new since the last render, nothing to redraw
+        if (! spectra.acquireLatest())
+            return false;
+        
+        const SpectrumFrame& frame = spectra.getReadBuffer();
+        
+        panogram1.newFrame (frame);
+        
+        if (panogram2.isVisible())
+            panogram2.newFrame (frame);
+        
+        return true;
+    }
+    
+    void setResolutionDivisor (int divisor) override
+    {
+        panogram1.setResolutionDivisor (divisor);
+        panogram2.setResolutionDivisor (divisor);
     }
     
+    SpectrumTripleBuffer& spectra;
+    LocalizationTripleBuffer* replay = nullptr;
+    RenderScheduler scheduler;
+    
     PanogramComp panogram1;
     PanogramComp panogram2;
     
@@ -243,20 +500,106 @@ private:
 
 //----------------------------------------------------------------------------//
 
+#if PANOGRAM_PROFILING
+
+ /*
+
+ Shows PipelineProfiler's numbers over the last interval: per stage calls
+ per second, mean, p50, p99 and max in microseconds, then the counters and
+ the audio callback monitor's overruns. update() takes a snapshot and
+ repaints; the owner calls it about once a second.
+
+ */
+
+class ProfilerOverlay : public Component
+{
+public:
+    ProfilerOverlay()
+    {
+        setInterceptsMouseClicks (false, false);
+        PipelineProfiler::getInstance().takeSnapshot (before);
+    }
+    
+    void update (const String& callbackReport)
+    {
+        PipelineProfiler::getInstance().takeSnapshot (now);
+        
+        for (int s = 0; s < PipelineProfiler::numStages; s++)
+            stats[s] = PipelineProfiler::getStageStats ((PipelineProfiler::Stage) s, now, before);
+        
+        for (int c = 0; c < PipelineProfiler::numCounters; c++)
+            counts[c] = PipelineProfiler::getCounterDelta ((PipelineProfiler::Counter) c, now, before);
+        
+        std::swap (now, before);
+        footer = callbackReport;
+        
+        if (isVisible())
+            repaint();
+    }
+    
+    void paint (Graphics& g) override
+    {
+        g.fillAll (Colours::black.withAlpha (0.7f));
+        g.setColour (Colours::white);
+        g.setFont (11.0f);
+        
+        const int rowHeight = 13;
+        const int columnWidth = jmax (40, (getWidth() - 100) / 5);
+        int y = 2;
+        
+        const char* const headings[] = { "calls/s", "mean us", "p50 us", "p99 us", "max us" };
+        g.drawText ("stage", 4, y, 96, rowHeight, Justification::left);
+        for (int i = 0; i < 5; i++)
+            g.drawText (headings[i], 100 + i * columnWidth, y, columnWidth, rowHeight, Justification::right);
+        
+        for (int s = 0; s < PipelineProfiler::numStages; s++)
+        {
+            y += rowHeight;
+            
+            const double values[] = { stats[s].callsPerSecond, stats[s].meanMicros, stats[s].p50Micros,
+                                      stats[s].p99Micros, stats[s].maxMicros };
+            
+            g.drawText (stats[s].name, 4, y, 96, rowHeight, Justification::left);
+            for (int i = 0; i < 5; i++)
+                g.drawText (String (values[i], 1), 100 + i * columnWidth, y, columnWidth, rowHeight, Justification::right);
+        }
+        
+        y += rowHeight;
+        g.drawText (String (PipelineProfiler::getCounterName (PipelineProfiler::droppedBlocks)) + " " + String ((int64) counts[PipelineProfiler::droppedBlocks])
+                      + ", " + PipelineProfiler::getCounterName (PipelineProfiler::lateTicks) + " " + String ((int64) counts[PipelineProfiler::lateTicks]),
+                    4, y, getWidth() - 8, rowHeight, Justification::left);
+        
+        y += rowHeight;
+        g.drawText (footer, 4, y, getWidth() - 8, rowHeight, Justification::left);
+    }
+    
+private:
+    PipelineProfiler::Snapshot now, before;
+    PipelineProfiler::StageStats stats[PipelineProfiler::numStages] = {};
+    uint64 counts[PipelineProfiler::numCounters] = {};
+    String footer;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProfilerOverlay)
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
+
 /* Main window component */
 
 class MainContentComponent : public AudioAppComponent,
-                             public Timer
+                             public Timer,
+                             private ComboBox::Listener,
+                             private Button::Listener,
+                             private Slider::Listener
 {
 public:
     MainContentComponent()
     :
-    dualPanogramComp(fftCookedData1, fftCookedData2, fftCookedData3,
-                     fftCookedData4, fftCookedData5, fftCookedData6,
-                     fftCookedData7, fftCookedData8, fftCookedData9,
-                     fftSize),
-    forwardFFT (fftOrder, false),
-    nextFFTBlockReady (false)
+    hasGeometry (loadGeometry (geometry)),
+    analysisThread (getNumChannelsNeeded(), defaultFFTOrder, 1 << defaultFFTOrder), // no overlap
+    dualPanogramComp(analysisThread.getSpectra())
     {
         setLookAndFeel (&lookAndFeel);
         setSize (400, 400);
@@ -264,28 +607,143 @@ public:
         addAndMakeVisible (&dualPanogramComp);
         addAndMakeVisible (audioSetupComp = new AudioDeviceSelectorComponent (deviceManager, 0, 256, 0, 256, true, true, true, false));
         
-        // init fftWindow
-        fftWindowScale = 0.5; // changes for hop != fft
-        vDSP_hann_window(fftWindow, fftSize, vDSP_HANN_DENORM);
-        vDSP_vsmul(fftWindow, 1, &fftWindowScale, fftWindow, 1, fftSize);
+        // fft size and overlap, item ids are fft order and log2 of hops per frame
+        for (int order = AnalysisThread::minFFTOrder; order <= AnalysisThread::maxFFTOrder; order++)
+            fftSizeBox.addItem (String (1 << order), order);
+        
+        overlapBox.addItem ("no overlap", 1);
+        overlapBox.addItem ("50%", 2);
+        overlapBox.addItem ("75%", 3);
+        overlapBox.addItem ("87.5%", 4);
+        
+        fftSizeBox.setSelectedId (defaultFFTOrder, dontSendNotification);
+        overlapBox.setSelectedId (1, dontSendNotification);
+        fftSizeBox.addListener (this);
+        overlapBox.addListener (this);
+        addAndMakeVisible (&fftSizeBox);
+        addAndMakeVisible (&overlapBox);
+
+        // record every analysed frame to Documents/Panogram
+        recordButton.setButtonText ("record");
+        recordButton.setClickingTogglesState (true);
+        recordButton.addListener (this);
+        addAndMakeVisible (&recordButton);
+        
+        // localize from time differences between the mics instead of levels
+        tdoaButton.setButtonText ("phase");
+        tdoaButton.setClickingTogglesState (true);
+        tdoaButton.addListener (this);
+        addAndMakeVisible (&tdoaButton);
+        
+        // fold bins into bands over a frequency range; item ids are BandAggregator's scales + 1
+        for (int s = 0; s < BandAggregator::numScales; s++)
+            bandsBox.addItem (BandAggregator::getScaleName ((BandAggregator::Scale) s), s + 1);
+        
+        bandsBox.setSelectedId (BandAggregator::bins + 1, dontSendNotification);
+        bandsBox.addListener (this);
+        addAndMakeVisible (&bandsBox);
+        
+        // the ends of the range mean no limit
+        rangeSlider.setSliderStyle (Slider::TwoValueHorizontal);
+        rangeSlider.setTextBoxStyle (Slider::NoTextBox, true, 0, 0);
+        rangeSlider.setRange (lowestHz, highestHz, 1.0);
+        rangeSlider.setSkewFactorFromMidPoint (1000.0);
+        rangeSlider.setMinAndMaxValues (lowestHz, highestHz, dontSendNotification);
+        rangeSlider.setTextValueSuffix (" Hz");
+        rangeSlider.setPopupDisplayEnabled (true, this);
+        rangeSlider.addListener (this);
+        addAndMakeVisible (&rangeSlider);
+        
+        // dB above the reference that fades in from transparent to opaque
+        levelSlider.setSliderStyle (Slider::TwoValueHorizontal);
+        levelSlider.setTextBoxStyle (Slider::NoTextBox, true, 0, 0);
+        levelSlider.setRange (0.0, maxLevelDb, 0.1);
+        levelSlider.setSkewFactorFromMidPoint (3.0);
+        levelSlider.setMinAndMaxValues (0.0, 0.5, dontSendNotification);
+        levelSlider.setTextValueSuffix (" dB");
+        levelSlider.setPopupDisplayEnabled (true, this);
+        levelSlider.addListener (this);
+        addAndMakeVisible (&levelSlider);
+        
+       #if PANOGRAM_PROFILING
+        // where the time goes, per pipeline stage; also logged to Documents/Panogram/profile.log
+        statsButton.setButtonText ("stats");
+        statsButton.setClickingTogglesState (true);
+        statsButton.addListener (this);
+        addAndMakeVisible (&statsButton);
+        addChildComponent (&profilerOverlay);
+        PipelineProfiler::getInstance().takeSnapshot (lastLogged);
+       #endif
+        
+        // replay a .pnlr recording or a 9-channel audio file instead of the input
+        replayButton.setButtonText ("replay...");
+        liveButton.setButtonText ("live");
+        replayButton.addListener (this);
+        liveButton.addListener (this);
+        addAndMakeVisible (&replayButton);
+        addAndMakeVisible (&liveButton);
+        
+        // item ids are the speed
+        const int speeds[] = { 1, 2, 5, 10, 20, ReplayThread::maxSpeed };
+        for (int i = 0; i < numElementsInArray (speeds); i++)
+            speedBox.addItem (String (speeds[i]) + "x", speeds[i]);
+        
+        speedBox.setSelectedId (1, dontSendNotification);
+        speedBox.addListener (this);
+        addAndMakeVisible (&speedBox);
+        
+        positionSlider.setSliderStyle (Slider::LinearHorizontal);
+        positionSlider.setTextBoxStyle (Slider::NoTextBox, true, 0, 0);
+        positionSlider.setRange (0.0, 1.0);
+        positionSlider.addListener (this);
+        addAndMakeVisible (&positionSlider);
+        
+        formatManager.registerBasicFormats();
+        
+        // a geometry file replaces the 3x3 grid everywhere, recordings included
+        if (hasGeometry)
+            analysisThread.setGeometry (geometry);
+        
+        // stream to the viewers in Documents/Panogram/stream.txt, if there are any
+        if (loadStreamDestinations (publisher) && ! analysisThread.setPublisher (&publisher))
+            Logger::writeToLog ("not streaming: " + publisher.getLastError());
+        
+        // the display draws when either of these publishes a frame, not on a timer
+        analysisThread.setFrameListener (&dualPanogramComp.getScheduler());
+        replayThread.setFrameListener (&dualPanogramComp.getScheduler());
+        
+        // FFTs run here, the audio callback only feeds this thread
+        analysisThread.startThread (7);
         
         // audio setup
         setAudioChannels (2, 2); // (numIn, numOut)
 
         // initialize to soundflower 64
-        deviceManager.initialise (9, 0, nullptr, true, "Soundflower (64ch)");
+        deviceManager.initialise (getNumChannelsNeeded(), 0, nullptr, true, "Soundflower (64ch)");
+        
+        // report callback overruns, follow the replay position
+        startTimerHz (10);
     }
     
     ~MainContentComponent()
     {
+        replayThread.close();
         shutdownAudio();
+        analysisThread.stopThread (1000);
+        publisher.stopThread (1000);
     }
     
     //=======================================================================
     
     void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override
     {
+        callbackMonitor.prepare (sampleRate);
+        deviceSampleRate = sampleRate;
         
+        // the only place the fifo memory is (re)allocated: no callbacks are running yet
+        analysisThread.stopThread (1000);
+        analysisThread.prepare (sampleRate, samplesPerBlockExpected);
+        analysisThread.startThread (7);
     }
 
     void releaseResources() override
@@ -295,64 +753,10 @@ public:
     
     void getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill) override
     {
-        // copy audio from input stream
-        ringBuffer1.addToFifo (bufferToFill.buffer->getReadPointer(0), bufferToFill.numSamples);
-        ringBuffer2.addToFifo (bufferToFill.buffer->getReadPointer(1), bufferToFill.numSamples);
-        ringBuffer3.addToFifo (bufferToFill.buffer->getReadPointer(2), bufferToFill.numSamples);
-        ringBuffer4.addToFifo (bufferToFill.buffer->getReadPointer(3), bufferToFill.numSamples);
-        ringBuffer5.addToFifo (bufferToFill.buffer->getReadPointer(4), bufferToFill.numSamples);
-        ringBuffer6.addToFifo (bufferToFill.buffer->getReadPointer(5), bufferToFill.numSamples);
-        ringBuffer7.addToFifo (bufferToFill.buffer->getReadPointer(6), bufferToFill.numSamples);
-        ringBuffer8.addToFifo (bufferToFill.buffer->getReadPointer(7), bufferToFill.numSamples);
-        ringBuffer9.addToFifo (bufferToFill.buffer->getReadPointer(8), bufferToFill.numSamples);
-        
-        // if enough data in ring buffer to perform FFT
-        if (ringBuffer1.abstractFifo.getNumReady () >= fftSize)
-        {
-            // copy from ring buffer to FFT buffer
-            ringBuffer1.readFromFifo (fftCalcBuffer1, fftSize);
-            ringBuffer2.readFromFifo (fftCalcBuffer2, fftSize);
-            ringBuffer3.readFromFifo (fftCalcBuffer3, fftSize);
-            ringBuffer4.readFromFifo (fftCalcBuffer4, fftSize);
-            ringBuffer5.readFromFifo (fftCalcBuffer5, fftSize);
-            ringBuffer6.readFromFifo (fftCalcBuffer6, fftSize);
-            ringBuffer7.readFromFifo (fftCalcBuffer7, fftSize);
-            ringBuffer8.readFromFifo (fftCalcBuffer8, fftSize);
-            ringBuffer9.readFromFifo (fftCalcBuffer9, fftSize);
-            
-            // window
-            vDSP_vmul(fftCalcBuffer1, 1, fftWindow, 1, fftCalcBuffer1, 1, fftSize);
-            vDSP_vmul(fftCalcBuffer2, 1, fftWindow, 1, fftCalcBuffer2, 1, fftSize);
-            vDSP_vmul(fftCalcBuffer3, 1, fftWindow, 1, fftCalcBuffer3, 1, fftSize);
-            vDSP_vmul(fftCalcBuffer4, 1, fftWindow, 1, fftCalcBuffer4, 1, fftSize);
-            vDSP_vmul(fftCalcBuffer5, 1, fftWindow, 1, fftCalcBuffer5, 1, fftSize);
-            vDSP_vmul(fftCalcBuffer6, 1, fftWindow, 1, fftCalcBuffer6, 1, fftSize);
-            vDSP_vmul(fftCalcBuffer7, 1, fftWindow, 1, fftCalcBuffer7, 1, fftSize);
-            vDSP_vmul(fftCalcBuffer8, 1, fftWindow, 1, fftCalcBuffer8, 1, fftSize);
-            vDSP_vmul(fftCalcBuffer9, 1, fftWindow, 1, fftCalcBuffer9, 1, fftSize);
-            
-            // perform forward FFT
-            forwardFFT.performFrequencyOnlyForwardTransform (fftCalcBuffer1);
-            forwardFFT.performFrequencyOnlyForwardTransform (fftCalcBuffer2);
-            forwardFFT.performFrequencyOnlyForwardTransform (fftCalcBuffer3);
-            forwardFFT.performFrequencyOnlyForwardTransform (fftCalcBuffer4);
-            forwardFFT.performFrequencyOnlyForwardTransform (fftCalcBuffer5);
-            forwardFFT.performFrequencyOnlyForwardTransform (fftCalcBuffer6);
-            forwardFFT.performFrequencyOnlyForwardTransform (fftCalcBuffer7);
-            forwardFFT.performFrequencyOnlyForwardTransform (fftCalcBuffer8);
-            forwardFFT.performFrequencyOnlyForwardTransform (fftCalcBuffer9);
-            
-            // copy computed data to shared FFT buffer
-            memcpy(fftCookedData1, fftCalcBuffer1, fftSize * sizeof(float));
-            memcpy(fftCookedData2, fftCalcBuffer2, fftSize * sizeof(float));
-            memcpy(fftCookedData3, fftCalcBuffer3, fftSize * sizeof(float));
-            memcpy(fftCookedData4, fftCalcBuffer4, fftSize * sizeof(float));
-            memcpy(fftCookedData5, fftCalcBuffer5, fftSize * sizeof(float));
-            memcpy(fftCookedData6, fftCalcBuffer6, fftSize * sizeof(float));
-            memcpy(fftCookedData7, fftCalcBuffer7, fftSize * sizeof(float));
-            memcpy(fftCookedData8, fftCalcBuffer8, fftSize * sizeof(float));
-            memcpy(fftCookedData9, fftCalcBuffer9, fftSize * sizeof(float));
-        }
+        AudioCallbackMonitor::ScopedTimer callbackTimer (callbackMonitor, bufferToFill.numSamples);
+        
+        // copy audio from input stream, analysis happens on analysisThread
+        analysisThread.pushSamples (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
     }
     
     //=======================================================================
@@ -363,6 +767,27 @@ public:
         const Rectangle<int> multiPanogramCompBounds ((getWidth()-getHeight())/2+10, 10, getHeight()-20, getHeight()-20);
         dualPanogramComp.setBounds (multiPanogramCompBounds);
         
+        // fft controls top left
+        fftSizeBox.setBounds (5, 5, 90, 20);
+        overlapBox.setBounds (5, 30, 90, 20);
+        recordButton.setBounds (5, 55, 90, 20);
+        
+        // replay controls under them
+        replayButton.setBounds (5, 90, 90, 20);
+        liveButton.setBounds (5, 115, 90, 20);
+        speedBox.setBounds (5, 140, 90, 20);
+        positionSlider.setBounds (5, 165, 90, 20);
+        
+        tdoaButton.setBounds (5, 200, 90, 20);
+        bandsBox.setBounds (5, 250, 90, 20);
+        rangeSlider.setBounds (5, 275, 90, 20);
+        levelSlider.setBounds (5, 300, 90, 20);
+        
+       #if PANOGRAM_PROFILING
+        statsButton.setBounds (5, 225, 90, 20);
+        profilerOverlay.setBounds (5, getHeight() - 175, jmax (300, getWidth() - 10), 170);
+       #endif
+        
         //Rectangle<int> r (getLocalBounds().reduced (4));
         //audioSetupComp->setBounds (r.removeFromTop (proportionOfHeight (0.65f)));
     }
@@ -371,6 +796,166 @@ public:
     
     void timerCallback() override
     {
+        const int overruns = callbackMonitor.getNumOverruns();
+        const int dropped = analysisThread.getNumDroppedBlocks();
+        
+        if (overruns != lastReportedOverruns || dropped != lastReportedDropped)
+        {
+            Logger::writeToLog (callbackMonitor.getReport() + ", " + String (dropped) + " blocks dropped by analysis");
+            
+            lastReportedOverruns = overruns;
+            lastReportedDropped = dropped;
+        }
+        
+        // the geometry's eq and the TDOA delays depend on the rate, so recompile when it changes
+        if (deviceSampleRate.get() != panogramSampleRate)
+        {
+            panogramSampleRate = deviceSampleRate.get();
+            
+            if (hasGeometry)
+                dualPanogramComp.setGeometry (geometry, panogramSampleRate);
+            
+            updateTdoa();
+            updateBands();
+        }
+        
+        // don't fight the user for the slider
+        if (replayThread.isOpen() && ! positionSlider.isMouseButtonDown())
+            positionSlider.setValue (replayThread.getPosition(), dontSendNotification);
+        
+       #if PANOGRAM_PROFILING
+        // the overlay every second, the log every minute
+        ++profilerTicks;
+        
+        if (profilerTicks % 10 == 0)
+            profilerOverlay.update (callbackMonitor.getReport());
+        
+        if (profilerTicks % 600 == 0)
+            logProfile();
+       #endif
+    }
+    
+   #if PANOGRAM_PROFILING
+    void logProfile()
+    {
+        PipelineProfiler::Snapshot& now = profileScratch;
+        PipelineProfiler::getInstance().takeSnapshot (now);
+        
+        const File folder (getPanogramFolder());
+        folder.createDirectory();
+        folder.getChildFile ("profile.log").appendText (Time::getCurrentTime().toString (true, true) + "\n"
+                                                        + PipelineProfiler::formatReport (now, lastLogged).c_str()
+                                                        + callbackMonitor.getReport() + "\n\n");
+        
+        std::swap (now, lastLogged);
+    }
+   #endif
+    
+    //=======================================================================
+    
+    void comboBoxChanged (ComboBox* box) override
+    {
+        if (box == &speedBox)
+        {
+            replayThread.setSpeed (speedBox.getSelectedId());
+            return;
+        }
+        
+        if (box == &bandsBox)
+        {
+            updateBands();
+            return;
+        }
+        
+        const int fftOrder = fftSizeBox.getSelectedId();
+        const int hopSize = (1 << fftOrder) >> (overlapBox.getSelectedId() - 1);
+        
+        // the audio callback keeps filling the fifo while the worker is stopped
+        analysisThread.stopThread (1000);
+        analysisThread.setParameters (fftOrder, hopSize);
+        
+        // a bigger fft than the fifo was laid out for: restarting the device
+        // goes through prepareToPlay, with the callback stopped
+        if (! analysisThread.fitsFFTSize())
+        {
+            deviceManager.closeAudioDevice();
+            deviceManager.restartLastAudioDevice();
+        }
+        
+        analysisThread.startThread (7);
+
+        // setParameters() ends any recording
+        recordButton.setToggleState (false, dontSendNotification);
+    }
+
+    void buttonClicked (Button* button) override
+    {
+        if (button == &replayButton)
+        {
+            openReplay();
+            return;
+        }
+        
+        if (button == &liveButton)
+        {
+            dualPanogramComp.setReplay (nullptr);
+            replayThread.close();
+            return;
+        }
+        
+        if (button == &tdoaButton)
+        {
+            updateTdoa();
+            return;
+        }
+        
+       #if PANOGRAM_PROFILING
+        if (button == &statsButton)
+        {
+            profilerOverlay.setVisible (statsButton.getToggleState());
+            return;
+        }
+       #endif
+        
+        analysisThread.stopThread (1000);
+
+        if (recordButton.getToggleState())
+        {
+            const File folder (getPanogramFolder());
+            folder.createDirectory();
+
+            const File file (folder.getChildFile ("Panogram " + Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S") + ".pnlr"));
+
+            if (analysisThread.startRecording (file))
+                Logger::writeToLog ("recording to " + file.getFullPathName());
+            else
+                recordButton.setToggleState (false, dontSendNotification);
+        }
+        else
+        {
+            analysisThread.stopRecording();
+        }
+
+        analysisThread.startThread (7);
+    }
+    
+    void sliderValueChanged (Slider* slider) override
+    {
+        if (slider == &rangeSlider)
+        {
+            updateBands();
+            return;
+        }
+        
+        if (slider == &levelSlider)
+        {
+            // 0 dB stays where the localizers have it
+            dualPanogramComp.setLevels (1.1f, (float) levelSlider.getMinValue(),
+                                        (float) (levelSlider.getMaxValue() - levelSlider.getMinValue()));
+            return;
+        }
+        
+        replayThread.setPosition (positionSlider.getValue());
     }
     
     //=======================================================================
@@ -384,62 +969,143 @@ public:
     
 private:
 
+    void openReplay()
+    {
+        FileChooser chooser ("Replay a recording", getPanogramFolder(),
+                             "*.pnlr;*.wav;*.aif;*.aiff;*.flac");
+        
+        if (! chooser.browseForFileToOpen())
+            return;
+        
+        // audio files are analysed with the current fft settings
+        dualPanogramComp.setReplay (nullptr);
+        
+        if (! replayThread.open (chooser.getResult(), formatManager,
+                                 analysisThread.getFFTOrder(), analysisThread.getHopSize(),
+                                 hasGeometry ? &geometry : nullptr, tdoaButton.getToggleState()))
+        {
+            Logger::writeToLog ("can't replay " + chooser.getResult().getFullPathName());
+            return;
+        }
+        
+        positionSlider.setRange (0.0, jmax (0.001, replayThread.getLengthInSeconds()));
+        positionSlider.setValue (0.0, dontSendNotification);
+        
+        replayThread.setSpeed (speedBox.getSelectedId());
+        replayThread.setPlaying (true);
+        dualPanogramComp.setReplay (&replayThread.getFrames());
+    }
+
+    static File getPanogramFolder()
+    {
+        return File::getSpecialLocation (File::userDocumentsDirectory).getChildFile ("Panogram");
+    }
+    
+    /* Documents/Panogram/geometry.txt, if there is one (see ArrayGeometry.h). */
+    static bool loadGeometry (ArrayGeometry& geometry)
+    {
+        const File file (getPanogramFolder().getChildFile ("geometry.txt"));
+        
+        if (! file.existsAsFile())
+            return false;
+        
+        if (! geometry.load (file.getFullPathName().toStdString()))
+        {
+            Logger::writeToLog (file.getFullPathName() + ": " + String (geometry.getLastError().c_str()) + ", using the 3x3 grid");
+            return false;
+        }
+        
+        Logger::writeToLog ("array geometry: " + String (geometry.name.c_str()) + ", " + String ((int) geometry.mics.size()) + " mics");
+        return true;
+    }
+    
+    /* Documents/Panogram/stream.txt, if there is one (see LocalizationPublisher.h). */
+    static bool loadStreamDestinations (LocalizationPublisher& publisher)
+    {
+        const File file (getPanogramFolder().getChildFile ("stream.txt"));
+        
+        if (! file.existsAsFile())
+            return false;
+        
+        if (! publisher.loadDestinations (file))
+            Logger::writeToLog (file.getFullPathName() + ": " + publisher.getLastError());
+        
+        Logger::writeToLog ("streaming to " + String (publisher.getNumDestinations()) + " viewer(s)");
+        return publisher.getNumDestinations() > 0;
+    }
+    
+    void updateTdoa()
+    {
+        dualPanogramComp.setTdoa (tdoaButton.getToggleState(), hasGeometry ? geometry : ArrayGeometry::makeDefault(),
+                                  panogramSampleRate);
+    }
+    
+    void updateBands()
+    {
+        const float minHz = rangeSlider.getMinValue() > lowestHz ? (float) rangeSlider.getMinValue() : 0.0f;
+        const float maxHz = rangeSlider.getMaxValue() < highestHz ? (float) rangeSlider.getMaxValue() : 1.0e6f;
+        
+        dualPanogramComp.setBands ((BandAggregator::Scale) (bandsBox.getSelectedId() - 1), minHz, maxHz, panogramSampleRate);
+    }
+    
+    int getNumChannelsNeeded() const
+    {
+        return hasGeometry ? jmax ((int) numChannels, geometry.getNumChannelsNeeded()) : (int) numChannels;
+    }
+
     enum
     {
-        fftOrder = 10,  // 10 = 1024, 11 = 2048
-        fftSize = 1 << fftOrder
+        defaultFFTOrder = 10,  // 10 = 1024, 11 = 2048
+        numChannels = 9,
+        lowestHz = 20,         // range slider ends
+        highestHz = 20000,
+        maxLevelDb = 48        // level slider's top
     };
     
     //==========================================================================
 
-    DualPanogramComp dualPanogramComp;
+    // array layout, read once at startup
+    ArrayGeometry geometry;
+    const bool hasGeometry;
+    double panogramSampleRate = 0.0;
+    Atomic<double> deviceSampleRate { 44100.0 };
     
-    AudioSampleBuffer tempBuffer;
+    // FFT stuff; the publisher outlives the thread that feeds it
+    LocalizationPublisher publisher;
+    AnalysisThread analysisThread;
     
-    // FFT stuff
-    float fftWindow [fftSize];
-    float fftWindowScale;
+    AudioCallbackMonitor callbackMonitor;
+    int lastReportedOverruns = 0;
+    int lastReportedDropped = 0;
 
-    RingFifo ringBuffer1;
-    float fftCalcBuffer1 [2 * fftSize];
-    float fftCookedData1 [fftSize];
-
-    RingFifo ringBuffer2;
-    float fftCalcBuffer2 [2 * fftSize];
-    float fftCookedData2 [fftSize];
-
-    RingFifo ringBuffer3;
-    float fftCalcBuffer3 [2 * fftSize];
-    float fftCookedData3 [fftSize];
+    DualPanogramComp dualPanogramComp;
     
-    RingFifo ringBuffer4;
-    float fftCalcBuffer4 [2 * fftSize];
-    float fftCookedData4 [fftSize];
+    AudioSampleBuffer tempBuffer;
+
+    ScopedPointer<AudioDeviceSelectorComponent> audioSetupComp;
     
-    RingFifo ringBuffer5;
-    float fftCalcBuffer5 [2 * fftSize];
-    float fftCookedData5 [fftSize];
+    ComboBox fftSizeBox;
+    ComboBox overlapBox;
+    TextButton recordButton;
+    TextButton tdoaButton;
+    ComboBox bandsBox;
+    Slider rangeSlider;
+    Slider levelSlider;
     
-    RingFifo ringBuffer6;
-    float fftCalcBuffer6 [2 * fftSize];
-    float fftCookedData6 [fftSize];
+   #if PANOGRAM_PROFILING
+    TextButton statsButton;
+    ProfilerOverlay profilerOverlay;
+    PipelineProfiler::Snapshot lastLogged, profileScratch;
+    int profilerTicks = 0;
+   #endif
     
-    RingFifo ringBuffer7;
-    float fftCalcBuffer7 [2 * fftSize];
-    float fftCookedData7 [fftSize];
+    TextButton replayButton;
+    TextButton liveButton;
+    ComboBox speedBox;
+    Slider positionSlider;
     
-    RingFifo ringBuffer8;
-    float fftCalcBuffer8 [2 * fftSize];
-    float fftCookedData8 [fftSize];
-
-    RingFifo ringBuffer9;
-    float fftCalcBuffer9 [2 * fftSize];
-    float fftCookedData9 [fftSize];
-
-    FFT forwardFFT;
-    bool nextFFTBlockReady;
-
-    ScopedPointer<AudioDeviceSelectorComponent> audioSetupComp;
+    AudioFormatManager formatManager;
+    ReplayThread replayThread;
     
     LookAndFeel_V3 lookAndFeel;
     
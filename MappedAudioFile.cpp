@@ -0,0 +1,277 @@
+#include "MappedAudioFile.h"
+
+#include <cstring>
+
+#if defined (_WIN32)
+ #define WIN32_LEAN_AND_MEAN
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------//
+
+namespace
+{
+    uint16_t readU16 (const unsigned char* p)   { return (uint16_t) (p[0] | (p[1] << 8)); }
+    uint32_t readU32 (const unsigned char* p)   { return (uint32_t) readU16 (p) | ((uint32_t) readU16 (p + 2) << 16); }
+    uint64_t readU64 (const unsigned char* p)   { return (uint64_t) readU32 (p) | ((uint64_t) readU32 (p + 4) << 32); }
+
+    size_t getPageSize()
+    {
+       #if defined (_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo (&info);
+        return (size_t) info.dwPageSize;
+       #else
+        return (size_t) sysconf (_SC_PAGESIZE);
+       #endif
+    }
+
+    enum
+    {
+        wavFormatFloat = 3,
+        wavFormatExtensible = 0xfffe
+    };
+}
+
+//----------------------------------------------------------------------------//
+
+MappedAudioFile::MappedAudioFile() {}
+
+MappedAudioFile::~MappedAudioFile()
+{
+    close();
+}
+
+void MappedAudioFile::close()
+{
+#if defined (_WIN32)
+    if (mapped != nullptr)          UnmapViewOfFile (mapped);
+    if (mappingHandle != nullptr)   CloseHandle ((HANDLE) mappingHandle);
+    if (fileHandle != nullptr)      CloseHandle ((HANDLE) fileHandle);
+
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mapped != nullptr)
+        munmap ((void*) mapped, (size_t) mappedSize);
+
+    if (fileDescriptor >= 0)
+        ::close (fileDescriptor);
+
+    fileDescriptor = -1;
+#endif
+
+    mapped = nullptr;
+    mappedSize = 0;
+    samples = nullptr;
+    numChannels = 0;
+    lengthInSamples = 0;
+    sampleRate = 0.0;
+    releasedUpTo = 0;
+}
+
+bool MappedAudioFile::fail (const std::string& error)
+{
+    close();
+    lastError = error;
+    return false;
+}
+
+bool MappedAudioFile::mapFile (const std::string& path)
+{
+    close();
+
+#if defined (_WIN32)
+    HANDLE file = CreateFileA (path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return fail ("can't open " + path);
+
+    fileHandle = file;
+
+    LARGE_INTEGER size;
+    if (! GetFileSizeEx (file, &size) || size.QuadPart == 0)
+        return fail ("empty file " + path);
+
+    mappingHandle = CreateFileMappingA (file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr)
+        return fail ("can't map " + path);
+
+    mapped = (const unsigned char*) MapViewOfFile ((HANDLE) mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    mappedSize = (uint64_t) size.QuadPart;
+#else
+    fileDescriptor = ::open (path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+        return fail ("can't open " + path);
+
+    struct stat info;
+    if (fstat (fileDescriptor, &info) != 0 || info.st_size == 0)
+        return fail ("empty file " + path);
+
+    void* address = mmap (nullptr, (size_t) info.st_size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    if (address == MAP_FAILED)
+        return fail ("can't map " + path);
+
+    // read ahead aggressively, and don't bother keeping pages we've passed
+    madvise (address, (size_t) info.st_size, MADV_SEQUENTIAL);
+
+    mapped = (const unsigned char*) address;
+    mappedSize = (uint64_t) info.st_size;
+#endif
+
+    if (mapped == nullptr)
+        return fail ("can't map " + path);
+
+    return true;
+}
+
+//----------------------------------------------------------------------------//
+
+bool MappedAudioFile::openRaw (const std::string& path, int numChannelsToUse, double sampleRateToUse)
+{
+    if (numChannelsToUse < 1 || sampleRateToUse <= 0.0)
+        return fail ("raw files need a channel count and sample rate");
+
+    if (! mapFile (path))
+        return false;
+
+    samples = (const float*) mapped;
+    numChannels = numChannelsToUse;
+    sampleRate = sampleRateToUse;
+    lengthInSamples = (int64_t) (mappedSize / (sizeof (float) * numChannels));
+    lastError.clear();
+    return true;
+}
+
+bool MappedAudioFile::openWav (const std::string& path)
+{
+    if (! mapFile (path))
+        return false;
+
+    if (mappedSize < 12 || std::memcmp (mapped + 8, "WAVE", 4) != 0)
+        return fail ("not a WAV file");
+
+    const bool isRF64 = std::memcmp (mapped, "RF64", 4) == 0;
+    if (! isRF64 && std::memcmp (mapped, "RIFF", 4) != 0)
+        return fail ("not a WAV file");
+
+    uint64_t dataOffset = 0, dataSize = 0, rf64DataSize = 0;
+    int formatTag = 0, bitsPerSample = 0;
+    bool gotFormat = false;
+
+    for (uint64_t pos = 12; pos + 8 <= mappedSize;)
+    {
+        const unsigned char* chunk = mapped + pos;
+        const uint64_t chunkSize = readU32 (chunk + 4);
+        const unsigned char* body = chunk + 8;
+        const uint64_t bodyAvailable = mappedSize - pos - 8;
+
+        if (std::memcmp (chunk, "ds64", 4) == 0 && bodyAvailable >= 24)
+        {
+            rf64DataSize = readU64 (body + 8);
+        }
+        else if (std::memcmp (chunk, "fmt ", 4) == 0 && bodyAvailable >= 16)
+        {
+            formatTag = readU16 (body);
+            numChannels = readU16 (body + 2);
+            sampleRate = readU32 (body + 4);
+            bitsPerSample = readU16 (body + 14);
+
+            // extensible: the real format is the first two bytes of the subformat GUID
+            if (formatTag == wavFormatExtensible && chunkSize >= 26 && bodyAvailable >= 26)
+                formatTag = readU16 (body + 24);
+
+            gotFormat = true;
+        }
+        else if (std::memcmp (chunk, "data", 4) == 0)
+        {
+            dataOffset = pos + 8;
+            dataSize = (isRF64 && chunkSize == 0xffffffff) ? rf64DataSize : chunkSize;
+            break;
+        }
+
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    if (! gotFormat || dataOffset == 0)
+        return fail ("WAV file has no fmt or data chunk");
+
+    if (formatTag != wavFormatFloat || bitsPerSample != 32 || numChannels < 1)
+        return fail ("only 32-bit float WAV files can be mapped");
+
+    if (dataOffset % sizeof (float) != 0)
+        return fail ("WAV data isn't 4-byte aligned");
+
+    // a truncated recording still maps whatever made it to disk
+    if (dataSize > mappedSize - dataOffset)
+        dataSize = mappedSize - dataOffset;
+
+    samples = (const float*) (mapped + dataOffset);
+    lengthInSamples = (int64_t) (dataSize / (sizeof (float) * numChannels));
+    lastError.clear();
+    return true;
+}
+
+//----------------------------------------------------------------------------//
+
+void MappedAudioFile::releaseBefore (int64_t sample)
+{
+    if (sample < releasedUpTo)
+    {
+        // went backwards (e.g. a work-stealing worker picked up an earlier chunk)
+        releasedUpTo = sample;
+        return;
+    }
+
+    const size_t pageSize = getPageSize();
+    const size_t frameBytes = sizeof (float) * numChannels;
+    const size_t dataStart = (size_t) ((const unsigned char*) samples - mapped);
+
+    // whole pages only, so the page holding 'sample' stays put
+    const size_t begin = (dataStart + (size_t) releasedUpTo * frameBytes) / pageSize * pageSize;
+    const size_t end = (dataStart + (size_t) sample * frameBytes) / pageSize * pageSize;
+
+    if (end > begin)
+    {
+       #if defined (_WIN32)
+        // unlocking pages that aren't locked just trims them from the working set
+        VirtualUnlock ((void*) (mapped + begin), end - begin);
+       #else
+        madvise ((void*) (mapped + begin), end - begin, MADV_DONTNEED);
+       #endif
+    }
+
+    releasedUpTo = sample;
+}
+
+const float* MappedAudioFile::getInterleavedView (int64_t startSample, int numSamples, int& frameStride)
+{
+    if (samples == nullptr || startSample < 0 || startSample + numSamples > lengthInSamples)
+        return nullptr;
+
+    releaseBefore (startSample);
+
+    frameStride = numChannels;
+    return samples + (size_t) startSample * numChannels;
+}
+
+bool MappedAudioFile::read (float* const* dest, int64_t startSample, int numSamples)
+{
+    if (samples == nullptr || startSample < 0 || startSample + numSamples > lengthInSamples)
+        return false;
+
+    releaseBefore (startSample);
+
+    const float* src = samples + (size_t) startSample * numChannels;
+
+    for (int ch = 0; ch < numChannels; ch++)
+        for (int i = 0; i < numSamples; i++)
+            dest[ch][i] = src[(size_t) i * numChannels + ch];
+
+    return true;
+}
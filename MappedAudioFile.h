@@ -0,0 +1,84 @@
+#ifndef MAPPEDAUDIOFILE_H_INCLUDED
+#define MAPPEDAUDIOFILE_H_INCLUDED
+
+#include "OfflineAnalyser.h"
+
+#include <string>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  A float recording mapped straight into memory.
+
+  Reads 32-bit float WAV (plain RIFF, WAVE_FORMAT_EXTENSIBLE, or RF64 for
+  files past 4 GB) and headerless interleaved float32 files. Samples are
+  never decoded or copied: getInterleavedView() hands OfflineAnalyser a
+  pointer into the mapping and the STFT window reads from there.
+
+  Pages behind the last view are dropped from the process (madvise
+  MADV_DONTNEED, VirtualUnlock on Windows) as the analysis moves forward, so
+  resident memory stays around one block however long the file is. The OS
+  page cache still keeps them, so a second pass is cheap.
+
+  note:
+  - little endian hosts only, like the rest of the offline code
+  - anything that isn't float32 fails to open; use a decoding reader for it
+  - one instance per thread: views and the release position aren't shared
+
+ */
+
+class MappedAudioFile : public MultichannelSource
+{
+public:
+    MappedAudioFile();
+    ~MappedAudioFile();
+
+    /* WAV with float32 samples. */
+    bool openWav (const std::string& path);
+
+    /* Headerless interleaved float32. */
+    bool openRaw (const std::string& path, int numChannels, double sampleRate);
+
+    void close();
+
+    bool isOpen() const                             { return samples != nullptr; }
+    const std::string& getLastError() const         { return lastError; }
+
+    int getNumChannels() const override             { return numChannels; }
+    int64_t getLengthInSamples() const override     { return lengthInSamples; }
+    double getSampleRate() const override           { return sampleRate; }
+
+    /* De-interleaving copy, for callers that want separate channels. */
+    bool read (float* const* dest, int64_t startSample, int numSamples) override;
+
+    const float* getInterleavedView (int64_t startSample, int numSamples, int& frameStride) override;
+
+private:
+    bool mapFile (const std::string& path);
+    bool fail (const std::string& error);
+    void releaseBefore (int64_t sample);
+
+    const unsigned char* mapped = nullptr;
+    uint64_t mappedSize = 0;
+    const float* samples = nullptr;
+
+    int numChannels = 0;
+    int64_t lengthInSamples = 0;
+    double sampleRate = 0.0;
+
+    int64_t releasedUpTo = 0;   // in samples
+    std::string lastError;
+
+#if defined (_WIN32)
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+
+    MappedAudioFile (const MappedAudioFile&);
+    MappedAudioFile& operator= (const MappedAudioFile&);
+};
+
+#endif  // MAPPEDAUDIOFILE_H_INCLUDED
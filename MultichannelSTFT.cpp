@@ -0,0 +1,282 @@
+#include "MultichannelSTFT.h"
+#include "DSPKernels.h"
+#include "PipelineProfiler.h"
+
+#include <cmath>
+
+//----------------------------------------------------------------------------//
+
+void MultichannelSTFT::prepare (int fftOrder, int numChannelsToUse, float windowScale, bool keepSpectrumToUse)
+{
+    const int simdWidth = 8; // one AVX register of floats
+
+    fftSize = 1 << fftOrder;
+    halfSize = fftSize / 2;
+    numChannels = numChannelsToUse;
+    keepSpectrum = keepSpectrumToUse;
+
+    // a lone channel gets no padding, so it runs as a plain scalar FFT
+    stride = numChannels == 1 ? 1 : (numChannels + simdWidth - 1) / simdWidth * simdWidth;
+
+    window.allocate (fftSize);
+    DSPKernels::hannWindow (window, fftSize);
+    DSPKernels::multiplyScalar (window, windowScale, window, fftSize);
+
+    frame.allocate (fftSize * stride);
+    re.allocate (halfSize * stride);
+    im.allocate (halfSize * stride);
+    interleavedMagnitudes.allocate (halfSize * stride);
+    magnitudes.allocate (numChannels * halfSize);
+
+    if (keepSpectrum)
+    {
+        interleavedRe.allocate (halfSize * stride);
+        interleavedIm.allocate (halfSize * stride);
+        spectrumRe.allocate (numChannels * halfSize);
+        spectrumIm.allocate (numChannels * halfSize);
+    }
+    else
+    {
+        interleavedRe.free();
+        interleavedIm.free();
+        spectrumRe.free();
+        spectrumIm.free();
+    }
+
+    const double twoPi = 6.283185307179586;
+
+    // the packed complex FFT is half the size
+    makeFFTTables (fftOrder - 1, twiddleRe, twiddleIm, bitReversed);
+
+    // e^(-2 pi i k / fftSize) for splitting the packed real FFT
+    unpackRe.allocate (halfSize);
+    unpackIm.allocate (halfSize);
+    for (int k = 0; k < halfSize; k++)
+    {
+        unpackRe[k] = (float) std::cos (twoPi * k / fftSize);
+        unpackIm[k] = (float) -std::sin (twoPi * k / fftSize);
+    }
+}
+
+void MultichannelSTFT::makeFFTTables (int order, AlignedBuffer<float>& twiddleRe, AlignedBuffer<float>& twiddleIm,
+                                      AlignedBuffer<int>& bitReversed)
+{
+    const double twoPi = 6.283185307179586;
+    const int size = 1 << order;
+
+    // e^(-2 pi i k / size) for the butterflies
+    twiddleRe.allocate (size / 2 + 1);
+    twiddleIm.allocate (size / 2 + 1);
+    for (int k = 0; k < size / 2; k++)
+    {
+        twiddleRe[k] = (float) std::cos (twoPi * k / size);
+        twiddleIm[k] = (float) -std::sin (twoPi * k / size);
+    }
+
+    bitReversed.allocate (size);
+    for (int i = 0; i < size; i++)
+    {
+        int r = 0;
+        for (int b = 0; b < order; b++)
+            r |= ((i >> b) & 1) << (order - 1 - b);
+
+        bitReversed[i] = r;
+    }
+}
+
+float MultichannelSTFT::getCOLAWindowScale (int fftSize, int hopSize)
+{
+    // sum of a periodic hann window is exactly fftSize / 2
+    return 0.25f * hopSize / (fftSize * 0.5f);
+}
+
+void MultichannelSTFT::loadChannel (int channel, const float* src, int srcStride)
+{
+    float* dst = frame.get() + channel;
+
+    for (int n = 0; n < fftSize; n++)
+        dst[n * stride] = src[n * srcStride];
+}
+
+//----------------------------------------------------------------------------//
+
+void MultichannelSTFT::process()
+{
+    const int S = stride;
+
+    {
+        PANOGRAM_PROFILE_SCOPE (PipelineProfiler::window);
+
+        // window and pack: z[n] = x[2n] + i x[2n+1], stored in bit-reversed order
+        for (int n = 0; n < halfSize; n++)
+        {
+            const float* __restrict evenIn = frame.get() + (2 * n) * S;
+            const float* __restrict oddIn = evenIn + S;
+            float* __restrict zr = re.get() + bitReversed[n] * S;
+            float* __restrict zi = im.get() + bitReversed[n] * S;
+            const float we = window[2 * n];
+            const float wo = window[2 * n + 1];
+
+            for (int c = 0; c < S; c++)
+            {
+                zr[c] = evenIn[c] * we;
+                zi[c] = oddIn[c] * wo;
+            }
+        }
+    }
+
+    transformPacked();
+}
+
+void MultichannelSTFT::processInterleaved (const float* src, int srcStride)
+{
+    const int S = stride;
+    const int numIn = numChannels;
+
+    {
+        PANOGRAM_PROFILE_SCOPE (PipelineProfiler::window);
+
+        // same as process(), but the window multiply reads the caller's samples directly
+        for (int n = 0; n < halfSize; n++)
+        {
+            const float* __restrict evenIn = src + (size_t) (2 * n) * srcStride;
+            const float* __restrict oddIn = evenIn + srcStride;
+            float* __restrict zr = re.get() + bitReversed[n] * S;
+            float* __restrict zi = im.get() + bitReversed[n] * S;
+            const float we = window[2 * n];
+            const float wo = window[2 * n + 1];
+
+            for (int c = 0; c < numIn; c++)
+            {
+                zr[c] = evenIn[c] * we;
+                zi[c] = oddIn[c] * wo;
+            }
+
+            for (int c = numIn; c < S; c++)
+            {
+                zr[c] = 0.0f;
+                zi[c] = 0.0f;
+            }
+        }
+    }
+
+    transformPacked();
+}
+
+void MultichannelSTFT::transformPacked()
+{
+    {
+        PANOGRAM_PROFILE_SCOPE (PipelineProfiler::fft);
+        performComplexFFT (re, im, halfSize, stride, twiddleRe, twiddleIm);
+    }
+
+    PANOGRAM_PROFILE_SCOPE (PipelineProfiler::magnitudes);
+
+    if (keepSpectrum)
+        unpackSpectrum<true>();
+    else
+        unpackSpectrum<false>();
+}
+
+template <bool keepComplex>
+void MultichannelSTFT::unpackSpectrum()
+{
+    const int S = stride;
+
+    // split the packed spectrum into the real FFT and take magnitudes
+    for (int k = 0; k < halfSize; k++)
+    {
+        const int mirror = (halfSize - k) & (halfSize - 1);
+        const float* __restrict ar = re.get() + k * S;
+        const float* __restrict ai = im.get() + k * S;
+        const float* __restrict br = re.get() + mirror * S;
+        const float* __restrict bi = im.get() + mirror * S;
+        float* __restrict out = interleavedMagnitudes.get() + k * S;
+        float* __restrict outRe = keepComplex ? interleavedRe.get() + k * S : nullptr;
+        float* __restrict outIm = keepComplex ? interleavedIm.get() + k * S : nullptr;
+        const float wr = unpackRe[k];
+        const float wi = unpackIm[k];
+
+        for (int c = 0; c < S; c++)
+        {
+            const float evenRe = 0.5f * (ar[c] + br[c]);
+            const float evenIm = 0.5f * (ai[c] - bi[c]);
+            const float oddRe  = 0.5f * (ai[c] + bi[c]);
+            const float oddIm  = -0.5f * (ar[c] - br[c]);
+
+            const float xr = evenRe + wr * oddRe - wi * oddIm;
+            const float xi = evenIm + wr * oddIm + wi * oddRe;
+
+            out[c] = std::sqrt (xr * xr + xi * xi);
+
+            if (keepComplex)
+            {
+                outRe[c] = xr;
+                outIm[c] = xi;
+            }
+        }
+    }
+
+    // de-interleave into one contiguous spectrum per channel
+    for (int c = 0; c < numChannels; c++)
+    {
+        float* __restrict dst = magnitudes.get() + c * halfSize;
+        const float* __restrict src = interleavedMagnitudes.get() + c;
+
+        for (int k = 0; k < halfSize; k++)
+            dst[k] = src[k * S];
+    }
+
+    if (keepComplex)
+    {
+        for (int c = 0; c < numChannels; c++)
+        {
+            float* __restrict dstRe = spectrumRe.get() + c * halfSize;
+            float* __restrict dstIm = spectrumIm.get() + c * halfSize;
+            const float* __restrict srcRe = interleavedRe.get() + c;
+            const float* __restrict srcIm = interleavedIm.get() + c;
+
+            for (int k = 0; k < halfSize; k++)
+            {
+                dstRe[k] = srcRe[k * S];
+                dstIm[k] = srcIm[k * S];
+            }
+        }
+    }
+}
+
+void MultichannelSTFT::performComplexFFT (float* re, float* im, int size, int stride,
+                                          const float* twiddleRe, const float* twiddleIm)
+{
+    const int S = stride;
+
+    for (int len = 2; len <= size; len <<= 1)
+    {
+        const int half = len / 2;
+        const int twiddleStep = size / len;
+
+        for (int start = 0; start < size; start += len)
+        {
+            for (int j = 0; j < half; j++)
+            {
+                const float wr = twiddleRe[j * twiddleStep];
+                const float wi = twiddleIm[j * twiddleStep];
+                float* __restrict ar = re + (start + j) * S;
+                float* __restrict ai = im + (start + j) * S;
+                float* __restrict br = re + (start + j + half) * S;
+                float* __restrict bi = im + (start + j + half) * S;
+
+                for (int c = 0; c < S; c++)
+                {
+                    const float tr = wr * br[c] - wi * bi[c];
+                    const float ti = wr * bi[c] + wi * br[c];
+
+                    br[c] = ar[c] - tr;
+                    bi[c] = ai[c] - ti;
+                    ar[c] += tr;
+                    ai[c] += ti;
+                }
+            }
+        }
+    }
+}
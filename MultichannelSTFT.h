@@ -0,0 +1,108 @@
+#ifndef MULTICHANNELSTFT_H_INCLUDED
+#define MULTICHANNELSTFT_H_INCLUDED
+
+#include "AlignedBuffer.h"
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Windowed magnitude FFT of N channels at once.
+
+  Input is one channel-interleaved frame: sample n of channel c lives at
+  getFrame()[n * getChannelStride() + c]. The stride is the channel count
+  rounded up to a full SIMD register (a single channel is left unpadded), so
+  every butterfly of the FFT runs on all channels together and the inner
+  loops are plain contiguous float loops the compiler vectorises.
+
+  Output matches FFT::performFrequencyOnlyForwardTransform: unnormalised
+  magnitudes, one contiguous run of getNumBins() (fftSize/2) per channel.
+  prepare() can also ask for the complex spectrum, laid out the same way,
+  for localizers that need phase (TdoaLocalizer).
+
+  note:
+  - real input is packed into an fftSize/2 complex FFT (even/odd trick)
+  - prepare() allocates; process() never does
+
+ */
+
+class MultichannelSTFT
+{
+public:
+    MultichannelSTFT() {}
+
+    /* Allocates everything for a 2^fftOrder FFT over numChannels channels.
+       keepSpectrum also keeps the complex bins (getReal, getImag). */
+    void prepare (int fftOrder, int numChannels, float windowScale, bool keepSpectrum = false);
+
+    /* Hann scaling so overlapping frames add up to the same average gain (0.25)
+       at any hop. At hop == fftSize that is the original 0.5 peak. Hops of
+       fftSize / 2^k are COLA for the hann window. */
+    static float getCOLAWindowScale (int fftSize, int hopSize);
+
+    int getFFTSize() const          { return fftSize; }
+    int getNumBins() const          { return fftSize / 2; }
+    int getNumChannels() const      { return numChannels; }
+    int getChannelStride() const    { return stride; }
+
+    /* The interleaved input frame (fftSize rows of getChannelStride() floats). */
+    float* getFrame() const         { return frame.get(); }
+
+    /* Copies one channel into the frame. srcStride lets interleaved sources in directly. */
+    void loadChannel (int channel, const float* src, int srcStride = 1);
+
+    /* Windows and transforms every channel of the current frame. */
+    void process();
+
+    /* process() on fftSize rows of someone else's interleaved samples (channel c of
+       row n at src[n * srcStride + c], srcStride >= channel count), e.g. a mapped
+       file. Skips loadChannel() and the frame altogether. */
+    void processInterleaved (const float* src, int srcStride);
+
+    /* getNumBins() magnitudes for one channel, valid until the next process(). */
+    const float* getMagnitudes (int channel) const   { return magnitudes.get() + channel * getNumBins(); }
+
+    /* The complex bins behind them, if prepare() was asked to keep them. */
+    bool hasSpectrum() const                        { return keepSpectrum; }
+    const float* getReal (int channel) const        { return spectrumRe.get() + channel * getNumBins(); }
+    const float* getImag (int channel) const        { return spectrumIm.get() + channel * getNumBins(); }
+
+    //==========================================================================
+
+    /* Twiddles e^(-2 pi i k / 2^order) for k < 2^order / 2, and the bit reversal
+       permutation, for performComplexFFT(). Allocates. */
+    static void makeFFTTables (int order, AlignedBuffer<float>& twiddleRe, AlignedBuffer<float>& twiddleIm,
+                               AlignedBuffer<int>& bitReversed);
+
+    /* In-place forward FFT of 'size' points, 'stride' signals at once: point n of
+       signal c at [n * stride + c], input in bit-reversed order. */
+    static void performComplexFFT (float* re, float* im, int size, int stride,
+                                   const float* twiddleRe, const float* twiddleIm);
+
+private:
+    void transformPacked();
+
+    template <bool keepComplex>
+    void unpackSpectrum();
+
+    int fftSize = 0;
+    int halfSize = 0;
+    int numChannels = 0;
+    int stride = 0;
+    bool keepSpectrum = false;
+
+    AlignedBuffer<float> window;        // [fftSize]
+    AlignedBuffer<float> frame;         // [fftSize][stride]
+    AlignedBuffer<float> re, im;        // [halfSize][stride], packed complex FFT work area
+    AlignedBuffer<float> twiddleRe;     // [halfSize / 2] for the complex FFT
+    AlignedBuffer<float> twiddleIm;
+    AlignedBuffer<float> unpackRe;      // [halfSize] for splitting the packed result
+    AlignedBuffer<float> unpackIm;
+    AlignedBuffer<int> bitReversed;     // [halfSize]
+    AlignedBuffer<float> interleavedMagnitudes;  // [halfSize][stride]
+    AlignedBuffer<float> magnitudes;    // [numChannels][halfSize]
+    AlignedBuffer<float> interleavedRe, interleavedIm;  // [halfSize][stride], only if keepSpectrum
+    AlignedBuffer<float> spectrumRe, spectrumIm;        // [numChannels][halfSize]
+};
+
+#endif  // MULTICHANNELSTFT_H_INCLUDED
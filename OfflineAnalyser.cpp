@@ -0,0 +1,120 @@
+#include "OfflineAnalyser.h"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------------//
+
+OfflineAnalyser::OfflineAnalyser (const AnalysisSettings& settingsToUse, int numChannelsToUse)
+    : settings (settingsToUse),
+      numChannels (numChannelsToUse),
+      fftSize (1 << settingsToUse.fftOrder),
+      blockSize ((framesPerBlock - 1) * settingsToUse.hopSize + (1 << settingsToUse.fftOrder)),
+      localizer (settingsToUse.channel1, settingsToUse.channel2,
+                 settingsToUse.channel3, settingsToUse.channel4,
+                 settingsToUse.mode)
+{
+    stft.prepare (settings.fftOrder, numChannels, MultichannelSTFT::getCOLAWindowScale (fftSize, settings.hopSize),
+                  settings.mode == TdoaLocalizer::tdoa);
+    localizer.setNumBins (stft.getNumBins());
+    gridLocalizer.setNumBins (stft.getNumBins());
+
+    blockBuffer.allocate ((size_t) numChannels * blockSize);
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        channelPointers.push_back (blockBuffer.get() + (size_t) ch * blockSize);
+        magnitudePointers.push_back (stft.getMagnitudes (ch));
+
+        if (stft.hasSpectrum())
+        {
+            realPointers.push_back (stft.getReal (ch));
+            imagPointers.push_back (stft.getImag (ch));
+        }
+    }
+}
+
+int64_t OfflineAnalyser::getNumFrames (int64_t lengthInSamples, int fftSize, int hopSize)
+{
+    if (lengthInSamples < fftSize)
+        return 0;
+
+    return (lengthInSamples - fftSize) / hopSize + 1;
+}
+
+int64_t OfflineAnalyser::analyse (MultichannelSource& source, LocalizationSink& sink)
+{
+    return analyse (source, sink, 0, getNumFrames (source.getLengthInSamples(), fftSize, settings.hopSize));
+}
+
+int64_t OfflineAnalyser::analyse (MultichannelSource& source, LocalizationSink& sink,
+                                  int64_t firstFrame, int64_t numFrames)
+{
+    const int hopSize = settings.hopSize;
+    int64_t done = 0;
+
+    // eq in the geometry depends on the sample rate, so compile it here
+    if (settings.mode == GeometryLocalizer::geometry
+         && (geometryLocalizer.getNumBins() != stft.getNumBins() || geometryLocalizer.getSampleRate() != source.getSampleRate()))
+        geometryLocalizer.prepare (settings.geometry, stft.getNumBins(), source.getSampleRate());
+
+    if (settings.mode == TdoaLocalizer::tdoa
+         && (tdoaLocalizer.getNumBins() != stft.getNumBins() || tdoaLocalizer.getSampleRate() != source.getSampleRate()))
+        tdoaLocalizer.prepare (settings.geometry.mics.empty() ? ArrayGeometry::makeDefault() : settings.geometry,
+                               settings.fftOrder, source.getSampleRate());
+
+    while (done < numFrames)
+    {
+        const int framesThisBlock = (int) std::min<int64_t> (framesPerBlock, numFrames - done);
+        const int64_t blockFrame = firstFrame + done;
+        const int samplesThisBlock = (framesThisBlock - 1) * hopSize + fftSize;
+
+        int frameStride = 0;
+        const float* view = source.getInterleavedView (blockFrame * hopSize, samplesThisBlock, frameStride);
+
+        if (frameStride < numChannels)
+            view = nullptr;
+
+        if (view == nullptr && ! source.read (channelPointers.data(), blockFrame * hopSize, samplesThisBlock))
+            break;
+
+        for (int i = 0; i < framesThisBlock; i++)
+        {
+            if (view != nullptr)
+            {
+                stft.processInterleaved (view + (size_t) i * hopSize * frameStride, frameStride);
+            }
+            else
+            {
+                for (int ch = 0; ch < numChannels; ch++)
+                    stft.loadChannel (ch, channelPointers[ch] + i * hopSize);
+
+                stft.process();
+            }
+
+            if (settings.mode == TdoaLocalizer::tdoa)
+            {
+                tdoaLocalizer.process (realPointers.data(), imagPointers.data(), magnitudePointers.data());
+                sink.frameReady (blockFrame + i, tdoaLocalizer.getFrame());
+            }
+            else if (settings.mode == GeometryLocalizer::geometry)
+            {
+                geometryLocalizer.process (magnitudePointers.data());
+                sink.frameReady (blockFrame + i, geometryLocalizer.getFrame());
+            }
+            else if (settings.mode == GridLocalizer::grid)
+            {
+                gridLocalizer.process (magnitudePointers.data());
+                sink.frameReady (blockFrame + i, gridLocalizer.getFrame());
+            }
+            else
+            {
+                localizer.process (magnitudePointers.data());
+                sink.frameReady (blockFrame + i, localizer.getFrame());
+            }
+        }
+
+        done += framesThisBlock;
+    }
+
+    return done;
+}
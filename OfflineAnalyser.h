@@ -0,0 +1,122 @@
+#ifndef OFFLINEANALYSER_H_INCLUDED
+#define OFFLINEANALYSER_H_INCLUDED
+
+#include "MultichannelSTFT.h"
+#include "GeometryLocalizer.h"
+#include "GridLocalizer.h"
+#include "QuadLocalizer.h"
+#include "TdoaLocalizer.h"
+
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------//
+
+/* Somewhere to pull multichannel audio from: a file reader, a test signal... */
+
+class MultichannelSource
+{
+public:
+    virtual ~MultichannelSource() {}
+
+    virtual int getNumChannels() const = 0;
+    virtual int64_t getLengthInSamples() const = 0;
+    virtual double getSampleRate() const = 0;
+
+    /* Fills dest[channel][0..numSamples) starting at startSample. False on error. */
+    virtual bool read (float* const* dest, int64_t startSample, int numSamples) = 0;
+
+    /* Zero-copy alternative to read(), for sources that already hold float
+       samples in memory (see MappedAudioFile). Returns sample startSample of
+       channel 0, with channel c of sample n at [n * frameStride + c], valid
+       for numSamples samples until the next call. nullptr means use read(). */
+    virtual const float* getInterleavedView (int64_t /*startSample*/, int /*numSamples*/, int& /*frameStride*/)
+    {
+        return nullptr;
+    }
+};
+
+//----------------------------------------------------------------------------//
+
+/* Gets every localized frame, in order. */
+
+class LocalizationSink
+{
+public:
+    virtual ~LocalizationSink() {}
+
+    virtual void frameReady (int64_t frameIndex, const LocalizationFrame& frame) = 0;
+};
+
+//----------------------------------------------------------------------------//
+
+struct AnalysisSettings
+{
+    int fftOrder = 10;
+    int hopSize = 1024;
+
+    // UDLR on mics 6,4,2,8; GridLocalizer::grid uses all 9 and ignores the channels
+    int channel1 = 5, channel2 = 3, channel3 = 1, channel4 = 7;
+    int mode = QuadLocalizer::udlr;
+
+    // used when mode is GeometryLocalizer::geometry or TdoaLocalizer::tdoa
+    // (which takes the 3x3 array if it's empty)
+    ArrayGeometry geometry;
+};
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Runs a file through the same STFT and crossover math as the live app,
+  as fast as the CPU allows.
+
+  Frames are the ones the live analysis thread would produce: frame f covers
+  samples [f * hop, f * hop + fftSize). Audio is read a block of frames at a
+  time straight into per-channel buffers, so memory use doesn't depend on
+  the length of the file. Sources with an interleaved view skip the block
+  buffers and feed the STFT window straight from their memory.
+
+ */
+
+class OfflineAnalyser
+{
+public:
+    OfflineAnalyser (const AnalysisSettings& settings, int numChannels);
+
+    static int64_t getNumFrames (int64_t lengthInSamples, int fftSize, int hopSize);
+
+    /* Analyses frames [firstFrame, firstFrame + numFrames). Returns how many made it. */
+    int64_t analyse (MultichannelSource& source, LocalizationSink& sink,
+                     int64_t firstFrame, int64_t numFrames);
+
+    /* The whole source. */
+    int64_t analyse (MultichannelSource& source, LocalizationSink& sink);
+
+    const AnalysisSettings& getSettings() const     { return settings; }
+    int getNumBins() const                          { return stft.getNumBins(); }
+
+private:
+    enum { framesPerBlock = 32 };
+
+    AnalysisSettings settings;
+    int numChannels;
+    int fftSize;
+    int blockSize;
+
+    MultichannelSTFT stft;
+    QuadLocalizer localizer;
+    GridLocalizer gridLocalizer;
+    GeometryLocalizer geometryLocalizer;    // prepared for the source's sample rate in analyse()
+    TdoaLocalizer tdoaLocalizer;            // likewise
+
+    AlignedBuffer<float> blockBuffer;   // [numChannels][blockSize]
+    std::vector<float*> channelPointers;
+    std::vector<const float*> magnitudePointers;
+    std::vector<const float*> realPointers, imagPointers;
+
+    OfflineAnalyser (const OfflineAnalyser&);
+    OfflineAnalyser& operator= (const OfflineAnalyser&);
+};
+
+#endif  // OFFLINEANALYSER_H_INCLUDED
@@ -0,0 +1,363 @@
+/*
+  ==============================================================================
+
+ Headless batch localizer.
+
+ Entry point of the OfflineLocalizer console target (juce_core +
+ juce_audio_basics + juce_audio_formats, no GUI modules). Not part of the
+ app target, which has its own main() in Main.cpp.
+
+ Streams a multichannel recording through the same STFT and crossover math
+ as the live panogram and writes x, y and gain for every bin of every frame.
+ No display or audio device needed.
+
+ usage:
+   OfflineLocalizer <input> <output> [--fft 10] [--hop 1024] [--mode udlr|corners|grid|tdoa] [--format csv|bin|rec] [--threads N]
+                    [--channels N --rate 44100] [--geometry array.txt]
+
+ --threads defaults to the number of cores; 1 runs the plain serial analyser.
+ The output is identical either way.
+
+ --mode grid uses all 9 mics (GridLocalizer), like the app's panogram; udlr
+ (the default) and corners use 4. --geometry localizes over any array
+ described in a file instead (see ArrayGeometry.h), and overrides --mode.
+ --mode tdoa localizes from time differences between every mic pair
+ (TdoaLocalizer), over the 3x3 array or --geometry's.
+
+ formats: whatever registerBasicFormats() gives on the platform (WAV, AIFF,
+ FLAC, Ogg everywhere; CAF only where JUCE has CoreAudioFormat, i.e. macOS).
+ 32-bit float WAV/RF64 is memory-mapped and analysed in place instead
+ (MappedAudioFile), as is headerless interleaved float32 when --channels is
+ given.
+
+ csv: one line per bin, "frame,time,bin,x,y,gain"
+ bin: header, then per frame an int64 frame index and numBins (x, y, gain)
+      float32 triples, all little endian:
+        char[4] "PNGB", uint32 version (1), uint32 numBins, uint32 fftSize,
+        uint32 hopSize, float64 sampleRate
+ rec: a compressed, seekable .pnlr recording, the same format the app's
+      record button writes (see LocalizationRecording.h)
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "OfflineAnalyser.h"
+#include "ParallelOfflineAnalyser.h"
+#include "AudioFileSource.h"
+#include "MappedAudioFile.h"
+#include "LocalizationRecording.h"
+
+#include <cstdio>
+#include <thread>
+
+//----------------------------------------------------------------------------//
+
+/* Maps float files instead of decoding them. createSource() is nullptr if
+   the file can't be mapped (e.g. a 24-bit WAV). */
+
+class MappedFileSourceFactory : public MultichannelSourceFactory
+{
+public:
+    MappedFileSourceFactory (const File& fileToUse, int rawChannelsToUse, double rawSampleRateToUse)
+        : path (fileToUse.getFullPathName().toStdString()),
+          rawChannels (rawChannelsToUse), rawSampleRate (rawSampleRateToUse)
+    {
+    }
+
+    MultichannelSource* createSource() override
+    {
+        ScopedPointer<MappedAudioFile> mappedFile (new MappedAudioFile());
+
+        const bool opened = (rawChannels > 0) ? mappedFile->openRaw (path, rawChannels, rawSampleRate)
+                                              : mappedFile->openWav (path);
+
+        {
+            const ScopedLock sl (lock);     // every pool worker calls this at once
+            lastError = mappedFile->getLastError();
+        }
+
+        return opened ? mappedFile.release() : nullptr;
+    }
+
+    /* Why the last createSource() gave nullptr. */
+    std::string getLastError() const
+    {
+        const ScopedLock sl (lock);
+        return lastError;
+    }
+
+private:
+    std::string path;
+    int rawChannels;
+    double rawSampleRate;
+    std::string lastError;
+    CriticalSection lock;
+};
+
+//----------------------------------------------------------------------------//
+
+class CsvSink : public LocalizationSink
+{
+public:
+    CsvSink (FILE* fileToUse, double secondsPerFrameToUse)
+        : file (fileToUse), secondsPerFrame (secondsPerFrameToUse)
+    {
+        std::fputs ("frame,time,bin,x,y,gain\n", file);
+    }
+
+    void frameReady (int64_t frameIndex, const LocalizationFrame& frame) override
+    {
+        const double time = frameIndex * secondsPerFrame;
+
+        for (int i = 0; i < frame.numBins; i++)
+            std::fprintf (file, "%lld,%.6f,%d,%.5f,%.5f,%.3f\n", (long long) frameIndex, time, i,
+                          frame.x[i], frame.y[i], frame.gain[i]);
+    }
+
+private:
+    FILE* file;
+    double secondsPerFrame;
+};
+
+class BinarySink : public LocalizationSink
+{
+public:
+    BinarySink (FILE* fileToUse, int numBins, int fftSize, int hopSize, double sampleRate)
+        : file (fileToUse)
+    {
+        const uint32 header[4] = { 1, (uint32) numBins, (uint32) fftSize, (uint32) hopSize };
+
+        std::fwrite ("PNGB", 1, 4, file);
+        std::fwrite (header, sizeof (uint32), 4, file);
+        std::fwrite (&sampleRate, sizeof (double), 1, file);
+
+        triples.malloc (3 * numBins);
+    }
+
+    void frameReady (int64_t frameIndex, const LocalizationFrame& frame) override
+    {
+        const int numBins = frame.numBins;
+
+        for (int i = 0; i < numBins; i++)
+        {
+            triples[3 * i]     = frame.x[i];
+            triples[3 * i + 1] = frame.y[i];
+            triples[3 * i + 2] = frame.gain[i];
+        }
+
+        const int64 index = frameIndex;
+        std::fwrite (&index, sizeof (index), 1, file);
+        std::fwrite (triples, sizeof (float), 3 * numBins, file);
+    }
+
+private:
+    FILE* file;
+    HeapBlock<float> triples;
+};
+
+class RecordingSink : public LocalizationSink
+{
+public:
+    RecordingSink (const String& path, int numBins, int fftSize, int hopSize, double sampleRate)
+    {
+        LocalizationRecordingInfo info;
+        info.numBins = numBins;
+        info.fftSize = fftSize;
+        info.hopSize = hopSize;
+        info.sampleRate = sampleRate;
+
+        writer.open (path.toStdString(), info);
+    }
+
+    bool isOpen() const     { return writer.isOpen(); }
+
+    void frameReady (int64_t frameIndex, const LocalizationFrame& frame) override
+    {
+        writer.addFrame (frameIndex, frame);
+    }
+
+private:
+    LocalizationRecordingWriter writer;     // closed, index and all, on destruction
+};
+
+//----------------------------------------------------------------------------//
+
+static int printUsage()
+{
+    std::fprintf (stderr, "usage: OfflineLocalizer <input> <output> [--fft 10] [--hop 1024] [--mode udlr|corners|grid|tdoa] [--format csv|bin|rec] [--threads N] [--channels N --rate 44100] [--geometry array.txt]\n");
+    return 1;
+}
+
+int main (int argc, char* argv[])
+{
+    if (argc < 3)
+        return printUsage();
+
+    const File inputFile (File::getCurrentWorkingDirectory().getChildFile (argv[1]));
+    const String outputPath (argv[2]);
+
+    AnalysisSettings settings;
+    String format = outputPath.endsWithIgnoreCase (".csv") ? "csv"
+                  : outputPath.endsWithIgnoreCase (".pnlr") ? "rec" : "bin";
+    bool hopGiven = false;
+    int numThreads = jmax (1, (int) std::thread::hardware_concurrency());
+    int rawChannels = 0;
+    double rawSampleRate = 44100.0;
+    String geometryPath;
+
+    for (int i = 3; i + 1 < argc; i += 2)
+    {
+        const String option (argv[i]);
+        const String value (argv[i + 1]);
+
+        if (option == "--fft")          settings.fftOrder = value.getIntValue();
+        else if (option == "--hop")     { settings.hopSize = value.getIntValue(); hopGiven = true; }
+        else if (option == "--mode")    settings.mode = (value == "corners") ? (int) QuadLocalizer::corners
+                                                      : (value == "grid") ? (int) GridLocalizer::grid
+                                                      : (value == "tdoa") ? (int) TdoaLocalizer::tdoa : (int) QuadLocalizer::udlr;
+        else if (option == "--format")  format = value;
+        else if (option == "--threads") numThreads = jmax (1, value.getIntValue());
+        else if (option == "--channels") rawChannels = value.getIntValue();
+        else if (option == "--rate")    rawSampleRate = value.getDoubleValue();
+        else if (option == "--geometry") geometryPath = value;
+        else                            return printUsage();
+    }
+
+    if (settings.mode == QuadLocalizer::corners)
+    {
+        // mics 3,7,1,9, same as the live CORNERS panogram
+        settings.channel1 = 2; settings.channel2 = 6; settings.channel3 = 0; settings.channel4 = 8;
+    }
+
+    if (geometryPath.isNotEmpty())
+    {
+        const File geometryFile (File::getCurrentWorkingDirectory().getChildFile (geometryPath));
+
+        if (! settings.geometry.load (geometryFile.getFullPathName().toStdString()))
+        {
+            std::fprintf (stderr, "%s: %s\n", geometryPath.toRawUTF8(), settings.geometry.getLastError().c_str());
+            return 1;
+        }
+
+        if (settings.mode != TdoaLocalizer::tdoa)
+            settings.mode = GeometryLocalizer::geometry;
+    }
+
+    if (settings.fftOrder < 8 || settings.fftOrder > 13)
+        return printUsage();
+
+    const int fftSize = 1 << settings.fftOrder;
+    if (! hopGiven)
+        settings.hopSize = fftSize;
+
+    if (settings.hopSize < 1 || settings.hopSize > fftSize)
+        return printUsage();
+
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    ScopedPointer<MultichannelSourceFactory> factory;
+    ScopedPointer<MultichannelSource> source;
+
+    // float files are mapped and read in place, anything else is decoded by JUCE
+    if (rawChannels > 0 || inputFile.hasFileExtension ("wav"))
+    {
+        MappedFileSourceFactory* mappedFactory = new MappedFileSourceFactory (inputFile, rawChannels, rawSampleRate);
+        factory = mappedFactory;
+        source = factory->createSource();
+
+        if (source == nullptr && rawChannels > 0)
+        {
+            std::fprintf (stderr, "%s\n", mappedFactory->getLastError().c_str());
+            return 1;
+        }
+    }
+
+    if (source == nullptr)
+    {
+        factory = new AudioFileSourceFactory (formatManager, inputFile);
+        source = factory->createSource();
+    }
+
+    if (source == nullptr)
+    {
+        std::fprintf (stderr, "can't read %s\n", inputFile.getFullPathName().toRawUTF8());
+        return 1;
+    }
+
+    const bool usesGeometry = settings.mode == GeometryLocalizer::geometry || settings.mode == TdoaLocalizer::tdoa;
+    const ArrayGeometry& geometry = settings.geometry.mics.empty() ? ArrayGeometry::makeDefault() : settings.geometry;
+
+    const int highestChannel = usesGeometry ? geometry.getNumChannelsNeeded() - 1
+                             : (settings.mode == GridLocalizer::grid) ? 8
+                             : jmax (jmax (settings.channel1, settings.channel2), jmax (settings.channel3, settings.channel4));
+    if (source->getNumChannels() <= highestChannel)
+    {
+        std::fprintf (stderr, "need at least %d channels, file has %d\n", highestChannel + 1, source->getNumChannels());
+        return 1;
+    }
+
+    OfflineAnalyser analyser (settings, source->getNumChannels());
+
+    FILE* out = nullptr;
+    ScopedPointer<LocalizationSink> sink;
+
+    if (format == "rec")
+    {
+        // the index goes at the end, so this one needs a real, seekable file
+        RecordingSink* recording = new RecordingSink (outputPath, analyser.getNumBins(), fftSize,
+                                                      settings.hopSize, source->getSampleRate());
+        sink = recording;
+
+        if (! recording->isOpen())
+        {
+            std::fprintf (stderr, "can't write %s\n", outputPath.toRawUTF8());
+            return 1;
+        }
+    }
+    else
+    {
+        out = (outputPath == "-") ? stdout : std::fopen (outputPath.toRawUTF8(), "wb");
+        if (out == nullptr)
+        {
+            std::fprintf (stderr, "can't write %s\n", outputPath.toRawUTF8());
+            return 1;
+        }
+
+        if (format == "csv")
+            sink = new CsvSink (out, settings.hopSize / source->getSampleRate());
+        else
+            sink = new BinarySink (out, analyser.getNumBins(), fftSize, settings.hopSize, source->getSampleRate());
+    }
+
+    const int64 expectedFrames = OfflineAnalyser::getNumFrames (source->getLengthInSamples(), fftSize, settings.hopSize);
+    const double startTime = Time::getMillisecondCounterHiRes();
+    int64 numFrames;
+
+    if (numThreads > 1)
+        numFrames = ParallelOfflineAnalyser (settings, numThreads).analyse (*factory, *sink);
+    else
+        numFrames = analyser.analyse (*source, *sink);
+
+    const double seconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    sink = nullptr;
+    if (out != nullptr && out != stdout)
+        std::fclose (out);
+
+    const double audioSeconds = source->getLengthInSamples() / source->getSampleRate();
+    std::fprintf (stderr, "%lld frames, %.1f s of audio in %.2f s on %d thread%s (%.0fx realtime)\n",
+                  (long long) numFrames, audioSeconds, seconds, numThreads, numThreads == 1 ? "" : "s",
+                  audioSeconds / jmax (seconds, 1.0e-6));
+
+    // a read that failed part way leaves the output short, which nothing downstream would notice
+    if (numFrames != expectedFrames)
+    {
+        std::fprintf (stderr, "reading %s failed after %lld of %lld frames, %s is incomplete\n", inputFile.getFullPathName().toRawUTF8(),
+                      (long long) numFrames, (long long) expectedFrames, outputPath.toRawUTF8());
+        return 1;
+    }
+
+    return 0;
+}
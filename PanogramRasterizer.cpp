@@ -0,0 +1,163 @@
+#include "PanogramRasterizer.h"
+#include "DSPKernels.h"
+
+#include <cmath>
+#include <cstring>
+
+//----------------------------------------------------------------------------//
+
+void PanogramRasterizer::setSize (int newWidth, int newHeight)
+{
+    width = newWidth;
+    height = newHeight;
+
+    pixels.allocate (4 * (size_t) width * height);
+    rowLevel.allocate (height);
+}
+
+void PanogramRasterizer::setNumBins (int newNumBins)
+{
+    numBins = newNumBins;
+
+    colours.allocate (4 * numBins);
+    scratchX.allocate (numBins);
+    scratchY.allocate (numBins);
+    scratchAlpha.allocate (numBins);
+
+    // full saturation and value, same as Colour::fromHSV (i / numBins, 1, 1)
+    for (int i = 0; i < numBins; i++)
+    {
+        const float h = 6.0f * i / numBins;
+        const int sector = (int) h;
+        const float f = h - sector;
+
+        float r, g, b;
+        switch (sector)
+        {
+            case 0:  r = 1.0f;     g = f;        b = 0.0f;     break;
+            case 1:  r = 1.0f - f; g = 1.0f;     b = 0.0f;     break;
+            case 2:  r = 0.0f;     g = 1.0f;     b = f;        break;
+            case 3:  r = 0.0f;     g = 1.0f - f; b = 1.0f;     break;
+            case 4:  r = f;        g = 0.0f;     b = 1.0f;     break;
+            default: r = 1.0f;     g = 0.0f;     b = 1.0f - f; break;
+        }
+
+        colours[4 * i]     = b;
+        colours[4 * i + 1] = g;
+        colours[4 * i + 2] = r;
+        colours[4 * i + 3] = 1.0f;
+    }
+}
+
+void PanogramRasterizer::clear()
+{
+    pixels.clear();
+    rowLevel.clear();
+}
+
+//----------------------------------------------------------------------------//
+
+void PanogramRasterizer::addFrame (const float* x, const float* y, const float* gain, int numBinsInFrame)
+{
+    if (numBinsInFrame != numBins || width == 0 || height == 0)
+        return;
+
+    // positions to pixel coordinates and gains to alpha, whole frame at once
+    const float offset = bilinear ? -0.5f : 0.0f;   // bilinear weights are relative to pixel centres
+
+    DSPKernels::multiplyScalar (x, (float) width, scratchX, numBins);
+    DSPKernels::addScalar (scratchX, offset, scratchX, numBins);
+    DSPKernels::multiplyScalar (y, (float) height, scratchY, numBins);
+    DSPKernels::addScalar (scratchY, offset, scratchY, numBins);
+    DSPKernels::intensity (gain, floorDb, rangeDb, scratchAlpha, numBins);
+
+    const float minAlpha = 0.5f / 255.0f;
+
+    for (int i = 0; i < numBins; i++)
+    {
+        // already clamped, NaN from silent bins is 0
+        const float a = scratchAlpha[i];
+        if (a <= minAlpha)
+            continue;
+
+        const float* colour = colours + 4 * i;
+
+        if (! bilinear)
+        {
+            const int px = (int) scratchX[i];
+            const int py = (int) scratchY[i];
+
+            if (px >= 0 && py >= 0)
+                blend (px < width ? px : width - 1, py < height ? py : height - 1, colour, a);
+
+            continue;
+        }
+
+        const float fx = std::floor (scratchX[i]);
+        const float fy = std::floor (scratchY[i]);
+        const float tx = scratchX[i] - fx;
+        const float ty = scratchY[i] - fy;
+        const int x0 = (int) fx;
+        const int y0 = (int) fy;
+
+        // taps off the edge are dropped, the rest keep their own weight
+        if (y0 >= 0 && y0 < height)
+        {
+            if (x0 >= 0 && x0 < width)          blend (x0, y0, colour, a * (1.0f - tx) * (1.0f - ty));
+            if (x0 + 1 >= 0 && x0 + 1 < width)  blend (x0 + 1, y0, colour, a * tx * (1.0f - ty));
+        }
+
+        if (y0 + 1 >= 0 && y0 + 1 < height)
+        {
+            if (x0 >= 0 && x0 < width)          blend (x0, y0 + 1, colour, a * (1.0f - tx) * ty);
+            if (x0 + 1 >= 0 && x0 + 1 < width)  blend (x0 + 1, y0 + 1, colour, a * tx * ty);
+        }
+    }
+}
+
+void PanogramRasterizer::render (uint8_t* dst, int lineStride, double elapsedMs)
+{
+    const int rowSize = 4 * width;
+    const float fade = (float) std::pow ((double) decay, elapsedMs * decayRate / 1000.0);
+
+    // below this a value packs to 0 and every later fade keeps it there
+    const float visible = 0.5f / 255.0f;
+
+    for (int row = 0; row < height; row++)
+    {
+        uint8_t* dstRow = dst + (size_t) row * lineStride;
+
+        if (rowLevel[row] == 0.0f)
+        {
+            std::memset (dstRow, 0, rowSize);
+            continue;
+        }
+
+        float* src = pixels + (size_t) row * rowSize;
+
+        DSPKernels::packBytes (src, dstRow, rowSize);
+
+        rowLevel[row] *= fade;
+
+        if (rowLevel[row] < visible)
+        {
+            std::memset (src, 0, rowSize * sizeof (float));
+            rowLevel[row] = 0.0f;
+        }
+        else
+        {
+            DSPKernels::multiplyScalar (src, fade, src, rowSize);
+        }
+    }
+}
+
+int PanogramRasterizer::getNumActiveRows() const
+{
+    int active = 0;
+
+    for (int row = 0; row < height; row++)
+        if (rowLevel[row] > 0.0f)
+            active++;
+
+    return active;
+}
@@ -0,0 +1,113 @@
+#ifndef PANOGRAMRASTERIZER_H_INCLUDED
+#define PANOGRAMRASTERIZER_H_INCLUDED
+
+#include "AlignedBuffer.h"
+
+#include <cstdint>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Draws localized frames into a fading panogram, without JUCE.
+
+  The image is kept as premultiplied float pixels. addFrame() blends every
+  audible bin over the pixel at its (x, y), in the bin's colour from a hue
+  table built once per bin count, with alpha the bin's dB gain mapped from
+  floorDb..floorDb + rangeDb to 0..1 (DSPKernels::intensity). With
+  bilinear on, each bin is spread over the 4 pixels around its exact
+  position, so positions stay smooth at any resolution instead of snapping
+  to an 80x80 grid.
+
+  render() packs the floats to 8 bit premultiplied ARGB (the byte order of
+  a JUCE ARGB Image on little endian) and fades the image by the decay
+  factor per 1 / decayRate seconds since the last render, one row at a time so each row is faded while still in cache. Rows
+  that have faded out are cleared once and then skipped until something is
+  drawn in them again, so a mostly empty panogram costs almost nothing, and
+  values never decay into denormals.
+
+  note:
+  - the fade happens once per render(), not once per addFrame(); several
+    frames added between renders fade together
+  - the fade goes by time, so trails are as long at 15 renders a second as
+    at 60, whatever the hop size or the display pacing
+  - quiet bins (alpha under half a step of 8 bit) are skipped before any
+    pixel is touched
+  - row 0 is the top of the image, y = 0 is the top row
+
+ */
+
+class PanogramRasterizer
+{
+public:
+    enum
+    {
+        decayRate = 30      // Hz: decay is per 1/30 s, as when a 30 Hz timer drew the panogram
+    };
+
+    PanogramRasterizer() {}
+
+    /* Allocates and clears. */
+    void setSize (int width, int height);
+    int getWidth() const                    { return width; }
+    int getHeight() const                   { return height; }
+
+    /* Rebuilds the colour table: bin i gets hue i / numBins. */
+    void setNumBins (int numBins);
+    int getNumBins() const                  { return numBins; }
+
+    void setBilinear (bool shouldSplat)     { bilinear = shouldSplat; }
+    void setDecay (float newDecay)          { decay = newDecay; }
+
+    /* floorDb and below is transparent, floorDb + rangeDb and above opaque. */
+    void setLevelRange (float newFloorDb, float newRangeDb)
+    {
+        floorDb = newFloorDb;
+        rangeDb = newRangeDb > 0.01f ? newRangeDb : 0.01f;
+    }
+
+    float getFloorDb() const                { return floorDb; }
+    float getRangeDb() const                { return rangeDb; }
+
+    void clear();
+
+    /* Blends one frame in. x and y are 0..1, numBins must match setNumBins(). */
+    void addFrame (const float* x, const float* y, const float* gain, int numBins);
+
+    /* Writes width x height ARGB pixels, lineStride bytes apart, then fades
+       for elapsedMs, the time since the last render. */
+    void render (uint8_t* dst, int lineStride, double elapsedMs = 1000.0 / decayRate);
+
+    /* Rows still holding something visible (for the benchmark). */
+    int getNumActiveRows() const;
+
+private:
+    inline void blend (int px, int py, const float* colour, float alpha)
+    {
+        float* pixel = pixels + 4 * ((size_t) py * width + px);
+
+        for (int c = 0; c < 4; c++)
+            pixel[c] += (colour[c] - pixel[c]) * alpha;
+
+        rowLevel[py] = 1.0f;
+    }
+
+    int width = 0;
+    int height = 0;
+    int numBins = 0;
+
+    bool bilinear = true;
+    float decay = 0.9f;
+    float floorDb = 0.0f;
+    float rangeDb = 0.5f;       // gain / 0.5, as the panogram always had it
+
+    AlignedBuffer<float> pixels;        // premultiplied b, g, r, a per pixel
+    AlignedBuffer<float> rowLevel;      // upper bound of every value in the row, 0 = cleared
+    AlignedBuffer<float> colours;       // b, g, r, 1 per bin
+    AlignedBuffer<float> scratchX, scratchY, scratchAlpha;
+
+    PanogramRasterizer (const PanogramRasterizer&);
+    PanogramRasterizer& operator= (const PanogramRasterizer&);
+};
+
+#endif  // PANOGRAMRASTERIZER_H_INCLUDED
@@ -0,0 +1,147 @@
+#include "ParallelOfflineAnalyser.h"
+#include "WorkStealingPool.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+//----------------------------------------------------------------------------//
+
+namespace
+{
+    /* Frames of one chunk, kept until every earlier chunk has gone out. */
+    struct ChunkResult : public LocalizationSink
+    {
+        ChunkResult (int numBinsToUse) : numBins (numBinsToUse) {}
+
+        void frameReady (int64_t, const LocalizationFrame& frame) override
+        {
+            x.insert (x.end(), frame.x, frame.x + numBins);
+            y.insert (y.end(), frame.y, frame.y + numBins);
+            gain.insert (gain.end(), frame.gain, frame.gain + numBins);
+            gainY.insert (gainY.end(), frame.gainY, frame.gainY + numBins);
+        }
+
+        int getNumFrames() const        { return (int) (x.size() / numBins); }
+
+        LocalizationFrame getFrame (int i) const
+        {
+            LocalizationFrame frame = { numBins, &x[i * numBins], &y[i * numBins], &gain[i * numBins], &gainY[i * numBins] };
+            return frame;
+        }
+
+        int numBins;
+        bool failed = false;        // no source, or it stopped short
+        std::vector<float> x, y, gain, gainY;
+    };
+
+    struct WorkerState
+    {
+        std::unique_ptr<MultichannelSource> source;
+        std::unique_ptr<OfflineAnalyser> analyser;
+    };
+}
+
+//----------------------------------------------------------------------------//
+
+ParallelOfflineAnalyser::ParallelOfflineAnalyser (const AnalysisSettings& settingsToUse, int numThreadsToUse, int framesPerChunkToUse)
+    : settings (settingsToUse),
+      numThreads (numThreadsToUse < 1 ? 1 : numThreadsToUse),
+      framesPerChunk (framesPerChunkToUse < 1 ? 1 : framesPerChunkToUse)
+{
+}
+
+int64_t ParallelOfflineAnalyser::analyse (MultichannelSourceFactory& factory, LocalizationSink& sink)
+{
+    const int fftSize = 1 << settings.fftOrder;
+    const int numBins = fftSize / 2;
+    int numChannels;
+    int64_t numFrames;
+
+    {
+        std::unique_ptr<MultichannelSource> probe (factory.createSource());
+        if (probe == nullptr)
+            return 0;
+
+        numChannels = probe->getNumChannels();
+        numFrames = OfflineAnalyser::getNumFrames (probe->getLengthInSamples(), fftSize, settings.hopSize);
+    }
+
+    const int64_t numChunks = (numFrames + framesPerChunk - 1) / framesPerChunk;
+    const int64_t maxChunksInFlight = 4 * numThreads;
+
+    std::vector<WorkerState> workers (numThreads);
+    std::vector<std::unique_ptr<ChunkResult>> results ((size_t) numChunks);
+
+    std::mutex mergeLock;
+    std::condition_variable chunkEmitted;
+    int64_t nextChunkToEmit = 0;
+    int64_t framesEmitted = 0;
+    bool failed = false;            // a chunk came back short: nothing from it on goes out
+
+    WorkStealingPool pool (numThreads);
+
+    for (int64_t chunk = 0; chunk < numChunks; chunk++)
+    {
+        // don't run too far ahead of the oldest unfinished chunk
+        {
+            std::unique_lock<std::mutex> ml (mergeLock);
+            chunkEmitted.wait (ml, [&] { return failed || chunk - nextChunkToEmit < maxChunksInFlight; });
+
+            if (failed)
+                break;
+        }
+
+        pool.submit ([&, chunk] (int workerIndex)
+        {
+            WorkerState& worker = workers[workerIndex];
+
+            if (worker.analyser == nullptr)
+            {
+                worker.source.reset (factory.createSource());
+                worker.analyser.reset (new OfflineAnalyser (settings, numChannels));
+            }
+
+            const int64_t firstFrame = chunk * framesPerChunk;
+            const int64_t chunkFrames = std::min<int64_t> (framesPerChunk, numFrames - firstFrame);
+
+            std::unique_ptr<ChunkResult> result (new ChunkResult (numBins));
+            result->x.reserve ((size_t) (chunkFrames * numBins));
+            result->y.reserve ((size_t) (chunkFrames * numBins));
+            result->gain.reserve ((size_t) (chunkFrames * numBins));
+            result->gainY.reserve ((size_t) (chunkFrames * numBins));
+
+            result->failed = worker.source == nullptr
+                              || worker.analyser->analyse (*worker.source, *result, firstFrame, chunkFrames) != chunkFrames;
+
+            // hand over every chunk that is now next in line
+            std::lock_guard<std::mutex> ml (mergeLock);
+            results[(size_t) chunk] = std::move (result);
+
+            while (! failed && nextChunkToEmit < numChunks && results[(size_t) nextChunkToEmit] != nullptr)
+            {
+                const ChunkResult& ready = *results[(size_t) nextChunkToEmit];
+                const int64_t readyFirstFrame = nextChunkToEmit * framesPerChunk;
+
+                // a hole in the frames would go unnoticed downstream: stop at it
+                if (ready.failed)
+                {
+                    failed = true;
+                    break;
+                }
+
+                for (int i = 0; i < ready.getNumFrames(); i++)
+                    sink.frameReady (readyFirstFrame + i, ready.getFrame (i));
+
+                framesEmitted += ready.getNumFrames();
+                results[(size_t) nextChunkToEmit].reset();
+                ++nextChunkToEmit;
+            }
+
+            chunkEmitted.notify_all();
+        });
+    }
+
+    pool.waitForAll();
+    return framesEmitted;
+}
@@ -0,0 +1,54 @@
+#ifndef PARALLELOFFLINEANALYSER_H_INCLUDED
+#define PARALLELOFFLINEANALYSER_H_INCLUDED
+
+#include "OfflineAnalyser.h"
+
+//----------------------------------------------------------------------------//
+
+/* Makes one independent source per worker (file readers aren't thread-safe). */
+
+class MultichannelSourceFactory
+{
+public:
+    virtual ~MultichannelSourceFactory() {}
+
+    virtual MultichannelSource* createSource() = 0;
+};
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  OfflineAnalyser spread over all cores.
+
+  The recording is cut into chunks of whole frames. Each chunk reads its
+  own audio, including the fftSize - hop samples it shares with the next
+  chunk, so every frame comes out bit-identical to a serial run. Chunks run
+  on a WorkStealingPool, each worker with its own analyser and source, and
+  are handed to the sink strictly in frame order as soon as every earlier
+  chunk is done.
+
+  Only a bounded number of chunks are in flight at once, so memory doesn't
+  grow with file length even if one chunk is slow.
+
+ */
+
+class ParallelOfflineAnalyser
+{
+public:
+    ParallelOfflineAnalyser (const AnalysisSettings& settings, int numThreads, int framesPerChunk = 256);
+
+    /* Analyses the whole source. The sink sees frames in order, one call at a
+       time, from whichever worker completed the chunk. If a worker can't
+       make a source or read its chunk, nothing from that chunk on goes to
+       the sink and the count returned is short of
+       OfflineAnalyser::getNumFrames(). */
+    int64_t analyse (MultichannelSourceFactory& factory, LocalizationSink& sink);
+
+private:
+    AnalysisSettings settings;
+    int numThreads;
+    int framesPerChunk;
+};
+
+#endif  // PARALLELOFFLINEANALYSER_H_INCLUDED
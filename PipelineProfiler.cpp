@@ -0,0 +1,131 @@
+#include "PipelineProfiler.h"
+
+#include <cstdio>
+
+//----------------------------------------------------------------------------//
+
+void PipelineProfiler::takeSnapshot (Snapshot& snapshot) const
+{
+    for (int s = 0; s < numStages; s++)
+    {
+        uint32_t* out = snapshot.buckets.data() + (size_t) s * numBuckets;
+
+        for (int b = 0; b < numBuckets; b++)
+            out[b] = buckets[s][b].load (std::memory_order_relaxed);
+
+        snapshot.totalNanos[s] = totalNanos[s].load (std::memory_order_relaxed);
+    }
+
+    for (int c = 0; c < numCounters; c++)
+        snapshot.counters[c] = counters[c].load (std::memory_order_relaxed);
+
+    snapshot.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double getBucketMiddleMicros (int bucket)
+{
+    const uint64_t start = PipelineProfiler::getBucketStart (bucket);
+    const uint64_t end = bucket + 1 < PipelineProfiler::numBuckets ? PipelineProfiler::getBucketStart (bucket + 1) : start + 1;
+
+    return 0.5e-3 * (double) (start + end - 1);
+}
+
+PipelineProfiler::StageStats PipelineProfiler::getStageStats (Stage stage, const Snapshot& now, const Snapshot& before)
+{
+    const uint32_t* counts = now.buckets.data() + (size_t) stage * numBuckets;
+    const uint32_t* previous = before.buckets.data() + (size_t) stage * numBuckets;
+
+    uint64_t calls = 0;
+    int highest = -1;
+
+    // counts only go up, and wrap around together with their difference
+    for (int b = 0; b < numBuckets; b++)
+    {
+        const uint32_t n = counts[b] - previous[b];
+        calls += n;
+
+        if (n > 0)
+            highest = b;
+    }
+
+    StageStats stats = { getStageName (stage), 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+    if (calls == 0)
+        return stats;
+
+    const double seconds = now.seconds - before.seconds;
+    stats.callsPerSecond = seconds > 0.0 ? calls / seconds : 0.0;
+    stats.meanMicros = 1.0e-3 * (double) (now.totalNanos[stage] - before.totalNanos[stage]) / calls;
+    stats.maxMicros = getBucketMiddleMicros (highest);
+
+    // the smallest bucket with at least p of the calls at or below it
+    const uint64_t p50Rank = (calls + 1) / 2;
+    const uint64_t p99Rank = calls - calls / 100;
+    uint64_t seen = 0;
+
+    for (int b = 0; b <= highest; b++)
+    {
+        const uint64_t n = counts[b] - previous[b];
+
+        if (seen < p50Rank && seen + n >= p50Rank)
+            stats.p50Micros = getBucketMiddleMicros (b);
+
+        if (seen < p99Rank && seen + n >= p99Rank)
+            stats.p99Micros = getBucketMiddleMicros (b);
+
+        seen += n;
+    }
+
+    return stats;
+}
+
+uint64_t PipelineProfiler::getCounterDelta (Counter counter, const Snapshot& now, const Snapshot& before)
+{
+    return now.counters[counter] - before.counters[counter];
+}
+
+const char* PipelineProfiler::getStageName (Stage stage)
+{
+    static const char* const names[numStages] =
+    {
+        "audio callback", "fifo read", "window", "fft", "magnitudes",
+        "localize", "tracking", "rasterize", "paint", "display tick"
+    };
+
+    return names[stage];
+}
+
+const char* PipelineProfiler::getCounterName (Counter counter)
+{
+    static const char* const names[numCounters] = { "dropped blocks", "late display ticks" };
+
+    return names[counter];
+}
+
+std::string PipelineProfiler::formatReport (const Snapshot& now, const Snapshot& before)
+{
+    char line[128];
+    std::snprintf (line, sizeof (line), "%-16s %9s %9s %9s %9s %9s\n", "stage", "calls/s", "mean us", "p50 us", "p99 us", "max us");
+    std::string report (line);
+
+    for (int s = 0; s < numStages; s++)
+    {
+        const StageStats stats = getStageStats ((Stage) s, now, before);
+
+        if (stats.callsPerSecond > 0.0)
+        {
+            std::snprintf (line, sizeof (line), "%-16s %9.1f %9.1f %9.1f %9.1f %9.1f\n", stats.name,
+                           stats.callsPerSecond, stats.meanMicros, stats.p50Micros, stats.p99Micros, stats.maxMicros);
+            report += line;
+        }
+    }
+
+    for (int c = 0; c < numCounters; c++)
+    {
+        std::snprintf (line, sizeof (line), "%s%s %llu", c == 0 ? "" : ", ", getCounterName ((Counter) c),
+                       (unsigned long long) getCounterDelta ((Counter) c, now, before));
+        report += line;
+    }
+
+    return report + "\n";
+}
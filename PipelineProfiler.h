@@ -0,0 +1,238 @@
+#ifndef PIPELINEPROFILER_H_INCLUDED
+#define PIPELINEPROFILER_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined (_MSC_VER)
+ #include <intrin.h>
+#endif
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Where the time goes, per pipeline stage, without JUCE.
+
+  Every stage has a latency histogram in nanoseconds, HDR style: exact up
+  to 16 ns, then 16 linear buckets per power of two, so any value is
+  within 1/16 of its bucket's start and 592 buckets cover 1 ns to about
+  18 minutes. Recording is a bucket index (a count-leading-zeros and a
+  shift) and two relaxed atomic adds: no locks, no allocation, safe from
+  any thread, the audio thread included.
+
+  Readers never reset anything. They copy the counts into a Snapshot now
+  and then and look at the difference from the previous one, so the
+  overlay and the log each get their own interval without disturbing
+  each other.
+
+  usage:
+    PANOGRAM_PROFILE_SCOPE (PipelineProfiler::fft);
+    PANOGRAM_PROFILE_COUNT (PipelineProfiler::lateTicks, 1);
+
+  note:
+  - built with PANOGRAM_PROFILING=0 the macros are empty, so nothing is
+    timed or counted and the stages cost exactly what they did before
+  - one scope costs two clock reads and the adds, well under 100 ns;
+    see Benchmarks/PipelineProfilerBenchmark.cpp against the stages' own
+    times
+  - the instance is a function-local static, so code that only records
+    doesn't need PipelineProfiler.cpp linked in
+
+ */
+
+#ifndef PANOGRAM_PROFILING
+ #define PANOGRAM_PROFILING 1
+#endif
+
+class PipelineProfiler
+{
+public:
+    enum Stage
+    {
+        audioCallback,      // getNextAudioBlock: ingest into the analysis fifo
+        fifoRead,           // the analysis thread copying a frame out of the fifo
+        window,             // window and pack
+        fft,
+        magnitudes,         // unpack and magnitudes
+        localize,           // the panogram's localizer
+        tracking,           // SourceTracker
+        rasterize,          // PanogramRasterizer addFrame and render
+        paint,              // PanogramComp::paint, drawImageWithin included
+        displayTick,        // one RenderScheduler render, all of the above but paint
+        numStages
+    };
+
+    enum Counter
+    {
+        droppedBlocks,      // audio blocks the analysis fifo had no room for
+        lateTicks,          // paced renders more than half an interval late
+        numCounters
+    };
+
+    enum
+    {
+        subBucketBits = 4,
+        subBuckets = 1 << subBucketBits,
+        maxMagnitude = 40,  // 2^40 ns and above share the last bucket
+        numBuckets = (maxMagnitude - subBucketBits + 1) * subBuckets
+    };
+
+    static PipelineProfiler& getInstance()
+    {
+        static PipelineProfiler instance;
+        return instance;
+    }
+
+    PipelineProfiler()
+    {
+        for (int s = 0; s < numStages; s++)
+        {
+            for (int b = 0; b < numBuckets; b++)
+                buckets[s][b].store (0, std::memory_order_relaxed);
+
+            totalNanos[s].store (0, std::memory_order_relaxed);
+        }
+
+        for (int c = 0; c < numCounters; c++)
+            counters[c].store (0, std::memory_order_relaxed);
+    }
+
+    //==========================================================================
+
+    static int getBucket (uint64_t nanos)
+    {
+        if (nanos < (uint64_t) subBuckets)
+            return (int) nanos;
+
+        const int magnitude = getHighestBit (nanos);    // >= subBucketBits
+
+        if (magnitude >= maxMagnitude)
+            return numBuckets - 1;
+
+        const int shift = magnitude - subBucketBits;
+        return (shift + 1) * subBuckets + (int) (nanos >> shift) - subBuckets;
+    }
+
+    static int getHighestBit (uint64_t value)
+    {
+       #if defined (_MSC_VER)
+        unsigned long bit;
+        _BitScanReverse64 (&bit, value);
+        return (int) bit;
+       #else
+        return 63 - __builtin_clzll (value);
+       #endif
+    }
+
+    /* The smallest value that lands in a bucket. */
+    static uint64_t getBucketStart (int bucket)
+    {
+        if (bucket < subBuckets)
+            return (uint64_t) bucket;
+
+        const int shift = bucket / subBuckets - 1;
+        return (uint64_t) (bucket % subBuckets + subBuckets) << shift;
+    }
+
+    void record (Stage stage, uint64_t nanos)
+    {
+        buckets[stage][getBucket (nanos)].fetch_add (1, std::memory_order_relaxed);
+        totalNanos[stage].fetch_add (nanos, std::memory_order_relaxed);
+    }
+
+    void count (Counter counter, uint64_t amount = 1)
+    {
+        counters[counter].fetch_add (amount, std::memory_order_relaxed);
+    }
+
+    //==========================================================================
+
+    class ScopedStageTimer
+    {
+    public:
+        explicit ScopedStageTimer (Stage stageToTime)
+            : stage (stageToTime), start (Clock::now())
+        {
+        }
+
+        ~ScopedStageTimer()
+        {
+            const uint64_t nanos = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (Clock::now() - start).count();
+            PipelineProfiler::getInstance().record (stage, nanos);
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        Stage stage;
+        Clock::time_point start;
+
+        ScopedStageTimer (const ScopedStageTimer&);
+        ScopedStageTimer& operator= (const ScopedStageTimer&);
+    };
+
+    //==========================================================================
+
+    /* A copy of every count at one moment. Allocates once, in the constructor. */
+    struct Snapshot
+    {
+        Snapshot() : buckets ((size_t) numStages * numBuckets) {}
+
+        std::vector<uint32_t> buckets;      // [stage][bucket]
+        uint64_t totalNanos[numStages] = {};
+        uint64_t counters[numCounters] = {};
+        double seconds = 0.0;               // steady clock, when it was taken
+    };
+
+    void takeSnapshot (Snapshot& snapshot) const;
+
+    /* One stage over the interval between two snapshots. Latencies are in
+       microseconds, the middle of the bucket they fall in. */
+    struct StageStats
+    {
+        const char* name;
+        double callsPerSecond;
+        double meanMicros;
+        double p50Micros;
+        double p99Micros;
+        double maxMicros;
+    };
+
+    static StageStats getStageStats (Stage stage, const Snapshot& now, const Snapshot& before);
+    static uint64_t getCounterDelta (Counter counter, const Snapshot& now, const Snapshot& before);
+
+    static const char* getStageName (Stage stage);
+    static const char* getCounterName (Counter counter);
+
+    /* A table of every stage that ran in the interval, then the counters. */
+    static std::string formatReport (const Snapshot& now, const Snapshot& before);
+
+private:
+    std::atomic<uint32_t> buckets[numStages][numBuckets];
+    std::atomic<uint64_t> totalNanos[numStages];
+    std::atomic<uint64_t> counters[numCounters];
+
+    PipelineProfiler (const PipelineProfiler&);
+    PipelineProfiler& operator= (const PipelineProfiler&);
+};
+
+//----------------------------------------------------------------------------//
+
+#if PANOGRAM_PROFILING
+ #define PANOGRAM_PROFILE_CONCAT2(a, b) a ## b
+ #define PANOGRAM_PROFILE_CONCAT(a, b) PANOGRAM_PROFILE_CONCAT2 (a, b)
+ #define PANOGRAM_PROFILE_SCOPE(stage) \
+     PipelineProfiler::ScopedStageTimer PANOGRAM_PROFILE_CONCAT (profiledScope, __LINE__) (stage)
+ #define PANOGRAM_PROFILE_RECORD(stage, nanos)  PipelineProfiler::getInstance().record (stage, nanos)
+ #define PANOGRAM_PROFILE_COUNT(counter, amount) PipelineProfiler::getInstance().count (counter, amount)
+#else
+ #define PANOGRAM_PROFILE_SCOPE(stage)
+ #define PANOGRAM_PROFILE_RECORD(stage, nanos)
+ #define PANOGRAM_PROFILE_COUNT(counter, amount)
+#endif
+
+#endif  // PIPELINEPROFILER_H_INCLUDED
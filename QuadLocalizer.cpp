@@ -0,0 +1,94 @@
+#include "QuadLocalizer.h"
+#include "DSPKernels.h"
+
+//----------------------------------------------------------------------------//
+
+QuadLocalizer::QuadLocalizer (int channelToUse1, int channelToUse2,
+                              int channelToUse3, int channelToUse4,
+                              int modeToUse)
+    : mode (modeToUse),
+      channel1 (channelToUse1),  //  0 = Up    , 1 = UpperLeft
+      channel2 (channelToUse2),  //  0 = Down  , 1 = UpperRight
+      channel3 (channelToUse3),  //  0 = Left  , 1 = LowerLeft
+      channel4 (channelToUse4)   //  0 = Right , 1 = LowerRight
+{
+}
+
+void QuadLocalizer::setNumBins (int newNumBins)
+{
+    numBins = newNumBins;
+
+    gainDataX1.allocate (numBins);
+    xoverDataX1.allocate (numBins);
+    gainDataY1.allocate (numBins);
+    xoverDataY1.allocate (numBins);
+
+    cornersDataU.allocate (numBins);
+    cornersDataD.allocate (numBins);
+    cornersDataL.allocate (numBins);
+    cornersDataR.allocate (numBins);
+}
+
+void QuadLocalizer::process (const SpectrumFrame& frame)
+{
+    if (frame.numBins != numBins)
+        setNumBins (frame.numBins);
+
+    processQuad (frame.getChannel (channel1), frame.getChannel (channel2),
+                 frame.getChannel (channel3), frame.getChannel (channel4));
+}
+
+void QuadLocalizer::process (const float* const* channelMagnitudes)
+{
+    processQuad (channelMagnitudes[channel1], channelMagnitudes[channel2],
+                 channelMagnitudes[channel3], channelMagnitudes[channel4]);
+}
+
+void QuadLocalizer::processQuad (const float* fftData1, const float* fftData2,
+                                 const float* fftData3, const float* fftData4)
+{
+    // mode 0 UDLR, straight from the spectra
+    const float* fftDataU = fftData1;
+    const float* fftDataD = fftData2;
+    const float* fftDataL = fftData3;
+    const float* fftDataR = fftData4;
+
+    // mode 1 CORNERS
+    if (mode == corners)
+    {
+        DSPKernels::add (fftData1, fftData2, cornersDataU, numBins);
+        DSPKernels::add (fftData3, fftData4, cornersDataD, numBins);
+        DSPKernels::add (fftData1, fftData3, cornersDataL, numBins);
+        DSPKernels::add (fftData2, fftData4, cornersDataR, numBins);
+
+        fftDataU = cornersDataU;
+        fftDataD = cornersDataD;
+        fftDataL = cornersDataL;
+        fftDataR = cornersDataR;
+    }
+
+    // compute crossover, gains (y needs U + D either way)
+    computeCrossoverGains (fftDataL, fftDataR, gainDataX1, xoverDataX1, numBins);
+    computeCrossoverGains (fftDataU, fftDataD, gainDataY1, xoverDataY1, numBins);
+
+    // dbscale gains
+    const float offset = 1.0000000001f;
+    DSPKernels::addScalar (gainDataX1, offset, gainDataX1, numBins);
+    DSPKernels::decibels (gainDataX1, zeroReference, gainDataX1, numBins);
+
+    if (gainYUsed)
+    {
+        DSPKernels::addScalar (gainDataY1, offset, gainDataY1, numBins);
+        DSPKernels::decibels (gainDataY1, zeroReference, gainDataY1, numBins);
+    }
+}
+
+void QuadLocalizer::computeCrossoverGains (const float* fftDataL, const float* fftDataR,
+                                           float* gainData, float* xoverData, int numBins)
+{
+    // gain = l + r
+    DSPKernels::add (fftDataL, fftDataR, gainData, numBins);
+
+    // xover = r / gain
+    DSPKernels::divide (fftDataR, gainData, xoverData, numBins);
+}
@@ -0,0 +1,97 @@
+#ifndef QUADLOCALIZER_H_INCLUDED
+#define QUADLOCALIZER_H_INCLUDED
+
+#include "AlignedBuffer.h"
+#include "SpectrumFrame.h"
+
+//----------------------------------------------------------------------------//
+
+/* One frame of localizer output: per-bin position (0..1) and dB gains. Points
+   at data owned by whoever produced it. */
+
+struct LocalizationFrame
+{
+    int numBins;
+    const float* x;
+    const float* y;
+    const float* gain;      // L + R
+    const float* gainY;     // U + D
+};
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  The 4-channel localization math, without any drawing.
+
+  Per bin: x = R / (L + R), y = D / (U + D), and the dB gain of L + R. Shared
+  by PanogramComp and the offline tools so they give identical answers.
+  The dB gain of U + D as well, unless setGainYUsed (false): the panogram
+  only draws L + R, so it skips those two passes.
+
+  mode 0 (UDLR): channels are Up, Down, Left, Right
+  mode 1 (CORNERS): channels are UpperLeft, UpperRight, LowerLeft, LowerRight
+
+ */
+
+class QuadLocalizer
+{
+public:
+    enum { udlr = 0, corners = 1 };
+
+    QuadLocalizer (int channelToUse1, int channelToUse2,
+                   int channelToUse3, int channelToUse4,
+                   int modeToUse);
+
+    /* Allocates for numBins. process (SpectrumFrame) calls this when the size changes. */
+    void setNumBins (int numBins);
+    int getNumBins() const                  { return numBins; }
+
+    /* channelMagnitudes[c] is channel c's spectrum, getNumBins() long. */
+    void process (const float* const* channelMagnitudes);
+    void process (const SpectrumFrame& frame);
+
+    const float* getX() const               { return xoverDataX1; }
+    const float* getY() const               { return xoverDataY1; }
+    const float* getGain() const            { return gainDataX1; }   // dB, L + R
+    const float* getGainY() const           { return gainYUsed ? gainDataY1 : gainDataX1; }   // dB, U + D
+
+    /* Off: getGainY() and the frame's gainY are L + R too. */
+    void setGainYUsed (bool shouldWorkOutGainY)     { gainYUsed = shouldWorkOutGainY; }
+    bool isGainYUsed() const                        { return gainYUsed; }
+
+    LocalizationFrame getFrame() const
+    {
+        LocalizationFrame frame = { numBins, xoverDataX1, xoverDataY1, gainDataX1, getGainY() };
+        return frame;
+    }
+
+    static void computeCrossoverGains (const float* fftDataL, const float* fftDataR,
+                                       float* gainData, float* xoverData, int numBins);
+
+    int mode;
+    float zeroReference = 1.1f; // magnitude at 0 dB
+
+private:
+    void processQuad (const float* fftData1, const float* fftData2,
+                      const float* fftData3, const float* fftData4);
+
+    int channel1, channel2, channel3, channel4;
+    int numBins = 0;
+    bool gainYUsed = true;
+
+    AlignedBuffer<float> gainDataX1;
+    AlignedBuffer<float> xoverDataX1;
+    AlignedBuffer<float> gainDataY1;
+    AlignedBuffer<float> xoverDataY1;
+
+    AlignedBuffer<float> cornersDataU;
+    AlignedBuffer<float> cornersDataD;
+    AlignedBuffer<float> cornersDataL;
+    AlignedBuffer<float> cornersDataR;
+
+    QuadLocalizer (const QuadLocalizer&);
+    QuadLocalizer& operator= (const QuadLocalizer&);
+};
+
+#endif  // QUADLOCALIZER_H_INCLUDED
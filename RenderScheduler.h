@@ -0,0 +1,132 @@
+#ifndef RENDERSCHEDULER_H_INCLUDED
+#define RENDERSCHEDULER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FramePacer.h"
+#include "PipelineProfiler.h"
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Draws the display when there is something new to draw, and no more often
+  than FramePacer allows.
+
+  Whatever produces frames (the analysis thread, a replay) calls
+  triggerAsyncUpdate() on this once a frame is published, from any thread.
+  JUCE folds every trigger before the message thread gets round to it into
+  one callback. If the pacer says it's too soon, a one-shot timer waits out
+  the rest of the interval, and triggers in the meantime change nothing; then
+  the client draws whatever is newest. So frames coming faster than the
+  display wants are coalesced, and with no frames nothing here runs at all:
+  no polling timer.
+
+  The cost of each render (the client's renderNewFrame() plus whatever its
+  paint() reported through addPaintCost() since the last one) goes to the
+  pacer, which slows the rate and then lowers the client's resolution when
+  drawing gets expensive.
+
+  note:
+  - message thread only, apart from triggerAsyncUpdate()
+  - JUCE 4 can't tell the display's refresh rate, so it's 60 Hz unless
+    setRefreshRate() says otherwise
+
+ */
+
+class RenderScheduler : public AsyncUpdater,
+                        private Timer
+{
+public:
+    class Client
+    {
+    public:
+        virtual ~Client() {}
+
+        /* Draws the newest frame; false if nothing was new since the last call. */
+        virtual bool renderNewFrame() = 0;
+
+        /* Draws at 1 / divisor of full width and height from now on. */
+        virtual void setResolutionDivisor (int divisor) = 0;
+    };
+
+    RenderScheduler (Client& clientToUse) : client (clientToUse) {}
+
+    ~RenderScheduler()
+    {
+        cancelPendingUpdate();
+        stopTimer();
+    }
+
+    FramePacer& getPacer()                  { return pacer; }
+
+    void setRefreshRate (double hz)         { pacer.setRefreshRate (hz); }
+
+    /* From the client's paint(): what drawing the last frame on screen cost. */
+    void addPaintCost (double ms)           { paintMs += ms; }
+
+    int getNumRenders() const               { return numRenders; }
+
+private:
+    void handleAsyncUpdate() override
+    {
+        if (isTimerRunning())
+            return;
+
+        const double now = Time::getMillisecondCounterHiRes();
+        const double wait = pacer.getNextRenderMs() - now;
+
+        if (wait >= 1.0)
+        {
+            startTimer (roundToInt (wait));
+            return;
+        }
+
+        render (now);
+    }
+
+    void timerCallback() override
+    {
+        stopTimer();
+
+        const double now = Time::getMillisecondCounterHiRes();
+
+       #if PANOGRAM_PROFILING
+        // a message thread busy elsewhere shows up as renders that come late
+        if (now - pacer.getNextRenderMs() > 0.5 * pacer.getInterval())
+            PANOGRAM_PROFILE_COUNT (PipelineProfiler::lateTicks, 1);
+       #endif
+
+        render (now);
+    }
+
+    void render (double start)
+    {
+        bool drawn;
+        {
+            PANOGRAM_PROFILE_SCOPE (PipelineProfiler::displayTick);
+            drawn = client.renderNewFrame();
+        }
+
+        if (! drawn)
+            return;
+
+        numRenders++;
+
+        const int divisor = pacer.getResolutionDivisor();
+
+        pacer.addRender (start, Time::getMillisecondCounterHiRes() - start + paintMs);
+        paintMs = 0.0;
+
+        if (pacer.getResolutionDivisor() != divisor)
+            client.setResolutionDivisor (pacer.getResolutionDivisor());
+    }
+
+    Client& client;
+    FramePacer pacer;
+    double paintMs = 0.0;
+    int numRenders = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderScheduler)
+};
+
+#endif  // RENDERSCHEDULER_H_INCLUDED
@@ -0,0 +1,282 @@
+#ifndef REPLAYTHREAD_H_INCLUDED
+#define REPLAYTHREAD_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "AudioFileSource.h"
+#include "LocalizationRecording.h"
+#include "LocalizationSnapshot.h"
+#include "OfflineAnalyser.h"
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Plays a session back into the panogram at 1x to 50x, instead of the
+  live input.
+
+  The source is either a .pnlr recording (frames are read back) or an audio
+  file (analysed on the fly with the same STFT and localizer as the
+  live panogram). Either way this thread keeps its own clock: every few ms it
+  works out which frame the playhead has reached and folds every frame
+  since the last tick into the triple buffer's write slot (peak hold, see
+  LocalizationSnapshot). That slot is only published once the display has
+  taken the previous one, so at any speed every frame ends up in some
+  repaint, and the display has no say in the pacing. Each publish triggers
+  the frame listener, if there is one.
+
+  note:
+  - if analysing audio can't keep up with the speed, frames are skipped
+    and counted (getNumFramesSkipped); recordings always keep up
+  - a seek drops whatever was folded so far and marks the next snapshot
+    afterSeek, so the display's tracker starts again
+  - open(), close() and the getFrames() consumer are message thread only
+
+ */
+
+class ReplayThread : public Thread,
+                     private LocalizationSink
+{
+public:
+    enum { maxSpeed = 50 };
+
+    ReplayThread() : Thread ("Panogram replay") {}
+
+    ~ReplayThread()
+    {
+        close();
+    }
+
+    /* Loads a .pnlr recording, or an audio file with at least 9 channels to
+       analyse with the given fft size and hop, over the 3x3 grid or the given
+       array geometry, from levels or with useTdoa from time differences.
+       Starts paused at the beginning. */
+    bool open (const File& file, AudioFormatManager& formatManager, int fftOrder, int hopSize,
+               const ArrayGeometry* geometry = nullptr, bool useTdoa = false)
+    {
+        close();
+
+        int numBins;
+
+        if (file.hasFileExtension ("pnlr"))
+        {
+            if (! recording.open (file.getFullPathName().toStdString()))
+                return false;
+
+            const LocalizationRecordingInfo& info = recording.getInfo();
+            numBins = info.numBins;
+            framesPerSecond = info.sampleRate / info.hopSize;
+            firstFrame = recording.getFirstFrame();
+            endFrame = recording.getEndFrame();
+        }
+        else
+        {
+            AudioFormatReader* reader = formatManager.createReaderFor (file);
+            if (reader == nullptr)
+                return false;
+
+            audio = new AudioFileSource (reader);
+
+            const int channelsNeeded = (geometry != nullptr) ? geometry->getNumChannelsNeeded() : 9;
+
+            if (audio->getNumChannels() < channelsNeeded)
+            {
+                audio = nullptr;
+                return false;
+            }
+
+            AnalysisSettings settings;
+            settings.fftOrder = fftOrder;
+            settings.hopSize = hopSize;
+            settings.mode = GridLocalizer::grid;
+
+            if (geometry != nullptr)
+            {
+                settings.mode = GeometryLocalizer::geometry;
+                settings.geometry = *geometry;
+            }
+
+            if (useTdoa)
+                settings.mode = TdoaLocalizer::tdoa;
+
+            analyser = new OfflineAnalyser (settings, audio->getNumChannels());
+            numBins = analyser->getNumBins();
+            framesPerSecond = audio->getSampleRate() / hopSize;
+            firstFrame = 0;
+            endFrame = OfflineAnalyser::getNumFrames (audio->getLengthInSamples(), 1 << fftOrder, hopSize);
+        }
+
+        frames.allocate (numBins);
+
+        nextFrame = firstFrame;
+        position = firstFrame / framesPerSecond;
+        seekRequest = -1.0;
+        playing = 0;
+        numFramesSkipped = 0;
+
+        startThread (6);
+        return true;
+    }
+
+    void close()
+    {
+        stopThread (1000);
+
+        recording.close();
+        analyser = nullptr;
+        audio = nullptr;
+        firstFrame = endFrame = 0;
+    }
+
+    bool isOpen() const                             { return endFrame > firstFrame; }
+
+    /* Triggered from this thread whenever a frame is published; nullptr
+       for none. Only while closed. */
+    void setFrameListener (AsyncUpdater* listener)
+    {
+        jassert (! isThreadRunning());
+        frameListener = listener;
+    }
+
+    //==========================================================================
+
+    void setPlaying (bool shouldPlay)               { playing = shouldPlay ? 1 : 0; }
+    bool isPlaying() const                          { return playing.get() != 0; }
+
+    /* 1 = real time, up to maxSpeed. */
+    void setSpeed (double newSpeed)                 { speed = jlimit (1.0, (double) maxSpeed, newSpeed); }
+
+    /* Jumps the playhead, from any thread. */
+    void setPosition (double seconds)               { seekRequest = jmax (0.0, seconds); }
+
+    double getPosition() const                      { return position.get(); }
+    double getLengthInSeconds() const               { return isOpen() ? endFrame / framesPerSecond : 0.0; }
+
+    int getNumFramesSkipped() const                 { return numFramesSkipped.get(); }
+
+    /* Peak-held frames for the display. */
+    LocalizationTripleBuffer& getFrames()           { return frames; }
+
+private:
+    enum
+    {
+        tickMs = 4,
+        maxLagMs = 250     // analysis further behind than this skips ahead
+    };
+
+    void run() override
+    {
+        double lastTick = Time::getMillisecondCounterHiRes();
+
+        while (! threadShouldExit())
+        {
+            const double now = Time::getMillisecondCounterHiRes();
+            const double elapsedSeconds = (now - lastTick) / 1000.0;
+            lastTick = now;
+
+            const double seekTo = seekRequest.exchange (-1.0);
+            if (seekTo >= 0.0)
+            {
+                nextFrame = jlimit (firstFrame, endFrame, (int64) (seekTo * framesPerSecond));
+                position = nextFrame / framesPerSecond;
+
+                // frames from before the seek don't get folded into the ones after it
+                LocalizationSnapshot& snapshot = frames.getWriteBuffer();
+                snapshot.clear();
+                snapshot.afterSeek = true;
+            }
+            else if (isPlaying())
+            {
+                position = jmin (position.get() + elapsedSeconds * speed.get(), endFrame / framesPerSecond);
+            }
+
+            const int64 targetFrame = jmin (endFrame, (int64) (position.get() * framesPerSecond) + 1);
+            catchUp (targetFrame, now);
+
+            publishIfTaken();
+
+            if (isPlaying() && nextFrame >= endFrame)
+                playing = 0;
+
+            wait (tickMs);
+        }
+    }
+
+    /* Folds every frame up to targetFrame into the write slot. */
+    void catchUp (int64 targetFrame, double tickStart)
+    {
+        while (nextFrame < targetFrame && ! threadShouldExit())
+        {
+            if (analyser != nullptr && Time::getMillisecondCounterHiRes() - tickStart > maxLagMs)
+            {
+                // analysis is behind the playhead by too much: jump, don't drift
+                numFramesSkipped += (int) (targetFrame - 1 - nextFrame);
+                nextFrame = targetFrame - 1;
+            }
+
+            const int64 numFrames = jmin ((int64) 8, targetFrame - nextFrame);
+
+            if (analyser != nullptr)
+            {
+                analyser->analyse (*audio, *this, nextFrame, numFrames);
+            }
+            else
+            {
+                for (int64 i = 0; i < numFrames; i++)
+                {
+                    LocalizationFrame frame;
+                    if (recording.readFrame (nextFrame + i, frame))
+                        frameReady (nextFrame + i, frame);
+                }
+            }
+
+            nextFrame += numFrames;
+        }
+    }
+
+    void frameReady (int64_t frameIndex, const LocalizationFrame& frame) override
+    {
+        LocalizationSnapshot& snapshot = frames.getWriteBuffer();
+
+        snapshot.add (frame);
+        snapshot.time = frameIndex / framesPerSecond;
+    }
+
+    void publishIfTaken()
+    {
+        LocalizationSnapshot& snapshot = frames.getWriteBuffer();
+
+        // keep folding frames in until the display has had the last lot
+        if (snapshot.numFramesAggregated == 0 || frames.isPublishedUnread())
+            return;
+
+        snapshot.sequence = ++lastSequence;
+        frames.publish();
+        frames.getWriteBuffer().clear();
+
+        if (frameListener != nullptr)
+            frameListener->triggerAsyncUpdate();
+    }
+
+    LocalizationRecordingReader recording;
+    ScopedPointer<MultichannelSource> audio;
+    ScopedPointer<OfflineAnalyser> analyser;
+
+    double framesPerSecond = 1.0;
+    int64 firstFrame = 0;
+    int64 endFrame = 0;
+    int64 nextFrame = 0;
+
+    Atomic<double> position { 0.0 };
+    Atomic<double> seekRequest { -1.0 };
+    Atomic<double> speed { 1.0 };
+    Atomic<int> playing;
+    Atomic<int> numFramesSkipped;
+
+    LocalizationTripleBuffer frames;
+    uint64 lastSequence = 0;
+    AsyncUpdater* frameListener = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReplayThread)
+};
+
+#endif  // REPLAYTHREAD_H_INCLUDED
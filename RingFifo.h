@@ -0,0 +1,119 @@
+#ifndef RINGFIFO_H_INCLUDED
+#define RINGFIFO_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "AlignedBuffer.h"
+
+//----------------------------------------------------------------------------//
+
+/* Ring Buffer to store audio data for STFT processing, every channel at once.
+   All channels are written and read together, so one AbstractFifo does for
+   all of them and they can never slip against each other. The samples live
+   in memory someone else owns (see setStorage), channel after channel.
+   Make the capacity at least 2x the largest fft. */
+
+class RingFifo
+{
+public:
+    RingFifo() : abstractFifo (1)
+    {
+    }
+
+    /* A capacity of at least numSamples that keeps every channel on its own
+       cache lines. */
+    static int getCapacityFor (int numSamples)
+    {
+        const int floatsPerLine = AlignedBuffer<float>::alignment / (int) sizeof (float);
+        return (numSamples + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    }
+
+    /* Uses numChannels x capacity floats at data, channel c starting at
+       data + c * capacity, and empties the fifo. data should be aligned and
+       capacity come from getCapacityFor(), so no channel starts mid cache
+       line. Not while anyone is reading or writing. */
+    void setStorage (float* data, int numChannelsToUse, int capacity)
+    {
+        jassert (((uintptr_t) data % AlignedBuffer<float>::alignment) == 0);
+        jassert (capacity == getCapacityFor (capacity));
+
+        storage = data;
+        numChannels = data != nullptr ? numChannelsToUse : 0;
+        channelSize = capacity;
+
+        abstractFifo.setTotalSize (data != nullptr ? capacity : 1);
+        abstractFifo.reset();
+    }
+
+    int getNumChannels() const          { return numChannels; }
+    int getFreeSpace() const            { return abstractFifo.getFreeSpace(); }
+    int getNumReady() const             { return abstractFifo.getNumReady(); }
+
+    /* Appends numItems to every channel, reading from startSample on; channels
+       the buffer doesn't have get silence. Check getFreeSpace() first. */
+    void addToFifo (const AudioSampleBuffer& buffer, int startSample, int numItems)
+    {
+        const int numInputs = jmin (numChannels, buffer.getNumChannels());
+
+        int start1, size1, start2, size2;
+        abstractFifo.prepareToWrite (numItems, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            float* channel = getChannel (ch);
+
+            if (ch < numInputs)
+            {
+                const float* someData = buffer.getReadPointer (ch, startSample);
+
+                if (size1 > 0)
+                    memcpy (channel + start1, someData, size1 * sizeof(float));
+                if (size2 > 0)
+                    memcpy (channel + start2, someData + size1, size2 * sizeof(float));
+            }
+            else
+            {
+                if (size1 > 0)
+                    zeromem (channel + start1, size1 * sizeof(float));
+                if (size2 > 0)
+                    zeromem (channel + start2, size2 * sizeof(float));
+            }
+        }
+
+        abstractFifo.finishedWrite (size1 + size2);
+    }
+
+    /* Copies out the oldest numItems of one channel without consuming them
+       (for overlapping frames). */
+    void peekFromFifo (int channel, float* someData, int numItems) const
+    {
+        const float* source = getChannel (channel);
+
+        int start1, size1, start2, size2;
+        abstractFifo.prepareToRead (numItems, start1, size1, start2, size2);
+        if (size1 > 0)
+            memcpy (someData, source + start1, size1 * sizeof(float));
+        if (size2 > 0)
+            memcpy (someData + size1, source + start2, size2 * sizeof(float));
+    }
+
+    /* Consumes numItems on every channel without copying them anywhere (the
+       hop after the peeks). */
+    void discardFromFifo (int numItems)
+    {
+        int start1, size1, start2, size2;
+        abstractFifo.prepareToRead (numItems, start1, size1, start2, size2);
+        abstractFifo.finishedRead (size1 + size2);
+    }
+
+private:
+    float* getChannel (int channel) const   { return storage + (size_t) channel * channelSize; }
+
+    AbstractFifo abstractFifo;
+    float* storage = nullptr;
+    int numChannels = 0;
+    int channelSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (RingFifo)
+};
+
+#endif  // RINGFIFO_H_INCLUDED
@@ -0,0 +1,317 @@
+#include "SourceTracker.h"
+
+#include <cmath>
+
+//----------------------------------------------------------------------------//
+
+static void smoothBinsKernel (const float* __restrict x, const float* __restrict y, const float* __restrict gain,
+                              float* __restrict weightSum, float* __restrict xSum, float* __restrict ySum,
+                              float* __restrict xOut, float* __restrict yOut, float* __restrict gainOut,
+                              float* __restrict radiusSquared, float keep, int n)
+{
+    const float add = 1.0f - keep;
+    const float tiny = 1.0e-6f;
+
+    for (int i = 0; i < n; i++)
+    {
+        const float g = gain[i];
+        const float w = 0.5f * (g + std::fabs (g));     // dB above 0, 0 below
+
+        const float ws = keep * weightSum[i] + add * w;
+        const float xs = keep * xSum[i] + add * w * x[i];
+        const float ys = keep * ySum[i] + add * w * y[i];
+
+        weightSum[i] = ws;
+        xSum[i] = xs;
+        ySum[i] = ys;
+
+        // a bin that has never been heard sits in the middle
+        const float inv = 1.0f / (ws + tiny);
+        const float xs2 = (xs + 0.5f * tiny) * inv;
+        const float ys2 = (ys + 0.5f * tiny) * inv;
+
+        xOut[i] = xs2;
+        yOut[i] = ys2;
+        gainOut[i] = keep * gainOut[i] + add * g;
+        radiusSquared[i] = xs2 * xs2 + ys2 * ys2;
+    }
+}
+
+static inline float arithmeticMin (float a, float b)
+{
+    return 0.5f * (a + b - std::fabs (a - b));
+}
+
+/* Memberships of every bin in the 4 tracks (1 / d^2, normalised, squared,
+   times the bin's weight) and its weight far from all of them. */
+static void assignKernel (const float* __restrict x, const float* __restrict y, const float* __restrict w,
+                          const float* centreX, const float* centreY, float radiusSquared, float distanceFloor,
+                          float* __restrict m0, float* __restrict m1, float* __restrict m2, float* __restrict m3,
+                          float* __restrict birth, int n)
+{
+    const float x0 = centreX[0], x1 = centreX[1], x2 = centreX[2], x3 = centreX[3];
+    const float y0 = centreY[0], y1 = centreY[1], y2 = centreY[2], y3 = centreY[3];
+
+    for (int i = 0; i < n; i++)
+    {
+        const float d0 = (x[i] - x0) * (x[i] - x0) + (y[i] - y0) * (y[i] - y0) + distanceFloor;
+        const float d1 = (x[i] - x1) * (x[i] - x1) + (y[i] - y1) * (y[i] - y1) + distanceFloor;
+        const float d2 = (x[i] - x2) * (x[i] - x2) + (y[i] - y2) * (y[i] - y2) + distanceFloor;
+        const float d3 = (x[i] - x3) * (x[i] - x3) + (y[i] - y3) * (y[i] - y3) + distanceFloor;
+
+        const float i0 = 1.0f / d0, i1 = 1.0f / d1, i2 = 1.0f / d2, i3 = 1.0f / d3;
+        const float norm = 1.0f / (i0 + i1 + i2 + i3);
+        const float r0 = i0 * norm, r1 = i1 * norm, r2 = i2 * norm, r3 = i3 * norm;
+
+        m0[i] = r0 * r0 * w[i];
+        m1[i] = r1 * r1 * w[i];
+        m2[i] = r2 * r2 * w[i];
+        m3[i] = r3 * r3 * w[i];
+
+        // (d / (d + radius^2))^4 is ~0 near a track and ~1 well away from all of them
+        const float nearest = arithmeticMin (arithmeticMin (d0, d1), arithmeticMin (d2, d3));
+        const float q = nearest / (nearest + radiusSquared);
+        const float q2 = q * q;
+
+        birth[i] = w[i] * q2 * q2;
+    }
+}
+
+/* Dot product 8 lanes at a time, so it vectorises without -ffast-math. */
+static float dot (const float* __restrict a, const float* __restrict b, int n)
+{
+    float lanes[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+        for (int j = 0; j < 8; j++)
+            lanes[j] += a[i + j] * b[i + j];
+
+    float sum = 0.0f;
+    for (; i < n; i++)
+        sum += a[i] * b[i];
+
+    for (int j = 0; j < 8; j++)
+        sum += lanes[j];
+
+    return sum;
+}
+
+static float sum (const float* __restrict a, int n)
+{
+    float lanes[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+        for (int j = 0; j < 8; j++)
+            lanes[j] += a[i + j];
+
+    float total = 0.0f;
+    for (; i < n; i++)
+        total += a[i];
+
+    for (int j = 0; j < 8; j++)
+        total += lanes[j];
+
+    return total;
+}
+
+//----------------------------------------------------------------------------//
+
+void SourceTracker::prepare (int newNumBins)
+{
+    numBins = newNumBins;
+
+    weightSum.allocate (numBins);
+    xSum.allocate (numBins);
+    ySum.allocate (numBins);
+    xData.allocate (numBins);
+    yData.allocate (numBins);
+    gainData.allocate (numBins);
+
+    membership.allocate ((size_t) (maxSources + 1) * numBins);
+    radiusSquared.allocate (numBins);
+
+    reset();
+}
+
+void SourceTracker::reset()
+{
+    weightSum.clear();
+    xSum.clear();
+    ySum.clear();
+    gainData.clear();
+
+    for (int i = 0; i < numBins; i++)
+        xData[i] = yData[i] = 0.5f;
+
+    for (int k = 0; k < maxSources; k++)
+        sources[k] = TrackedSource();
+}
+
+int SourceTracker::getNumActiveSources() const
+{
+    int count = 0;
+
+    for (int k = 0; k < maxSources; k++)
+        if (sources[k].id != 0)
+            count++;
+
+    return count;
+}
+
+void SourceTracker::process (const LocalizationFrame& frame)
+{
+    if (frame.numBins != numBins)
+        prepare (frame.numBins);
+
+    smoothBins (frame);
+    assignBins();
+    updateSources();
+}
+
+//----------------------------------------------------------------------------//
+
+void SourceTracker::smoothBins (const LocalizationFrame& frame)
+{
+    smoothBinsKernel (frame.x, frame.y, frame.gain, weightSum, xSum, ySum,
+                      xData, yData, gainData, radiusSquared, binSmoothing, numBins);
+}
+
+void SourceTracker::assignBins()
+{
+    static_assert (maxSources == 4, "assignKernel is unrolled for 4 tracks");
+
+    // free slots sit far outside the panogram, so they attract nothing
+    float centreX[maxSources], centreY[maxSources];
+
+    for (int k = 0; k < maxSources; k++)
+    {
+        centreX[k] = sources[k].id != 0 ? sources[k].x : 100.0f;
+        centreY[k] = sources[k].id != 0 ? sources[k].y : 100.0f;
+    }
+
+    float* rows[maxSources + 1];
+    for (int k = 0; k <= maxSources; k++)
+        rows[k] = membership + (size_t) k * numBins;
+
+    assignKernel (xData, yData, weightSum, centreX, centreY, radius * radius, 1.0e-4f,
+                  rows[0], rows[1], rows[2], rows[3], rows[maxSources], numBins);
+
+    totalWeight = sum (weightSum, numBins);
+
+    for (int k = 0; k < maxSources; k++)
+    {
+        sourceSums[k][0] = sum (rows[k], numBins);
+        sourceSums[k][1] = dot (rows[k], xData, numBins);
+        sourceSums[k][2] = dot (rows[k], yData, numBins);
+        sourceSums[k][3] = dot (rows[k], radiusSquared, numBins);
+    }
+
+    birthWeight = sum (rows[maxSources], numBins);
+}
+
+void SourceTracker::updateSources()
+{
+    const float step = 1.0f - sourceSmoothing;
+    const float minWeight = 1.0e-3f;
+
+    for (int k = 0; k < maxSources; k++)
+    {
+        TrackedSource& source = sources[k];
+        if (source.id == 0)
+            continue;
+
+        const float w = sourceSums[k][0];
+        const float share = totalWeight > minWeight ? w / totalWeight : 0.0f;
+
+        if (w > minWeight)
+        {
+            const float meanX = sourceSums[k][1] / w;
+            const float meanY = sourceSums[k][2] / w;
+            const float variance = sourceSums[k][3] / w - meanX * meanX - meanY * meanY;
+
+            source.x += step * (meanX - source.x);
+            source.y += step * (meanY - source.y);
+            source.spread += step * (std::sqrt (std::fmax (0.0f, variance)) - source.spread);
+        }
+
+        source.share += step * (share - source.share);
+
+        const float relativeSpread = source.spread / radius;
+        source.confidence = source.share / (1.0f + relativeSpread * relativeSpread);
+
+        if (source.confidence < 0.05f)
+            source = TrackedSource();
+    }
+
+    // two tracks on the same source: keep the surer one
+    for (int a = 0; a < maxSources; a++)
+    {
+        for (int b = a + 1; b < maxSources; b++)
+        {
+            TrackedSource& first = sources[a];
+            TrackedSource& second = sources[b];
+
+            if (first.id == 0 || second.id == 0)
+                continue;
+
+            const float dx = first.x - second.x, dy = first.y - second.y;
+
+            if (dx * dx + dy * dy < 0.25f * radius * radius)
+            {
+                TrackedSource& weaker = first.confidence < second.confidence ? first : second;
+                TrackedSource& stronger = first.confidence < second.confidence ? second : first;
+
+                stronger.share += weaker.share;
+                weaker = TrackedSource();
+            }
+        }
+    }
+
+    // enough weight away from every track starts a new one
+    if (totalWeight > minWeight && birthWeight > 0.25f * totalWeight)
+    {
+        for (int k = 0; k < maxSources; k++)
+        {
+            if (sources[k].id == 0)
+            {
+                startSource (sources[k]);
+                break;
+            }
+        }
+    }
+}
+
+void SourceTracker::startSource (TrackedSource& source)
+{
+    // around the heaviest untracked bin, not the centroid of all of them:
+    // two new sources at once would put it halfway between
+    const float* birth = membership + (size_t) maxSources * numBins;
+    int peak = 0;
+
+    for (int i = 1; i < numBins; i++)
+        if (birth[i] > birth[peak])
+            peak = i;
+
+    float w = 0.0f, x = 0.0f, y = 0.0f;
+
+    for (int i = 0; i < numBins; i++)
+    {
+        const float dx = xData[i] - xData[peak], dy = yData[i] - yData[peak];
+
+        if (dx * dx + dy * dy < radius * radius)
+        {
+            w += birth[i];
+            x += birth[i] * xData[i];
+            y += birth[i] * yData[i];
+        }
+    }
+
+    source.id = nextId++;
+    source.x = x / w;
+    source.y = y / w;
+    source.share = w / totalWeight;
+    source.spread = 0.0f;
+    source.confidence = source.share;
+}
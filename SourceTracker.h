@@ -0,0 +1,121 @@
+#ifndef SOURCETRACKER_H_INCLUDED
+#define SOURCETRACKER_H_INCLUDED
+
+#include "AlignedBuffer.h"
+#include "QuadLocalizer.h"
+
+//----------------------------------------------------------------------------//
+
+/* One tracked source, in panogram coordinates. */
+
+struct TrackedSource
+{
+    int id = 0;                 // the same for as long as the source is tracked, 0 = free slot
+    float x = 0.5f;
+    float y = 0.5f;
+    float confidence = 0.0f;    // 0..1, see SourceTracker
+    float share = 0.0f;         // smoothed fraction of the frame's weight it owns
+    float spread = 0.0f;        // rms distance of its bins from it
+};
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Sits between a localizer and the panogram: smooths every bin over time,
+  then groups the bins into a few tracked sources.
+
+  Bins: each bin's weight is its gain in dB above 0 (what the rasterizer
+  draws as alpha). x and y are averaged recursively, weighted by it, so a
+  quiet frame doesn't drag a bin's position anywhere:
+      w' = a w' + (1 - a) w,   x' = (a (w' x')_prev + (1 - a) w x) / w'
+  gain is averaged plainly.
+
+  Sources: one fuzzy c-means step per frame (memberships 1 / distance^2,
+  normalised over the tracks), starting from where the tracks were last
+  frame, which is what makes it tracking rather than clustering. Each
+  track then moves a smoothed step towards the weighted centroid of its
+  bins. Enough weight far from every track (a quarter of the frame) starts
+  a new one around the heaviest of it; tracks that come within half a
+  radius of each other merge; a track whose confidence drops under 0.05
+  is freed.
+
+  confidence = smoothed share of the frame's weight * compactness, where
+  compactness = 1 / (1 + (spread / radius)^2). One tight source owning
+  everything heads for 1; two equal ones for 0.5 each; a track holding
+  scattered noise stays low.
+
+  Both passes over the bins are straight loops with the tracks unrolled
+  (distances, memberships and the min distance are arithmetic, no
+  branches), and the sums are taken 8 lanes at a time, so everything
+  vectorises. prepare() allocates; process() never does.
+
+ */
+
+class SourceTracker
+{
+public:
+    enum { maxSources = 4 };
+
+    SourceTracker() {}
+
+    /* Allocates and resets. */
+    void prepare (int numBins);
+    int getNumBins() const                          { return numBins; }
+
+    /* Forgets all history. */
+    void reset();
+
+    /* How much of the previous frame is kept, 0 (none) .. <1. */
+    void setBinSmoothing (float newSmoothing)       { binSmoothing = newSmoothing; }
+    void setSourceSmoothing (float newSmoothing)    { sourceSmoothing = newSmoothing; }
+
+    /* Bins closer than this (in panogram units) belong together. */
+    void setRadius (float newRadius)                { radius = newRadius; }
+
+    /* Re-prepares if the bin count changed. */
+    void process (const LocalizationFrame& frame);
+
+    /* The smoothed bins; gainY is gain. */
+    LocalizationFrame getFrame() const
+    {
+        LocalizationFrame frame = { numBins, xData, yData, gainData, gainData };
+        return frame;
+    }
+
+    /* maxSources slots; free ones have id 0. */
+    const TrackedSource& getSource (int slot) const { return sources[slot]; }
+    int getNumActiveSources() const;
+
+private:
+    void smoothBins (const LocalizationFrame& frame);
+    void assignBins();
+    void updateSources();
+    void startSource (TrackedSource& source);
+
+    int numBins = 0;
+
+    float binSmoothing = 0.8f;
+    float sourceSmoothing = 0.9f;
+    float radius = 0.15f;
+
+    AlignedBuffer<float> weightSum;     // [bin], smoothed weight
+    AlignedBuffer<float> xSum, ySum;    // [bin], smoothed weight * position
+    AlignedBuffer<float> xData, yData, gainData;
+
+    AlignedBuffer<float> membership;    // [maxSources + 1][bin], the last row for births
+    AlignedBuffer<float> radiusSquared; // [bin], x^2 + y^2
+
+    TrackedSource sources[maxSources];
+    int nextId = 1;
+
+    // sums of the current frame, per source: weight, x, y, x^2 + y^2
+    float sourceSums[maxSources][4];
+    float birthWeight = 0.0f;
+    float totalWeight = 0.0f;
+
+    SourceTracker (const SourceTracker&);
+    SourceTracker& operator= (const SourceTracker&);
+};
+
+#endif  // SOURCETRACKER_H_INCLUDED
@@ -0,0 +1,67 @@
+#ifndef SPECTRUMFRAME_H_INCLUDED
+#define SPECTRUMFRAME_H_INCLUDED
+
+#include "AlignedBuffer.h"
+#include "TripleBuffer.h"
+
+#include <cstdint>
+
+//----------------------------------------------------------------------------//
+
+/* One analysed frame: magnitudes for every channel, plus which frame it was,
+   and optionally the complex bins they came from (for TdoaLocalizer). */
+
+struct SpectrumFrame
+{
+    void allocate (int numChannelsToUse, int numBinsToUse, bool withSpectrum = false)
+    {
+        numChannels = numChannelsToUse;
+        numBins = numBinsToUse;
+        sequence = 0;
+        magnitudes.allocate (numChannels * numBins);
+
+        if (withSpectrum)
+        {
+            real.allocate (numChannels * numBins);
+            imag.allocate (numChannels * numBins);
+        }
+        else
+        {
+            real.free();
+            imag.free();
+        }
+    }
+
+    const float* getChannel (int channel) const     { return magnitudes.get() + channel * numBins; }
+    float* getChannel (int channel)                 { return magnitudes.get() + channel * numBins; }
+
+    bool hasSpectrum() const                        { return real.get() != nullptr; }
+    const float* getReal (int channel) const        { return real.get() + channel * numBins; }
+    const float* getImag (int channel) const        { return imag.get() + channel * numBins; }
+    float* getReal (int channel)                    { return real.get() + channel * numBins; }
+    float* getImag (int channel)                    { return imag.get() + channel * numBins; }
+
+    uint64_t sequence = 0;   // 0 = nothing analysed yet, then 1, 2, 3...
+    int numChannels = 0;
+    int numBins = 0;
+    AlignedBuffer<float> magnitudes;   // [numChannels][numBins]
+    AlignedBuffer<float> real, imag;   // [numChannels][numBins], empty unless allocated withSpectrum
+};
+
+//----------------------------------------------------------------------------//
+
+/* Analysis thread -> display handoff. */
+
+class SpectrumTripleBuffer : public TripleBuffer<SpectrumFrame>
+{
+public:
+    void allocate (int numChannels, int numBins, bool withSpectrum = false)
+    {
+        for (int i = 0; i < numBuffers; i++)
+            getBuffer (i).allocate (numChannels, numBins, withSpectrum);
+
+        reset();
+    }
+};
+
+#endif  // SPECTRUMFRAME_H_INCLUDED
@@ -0,0 +1,358 @@
+#include "TdoaLocalizer.h"
+#include "DSPKernels.h"
+#include "MultichannelSTFT.h"
+
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------//
+
+/* X_a conj (X_b), scaled to unit magnitude (the PHAT weighting). */
+
+static void whitenPair (const float* __restrict aRe, const float* __restrict aIm,
+                        const float* __restrict bRe, const float* __restrict bIm,
+                        float* __restrict outRe, float* __restrict outIm, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const float re = aRe[i] * bRe[i] + aIm[i] * bIm[i];
+        const float im = aIm[i] * bRe[i] - aRe[i] * bIm[i];
+        const float inv = 1.0f / std::sqrt (re * re + im * im + 1.0e-30f);
+
+        outRe[i] = re * inv;
+        outIm[i] = im * inv;
+    }
+}
+
+/* Adds one pair's phase residual to the per-bin least squares sums: the
+   cross spectrum's phase, less the phase the broadband delay predicts,
+   wrapped to -pi..pi. The angle comes from the half-angle formulas (the
+   input has unit magnitude) and a 9th order atan on tan(phase / 4), which
+   stays inside -1..1; all arithmetic, so the loop vectorises. */
+
+static void addPairResidual (const float* __restrict re, const float* __restrict im,
+                             const float* __restrict omega, float delay, float weightX, float weightY,
+                             float* __restrict residualX, float* __restrict residualY, int n)
+{
+    const float twoPi = 6.28318531f;
+    const float inverseTwoPi = 1.0f / twoPi;
+
+    for (int i = 0; i < n; i++)
+    {
+        const float c = re[i];
+        const float cosHalf = std::sqrt (std::fabs (0.5f * (1.0f + c)));
+        const float sinHalf = std::copysign (std::sqrt (std::fabs (0.5f * (1.0f - c))), im[i]);
+        const float t = sinHalf / (1.0f + cosHalf);
+        const float t2 = t * t;
+
+        // Abramowitz & Stegun 4.4.49, |error| < 1e-5 on -1..1
+        const float phase = 4.0f * t * (0.9998660f + t2 * (-0.3302995f + t2 * (0.1801410f
+                                      + t2 * (-0.0851330f + t2 * 0.0208351f))));
+
+        // X_i conj (X_j) turns by -omega * delay for a delay of i behind j
+        float d = phase + omega[i] * delay;
+        d -= twoPi * (float) (int) (d * inverseTwoPi + std::copysign (0.5f, d));
+
+        residualX[i] += weightX * d;
+        residualY[i] += weightY * d;
+    }
+}
+
+static void finishBins (const float* __restrict residualX, const float* __restrict residualY,
+                        const float* __restrict inverseOmega, float directionX, float directionY,
+                        float* __restrict x, float* __restrict y, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const float ux = directionX - residualX[i] * inverseOmega[i];
+        const float uy = directionY - residualY[i] * inverseOmega[i];
+
+        // -1..1 -> 0..1, clamped without a branch
+        x[i] = 0.5f + 0.25f * (std::fabs (ux + 1.0f) - std::fabs (ux - 1.0f));
+        y[i] = 0.5f + 0.25f * (std::fabs (uy + 1.0f) - std::fabs (uy - 1.0f));
+    }
+}
+
+static void sumLevels (const float* __restrict magnitudes, float* __restrict level, int n)
+{
+    for (int i = 0; i < n; i++)
+        level[i] += magnitudes[i];
+}
+
+//----------------------------------------------------------------------------//
+
+void TdoaLocalizer::prepare (const ArrayGeometry& geometryToUse, int fftOrder, double newSampleRate)
+{
+    const int simdWidth = 8;
+    const double twoPi = 6.283185307179586;
+
+    arrayGeometry = geometryToUse;
+
+    // a mic on a channel no frame can carry would leave a hole in every pair it's in
+    arrayGeometry.mics.erase (std::remove_if (arrayGeometry.mics.begin(), arrayGeometry.mics.end(),
+                                              [] (const ArrayMic& mic) { return mic.channel < 0 || mic.channel >= maxChannels; }),
+                              arrayGeometry.mics.end());
+
+    fftSize = 1 << fftOrder;
+    numBins = fftSize / 2;
+    sampleRate = newSampleRate;
+    numMics = (int) arrayGeometry.mics.size();
+    numPairs = numMics * (numMics - 1) / 2;
+    stride = (numPairs + simdWidth - 1) / simdWidth * simdWidth;
+
+    channels.clear();
+    pairFirst.clear();
+    pairSecond.clear();
+    numChannelsNeeded = 0;
+
+    for (const ArrayMic& mic : arrayGeometry.mics)
+    {
+        channels.push_back (mic.channel);
+
+        if (mic.channel >= numChannelsNeeded)
+            numChannelsNeeded = mic.channel + 1;
+    }
+
+    for (int i = 0; i < numMics; i++)
+    {
+        for (int j = i + 1; j < numMics; j++)
+        {
+            pairFirst.push_back (i);
+            pairSecond.push_back (j);
+        }
+    }
+
+    // delay_ij = a_ij . u samples, a_ij = (m_j - m_i) * fs / c; u = (A'A)^-1 A' delay
+    const double samplesPerUnit = arrayGeometry.unitMetres * sampleRate / speedOfSound;
+    std::vector<double> ax (numPairs), ay (numPairs);
+    double sxx = 0.0, sxy = 0.0, syy = 0.0, longest = 0.0;
+
+    for (int p = 0; p < numPairs; p++)
+    {
+        const ArrayMic& a = arrayGeometry.mics[pairFirst[p]];
+        const ArrayMic& b = arrayGeometry.mics[pairSecond[p]];
+
+        ax[p] = (b.x - a.x) * samplesPerUnit;
+        ay[p] = (b.y - a.y) * samplesPerUnit;
+        sxx += ax[p] * ax[p];
+        sxy += ax[p] * ay[p];
+        syy += ay[p] * ay[p];
+        longest = std::fmax (longest, std::sqrt (ax[p] * ax[p] + ay[p] * ay[p]));
+    }
+
+    // a line array only sees one axis; the ridge keeps the other at 0
+    const double ridge = 1.0e-6 * (sxx + syy) + 1.0e-30;
+    sxx += ridge;
+    syy += ridge;
+    const double det = sxx * syy - sxy * sxy;
+
+    solveX.allocate (numPairs);
+    solveY.allocate (numPairs);
+
+    for (int p = 0; p < numPairs; p++)
+    {
+        solveX[p] = (float) ((syy * ax[p] - sxy * ay[p]) / det);
+        solveY[p] = (float) ((sxx * ay[p] - sxy * ax[p]) / det);
+    }
+
+    maxLag = (int) std::ceil (longest) + 1;
+    if (maxLag > numBins - 1)
+        maxLag = numBins - 1;
+
+    crossRe.allocate ((size_t) numPairs * numBins);
+    crossIm.allocate ((size_t) numPairs * numBins);
+    workRe.allocate ((size_t) numBins * stride);
+    workIm.allocate ((size_t) numBins * stride);
+
+    // the inverse real FFT runs as a packed complex FFT of half the size
+    MultichannelSTFT::makeFFTTables (fftOrder - 1, twiddleRe, twiddleIm, bitReversed);
+
+    // e^(+2 pi i k / fftSize) for packing, and each bin's frequency
+    unpackRe.allocate (numBins);
+    unpackIm.allocate (numBins);
+    binOmega.allocate (numBins);
+    binInverseOmega.allocate (numBins);
+
+    for (int k = 0; k < numBins; k++)
+    {
+        unpackRe[k] = (float) std::cos (twoPi * k / fftSize);
+        unpackIm[k] = (float) std::sin (twoPi * k / fftSize);
+        binOmega[k] = (float) (twoPi * k / fftSize);
+        binInverseOmega[k] = k > 0 ? 1.0f / binOmega[k] : 0.0f;     // DC keeps the broadband direction
+    }
+
+    pairDelays.allocate (numPairs);
+    directionX = directionY = 0.0f;
+
+    residualX.allocate (numBins);
+    residualY.allocate (numBins);
+    xData.allocate (numBins);
+    yData.allocate (numBins);
+    gainData.allocate (numBins);
+}
+
+void TdoaLocalizer::process (const SpectrumFrame& frame)
+{
+    if (! frame.hasSpectrum())
+        return;
+
+    if (frame.numBins != numBins)
+    {
+        int fftOrder = 1;
+        while ((1 << fftOrder) < 2 * frame.numBins)
+            fftOrder++;
+
+        prepare (arrayGeometry, fftOrder, sampleRate);
+    }
+
+    // every pair takes part in the solve, so a frame short of a mic's channel can't be localized
+    if (frame.numChannels < numChannelsNeeded)
+        return;
+
+    const float* real[maxChannels] = {};
+    const float* imag[maxChannels] = {};
+    const float* magnitudes[maxChannels] = {};
+
+    for (int ch = 0; ch < numChannelsNeeded; ch++)
+    {
+        real[ch] = frame.getReal (ch);
+        imag[ch] = frame.getImag (ch);
+        magnitudes[ch] = frame.getChannel (ch);
+    }
+
+    process (real, imag, magnitudes);
+}
+
+void TdoaLocalizer::process (const float* const* channelReal, const float* const* channelImag,
+                             const float* const* channelMagnitudes)
+{
+    whitenPairs (channelReal, channelImag);
+    correlatePairs();
+    findDelays();
+    localizeBins();
+
+    // level of every mic, two mics' worth, dbscale as QuadLocalizer does
+    gainData.clear();
+
+    for (int c = 0; c < numMics; c++)
+        sumLevels (channelMagnitudes[channels[c]], gainData, numBins);
+
+    const float offset = 1.0000000001f;
+    DSPKernels::multiplyScalar (gainData, 2.0f / numMics, gainData, numBins);
+    DSPKernels::addScalar (gainData, offset, gainData, numBins);
+    DSPKernels::decibels (gainData, zeroReference, gainData, numBins);
+}
+
+//----------------------------------------------------------------------------//
+
+void TdoaLocalizer::whitenPairs (const float* const* channelReal, const float* const* channelImag)
+{
+    for (int p = 0; p < numPairs; p++)
+    {
+        const int a = channels[pairFirst[p]];
+        const int b = channels[pairSecond[p]];
+        float* re = crossRe + (size_t) p * numBins;
+        float* im = crossIm + (size_t) p * numBins;
+
+        whitenPair (channelReal[a], channelImag[a], channelReal[b], channelImag[b], re, im, numBins);
+
+        // DC says nothing about delay
+        re[0] = im[0] = 0.0f;
+    }
+}
+
+void TdoaLocalizer::correlatePairs()
+{
+    const int S = stride;
+    const int half = numBins;
+
+    // G is one sided (bins 0..half-1, the half bin taken as 0). The real
+    // inverse of G is z[m] = r[2m] + i r[2m+1], the inverse of Z = E + iO with
+    //   E[k] = (G[k] + conj G[half-k]) / 2
+    //   O[k] = (G[k] - conj G[half-k]) e^(2 pi i k / fftSize) / 2
+    // and an inverse FFT is conj (FFT (conj Z)). Packed straight into the
+    // pair-interleaved work area, in bit-reversed order.
+    for (int k = 0; k < half; k++)
+    {
+        const int mirror = (half - k) & (half - 1);     // bin 0 for k = 0: zero, like the half bin
+        float* __restrict zr = workRe.get() + bitReversed[k] * S;
+        float* __restrict zi = workIm.get() + bitReversed[k] * S;
+        const float wr = unpackRe[k];
+        const float wi = unpackIm[k];
+
+        for (int p = 0; p < numPairs; p++)
+        {
+            const float gr = crossRe[(size_t) p * half + k];
+            const float gi = crossIm[(size_t) p * half + k];
+            const float mr = crossRe[(size_t) p * half + mirror];
+            const float mi = crossIm[(size_t) p * half + mirror];
+
+            const float er = 0.5f * (gr + mr);
+            const float ei = 0.5f * (gi - mi);
+            const float dr = 0.5f * (gr - mr);
+            const float di = 0.5f * (gi + mi);
+            const float orr = dr * wr - di * wi;
+            const float oi = dr * wi + di * wr;
+
+            zr[p] = er - oi;
+            zi[p] = -(ei + orr);
+        }
+    }
+
+    // every pair through the same butterflies
+    MultichannelSTFT::performComplexFFT (workRe, workIm, half, S, twiddleRe, twiddleIm);
+}
+
+void TdoaLocalizer::findDelays()
+{
+    const int S = stride;
+
+    directionX = directionY = 0.0f;
+
+    for (int p = 0; p < numPairs; p++)
+    {
+        // r[2m] = Re z[m], r[2m+1] = -Im z[m] (z came out conjugated); negative lags wrap
+        float best = -1.0e30f;
+        int bestLag = 0;
+        float values[3] = { 0.0f, 0.0f, 0.0f };
+
+        for (int lag = -maxLag; lag <= maxLag; lag++)
+        {
+            const int n = lag < 0 ? lag + fftSize : lag;
+            const float r = (n & 1) ? -workIm[(n >> 1) * S + p] : workRe[(n >> 1) * S + p];
+
+            if (r > best)
+            {
+                best = r;
+                bestLag = lag;
+            }
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            const int n = (bestLag - 1 + i + fftSize) % fftSize;
+            values[i] = (n & 1) ? -workIm[(n >> 1) * S + p] : workRe[(n >> 1) * S + p];
+        }
+
+        // parabola through the peak and its neighbours
+        const float curvature = values[0] - 2.0f * values[1] + values[2];
+        const float offset = curvature < 0.0f ? 0.5f * (values[0] - values[2]) / curvature : 0.0f;
+        const float delay = bestLag + std::fmax (-0.5f, std::fmin (0.5f, offset));
+
+        pairDelays[p] = delay;
+        directionX += solveX[p] * delay;
+        directionY += solveY[p] * delay;
+    }
+}
+
+void TdoaLocalizer::localizeBins()
+{
+    residualX.clear();
+    residualY.clear();
+
+    for (int p = 0; p < numPairs; p++)
+        addPairResidual (crossRe + (size_t) p * numBins, crossIm + (size_t) p * numBins, binOmega,
+                         pairDelays[p], solveX[p], solveY[p], residualX, residualY, numBins);
+
+    finishBins (residualX, residualY, binInverseOmega, directionX, directionY, xData, yData, numBins);
+}
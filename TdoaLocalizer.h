@@ -0,0 +1,141 @@
+#ifndef TDOALOCALIZER_H_INCLUDED
+#define TDOALOCALIZER_H_INCLUDED
+
+#include "AlignedBuffer.h"
+#include "ArrayGeometry.h"
+#include "QuadLocalizer.h"
+#include "SpectrumFrame.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Localization from time differences of arrival instead of level ratios.
+
+  The level ratio needs the mics to hear different levels, which a closely
+  spaced array barely does at low frequencies. It does hear the sound at
+  different times. Per frame:
+
+  1. GCC-PHAT for every mic pair (36 on the 3x3 array): the cross spectrum
+     X_i conj(X_j), whitened to unit magnitude, one SIMD pass over the bins
+     per pair.
+  2. One inverse real FFT per pair, all pairs batched through the same
+     butterflies (pair-interleaved, like MultichannelSTFT does channels).
+     The peak within the array's largest possible delay, refined by a
+     parabola, is the pair's delay.
+  3. Far-field least squares: delay_ij = (m_j - m_i) . u / c. The pseudo
+     inverse is fixed by the geometry, so u is a 2 x numPairs product.
+  4. Per bin, the phase of each whitened cross spectrum gives the same
+     delay again, modulo one period. Unwrapped around the broadband delay
+     and put through the same least squares, it moves each bin off the
+     broadband direction towards its own, so a second source in other
+     bins still shows up where it is.
+
+  x and y are the direction u seen from the array, mapped from -1..1 onto
+  0..1 with the same orientation as the mic positions (a sound from the
+  side of mic 7 lands where the level modes draw mic 7). gain is the dB
+  level of all mics, scaled to two mics' worth like GridLocalizer.
+
+  note:
+  - needs the complex spectrum: MultichannelSTFT::prepare (..., true)
+  - positions in metres are the geometry's x, y times its unit
+  - far field, so a source close to the array reads as its direction
+  - mode number 4, after GeometryLocalizer's 3
+
+ */
+
+class TdoaLocalizer
+{
+public:
+    enum
+    {
+        tdoa = 4,
+        maxChannels = ArrayGeometry::maxChannels
+    };
+
+    TdoaLocalizer() {}
+
+    /* Sets up the pairs and transforms for a 2^fftOrder fft. Mics on channels
+       above maxChannels are left out. Allocates. */
+    void prepare (const ArrayGeometry& geometryToUse, int fftOrder, double sampleRate);
+
+    int getNumBins() const                      { return numBins; }
+    int getNumPairs() const                     { return numPairs; }
+    int getNumChannelsNeeded() const            { return numChannelsNeeded; }
+    double getSampleRate() const                { return sampleRate; }
+    const ArrayGeometry& getGeometry() const    { return arrayGeometry; }
+
+    /* Channel c's complex spectrum and magnitudes, getNumBins() long each.
+       Every channel getNumChannelsNeeded() covers has to be there. */
+    void process (const float* const* channelReal, const float* const* channelImag,
+                  const float* const* channelMagnitudes);
+
+    /* Re-prepares with the same geometry if the frame's size changed. Frames
+       without a complex spectrum, or with fewer channels than the mics use,
+       are ignored. */
+    void process (const SpectrumFrame& frame);
+
+    LocalizationFrame getFrame() const
+    {
+        LocalizationFrame frame = { numBins, xData, yData, gainData, gainData };
+        return frame;
+    }
+
+    /* The last frame's broadband delay of a pair, in samples, and the
+       direction they add up to (-1..1 each way). */
+    float getPairDelay (int pair) const         { return pairDelays[pair]; }
+    float getDirectionX() const                 { return directionX; }
+    float getDirectionY() const                 { return directionY; }
+
+    float speedOfSound = 343.0f;    // m/s
+    float zeroReference = 1.1f;     // same as QuadLocalizer
+
+private:
+    void whitenPairs (const float* const* channelReal, const float* const* channelImag);
+    void correlatePairs();
+    void findDelays();
+    void localizeBins();
+
+    ArrayGeometry arrayGeometry;
+    int fftSize = 0;
+    int numBins = 0;
+    double sampleRate = 44100.0;
+    int numMics = 0;
+    int numPairs = 0;
+    int numChannelsNeeded = 0;      // highest mic channel + 1
+    int stride = 0;                 // numPairs rounded up to a SIMD register
+    int maxLag = 0;                 // samples
+
+    std::vector<int> channels;      // per mic
+    std::vector<int> pairFirst;     // per pair, index into channels
+    std::vector<int> pairSecond;
+    AlignedBuffer<float> solveX;    // [pair], least squares rows, in per-sample units
+    AlignedBuffer<float> solveY;
+
+    AlignedBuffer<float> crossRe;   // [pair][bin], whitened cross spectra
+    AlignedBuffer<float> crossIm;
+    AlignedBuffer<float> workRe;    // [bin][stride], batched inverse FFT
+    AlignedBuffer<float> workIm;
+    AlignedBuffer<float> twiddleRe, twiddleIm;
+    AlignedBuffer<int> bitReversed;
+    AlignedBuffer<float> unpackRe, unpackIm;
+    AlignedBuffer<float> binOmega;  // [bin], radians per sample
+    AlignedBuffer<float> binInverseOmega;
+
+    AlignedBuffer<float> pairDelays;    // [pair], samples
+    float directionX = 0.0f;
+    float directionY = 0.0f;
+
+    AlignedBuffer<float> residualX;     // [bin]
+    AlignedBuffer<float> residualY;
+    AlignedBuffer<float> xData;
+    AlignedBuffer<float> yData;
+    AlignedBuffer<float> gainData;
+
+    TdoaLocalizer (const TdoaLocalizer&);
+    TdoaLocalizer& operator= (const TdoaLocalizer&);
+};
+
+#endif  // TDOALOCALIZER_H_INCLUDED
@@ -0,0 +1,87 @@
+#ifndef TRIPLEBUFFER_H_INCLUDED
+#define TRIPLEBUFFER_H_INCLUDED
+
+#include <atomic>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Lock-free single-writer / single-reader handoff of whole objects.
+
+  The writer fills getWriteBuffer() and calls publish(). The reader calls
+  acquireLatest() and then reads getReadBuffer() in place for as long as it
+  likes: neither side ever blocks, copies, or sees a half-written object.
+  When the writer publishes several times between reads, the reader only
+  gets the newest one.
+
+  Three buffers rotate: the writer owns one, the reader owns one, and the
+  third ("middle") is swapped atomically together with a fresh flag.
+
+ */
+
+template <typename Type>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : state (1), writeIndex (0), readIndex (2) {}
+
+    /* Writer: the buffer to fill next. */
+    Type& getWriteBuffer()                  { return buffers[writeIndex]; }
+
+    /* Writer: hands the filled buffer over, takes back whichever one is free. */
+    void publish()
+    {
+        const int old = state.exchange (writeIndex | freshFlag, std::memory_order_acq_rel);
+        writeIndex = old & indexMask;
+    }
+
+    /* Writer: true while the last published buffer hasn't been acquired yet.
+       Lets a writer keep adding to its buffer until the reader is ready,
+       instead of publishing over something that was never read. */
+    bool isPublishedUnread() const
+    {
+        return (state.load (std::memory_order_acquire) & freshFlag) != 0;
+    }
+
+    /* Reader: true if something newer than the current read buffer was published. */
+    bool acquireLatest()
+    {
+        if ((state.load (std::memory_order_acquire) & freshFlag) == 0)
+            return false;
+
+        const int old = state.exchange (readIndex, std::memory_order_acq_rel);
+        readIndex = old & indexMask;
+        return true;
+    }
+
+    /* Reader: the most recently acquired buffer. */
+    const Type& getReadBuffer() const       { return buffers[readIndex]; }
+
+    /* Only safe while neither side is running, e.g. to allocate the buffers. */
+    Type& getBuffer (int index)             { return buffers[index]; }
+
+    /* Forgets anything published. Same restriction as getBuffer(). */
+    void reset()
+    {
+        state = 1;
+        writeIndex = 0;
+        readIndex = 2;
+    }
+
+    enum { numBuffers = 3 };
+
+private:
+    enum { indexMask = 3, freshFlag = 4 };
+
+    Type buffers[numBuffers];
+
+    std::atomic<int> state;  // middle index | freshFlag
+    int writeIndex;
+    int readIndex;
+
+    TripleBuffer (const TripleBuffer&);
+    TripleBuffer& operator= (const TripleBuffer&);
+};
+
+#endif  // TRIPLEBUFFER_H_INCLUDED
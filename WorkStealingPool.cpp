@@ -0,0 +1,113 @@
+#include "WorkStealingPool.h"
+
+//----------------------------------------------------------------------------//
+
+WorkStealingPool::WorkStealingPool (int numThreads) : nextWorker (0)
+{
+    if (numThreads < 1)
+        numThreads = 1;
+
+    for (int i = 0; i < numThreads; i++)
+        workers.push_back (std::unique_ptr<Worker> (new Worker()));
+
+    for (int i = 0; i < numThreads; i++)
+        threads.push_back (std::thread (&WorkStealingPool::run, this, i));
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    waitForAll();
+
+    {
+        std::lock_guard<std::mutex> sl (stateLock);
+        quitting = true;
+    }
+
+    workAvailable.notify_all();
+
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+void WorkStealingPool::submit (Task task)
+{
+    Worker& worker = *workers[nextWorker++ % workers.size()];
+
+    {
+        std::lock_guard<std::mutex> wl (worker.lock);
+        worker.tasks.push_back (std::move (task));
+    }
+
+    {
+        std::lock_guard<std::mutex> sl (stateLock);
+        ++numQueued;
+        ++numUnfinished;
+    }
+
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::waitForAll()
+{
+    std::unique_lock<std::mutex> sl (stateLock);
+    allDone.wait (sl, [this] { return numUnfinished == 0; });
+}
+
+//----------------------------------------------------------------------------//
+
+bool WorkStealingPool::takeTask (int index, Task& task)
+{
+    const int numWorkers = (int) workers.size();
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        Worker& worker = *workers[(index + i) % numWorkers];
+        std::lock_guard<std::mutex> wl (worker.lock);
+
+        if (worker.tasks.empty())
+            continue;
+
+        // newest of our own (still warm in cache), oldest of anyone else's
+        if (i == 0)
+        {
+            task = std::move (worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move (worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void WorkStealingPool::run (int index)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> sl (stateLock);
+            workAvailable.wait (sl, [this] { return quitting || numQueued > 0; });
+
+            if (quitting)
+                return;
+
+            --numQueued;
+        }
+
+        // a queued task is reserved for us, keep looking until we find it
+        Task task;
+        while (! takeTask (index, task))
+            std::this_thread::yield();
+
+        task (index);
+
+        std::lock_guard<std::mutex> sl (stateLock);
+        if (--numUnfinished == 0)
+            allDone.notify_all();
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef WORKSTEALINGPOOL_H_INCLUDED
+#define WORKSTEALINGPOOL_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------//
+
+ /*
+
+  Fixed set of worker threads, one task deque each.
+
+  submit() deals tasks round-robin onto the deques. A worker takes from the
+  back of its own deque and, when that runs dry, steals from the front of
+  the others, so uneven tasks (a slow disk read, a long chunk) don't leave
+  cores idle at the end of a run.
+
+  Tasks get the index of the worker running them, for per-thread state.
+
+ */
+
+class WorkStealingPool
+{
+public:
+    typedef std::function<void (int workerIndex)> Task;
+
+    explicit WorkStealingPool (int numThreads);
+    ~WorkStealingPool();
+
+    int getNumThreads() const       { return (int) threads.size(); }
+
+    void submit (Task task);
+
+    /* Blocks until every submitted task has finished. */
+    void waitForAll();
+
+private:
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void run (int index);
+    bool takeTask (int index, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex stateLock;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    int numQueued = 0;       // submitted, not yet taken
+    int numUnfinished = 0;   // submitted, not yet finished
+    bool quitting = false;
+
+    std::atomic<unsigned> nextWorker;
+
+    WorkStealingPool (const WorkStealingPool&);
+    WorkStealingPool& operator= (const WorkStealingPool&);
+};
+
+#endif  // WORKSTEALINGPOOL_H_INCLUDED